@@ -12,6 +12,13 @@ using GDT::Vector3f;
 
 namespace Flux {
     namespace Editor {
+        /** Simplified index list over the vertices of the full mesh */
+        struct MeshLod {
+            std::vector<unsigned int> indices;
+            // Square root of the largest collapse cost in object space, an upper bound on how far a kept vertex lies off the original planes it replaced
+            float error;
+        };
+
         class Mesh : public Component {
         public:
             std::string name;
@@ -20,6 +27,8 @@ namespace Flux {
             std::vector<Vector3f> normals;
             std::vector<Vector3f> tangents;
             std::vector<unsigned int> indices;
+            // Increasingly coarse levels of detail, the full mesh is not part of it
+            std::vector<MeshLod> lods;
 
             std::string materialName;
         };
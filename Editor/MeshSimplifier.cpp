@@ -0,0 +1,249 @@
+#include "MeshSimplifier.h"
+
+#include "Mesh.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+#include <cmath>
+
+namespace Flux {
+    namespace Editor {
+        namespace
+        {
+            /** Sum of squared distances to a set of planes, stored as the upper half of a symmetric 4x4 matrix */
+            struct Quadric {
+                double a[10] = {};
+
+                void addPlane(double nx, double ny, double nz, double d) {
+                    a[0] += nx * nx; a[1] += nx * ny; a[2] += nx * nz; a[3] += nx * d;
+                    a[4] += ny * ny; a[5] += ny * nz; a[6] += ny * d;
+                    a[7] += nz * nz; a[8] += nz * d;
+                    a[9] += d * d;
+                }
+
+                void add(const Quadric& q) {
+                    for (int i = 0; i < 10; i++) {
+                        a[i] += q.a[i];
+                    }
+                }
+
+                double evaluate(const Vector3f& v) const {
+                    const double x = v.x, y = v.y, z = v.z;
+                    return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+                        + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+                        + a[7] * z * z + 2 * a[8] * z
+                        + a[9];
+                }
+            };
+
+            struct Collapse {
+                unsigned int from;
+                unsigned int to;
+                double cost;
+            };
+
+            Vector3f faceNormal(const Vector3f& a, const Vector3f& b, const Vector3f& c)
+            {
+                const Vector3f e0(b.x - a.x, b.y - a.y, b.z - a.z);
+                const Vector3f e1(c.x - a.x, c.y - a.y, c.z - a.z);
+                return Vector3f(e0.y * e1.z - e0.z * e1.y, e0.z * e1.x - e0.x * e1.z, e0.x * e1.y - e0.y * e1.x);
+            }
+
+            uint64_t edgeKey(unsigned int a, unsigned int b)
+            {
+                return a < b ? ((uint64_t) a << 32) | b : ((uint64_t) b << 32) | a;
+            }
+
+            class Simplifier {
+            public:
+                Simplifier(const Mesh& mesh) : vertices(mesh.vertices), quadrics(mesh.vertices.size()), locked(mesh.vertices.size(), false) {
+                    const std::vector<unsigned int>& indices = mesh.indices;
+
+                    std::unordered_map<uint64_t, unsigned int> edgeUse;
+                    for (size_t i = 0; i < indices.size(); i += 3) {
+                        const unsigned int* t = &indices[i];
+
+                        Vector3f n = faceNormal(vertices[t[0]], vertices[t[1]], vertices[t[2]]);
+                        const double length = std::sqrt((double) n.x * n.x + (double) n.y * n.y + (double) n.z * n.z);
+                        if (length > 0) {
+                            const double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+                            const double d = -(nx * vertices[t[0]].x + ny * vertices[t[0]].y + nz * vertices[t[0]].z);
+                            for (int j = 0; j < 3; j++) {
+                                quadrics[t[j]].addPlane(nx, ny, nz, d);
+                            }
+                        }
+
+                        for (int j = 0; j < 3; j++) {
+                            edgeUse[edgeKey(t[j], t[(j + 1) % 3])]++;
+                        }
+                    }
+
+                    // Seams split their vertices, so they show up as borders in the index list as well
+                    for (const auto& edge : edgeUse) {
+                        if (edge.second == 1) {
+                            locked[(unsigned int) (edge.first >> 32)] = true;
+                            locked[(unsigned int) (edge.first & 0xFFFFFFFF)] = true;
+                        }
+                    }
+                }
+
+                /** Collapses edges of the index list until it has at most the target number of triangles or nothing can be collapsed */
+                void simplify(std::vector<unsigned int>& indices, size_t targetTriangles) {
+                    const size_t vertexCount = vertices.size();
+                    std::vector<Collapse> collapses;
+                    std::vector<unsigned int> remap(vertexCount);
+                    std::vector<unsigned char> touched(vertexCount);
+                    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+                    std::vector<unsigned int> adjacency;
+
+                    while (indices.size() / 3 > targetTriangles) {
+                        collapses.clear();
+                        for (size_t i = 0; i < indices.size(); i += 3) {
+                            for (int j = 0; j < 3; j++) {
+                                const unsigned int a = indices[i + j];
+                                const unsigned int b = indices[i + (j + 1) % 3];
+                                if (!locked[a]) {
+                                    collapses.push_back({ a, b, getCost(a, b) });
+                                }
+                                if (!locked[b]) {
+                                    collapses.push_back({ b, a, getCost(b, a) });
+                                }
+                            }
+                        }
+                        std::sort(collapses.begin(), collapses.end(), [](const Collapse& c0, const Collapse& c1) {
+                            return c0.cost < c1.cost;
+                        });
+
+                        // Triangles around every vertex, to check what a collapse does to them
+                        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+                        for (unsigned int index : indices) {
+                            adjacencyOffsets[index + 1]++;
+                        }
+                        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+                        adjacency.resize(indices.size());
+                        std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+                        for (size_t i = 0; i < indices.size(); i++) {
+                            adjacency[fill[indices[i]]++] = (unsigned int) (i / 3);
+                        }
+
+                        // Every vertex takes part in one collapse per pass, so the checks below see current positions
+                        std::iota(remap.begin(), remap.end(), 0);
+                        std::fill(touched.begin(), touched.end(), 0);
+
+                        size_t triangles = indices.size() / 3;
+                        size_t collapsed = 0;
+                        for (const Collapse& collapse : collapses) {
+                            if (triangles <= targetTriangles)
+                                break;
+                            if (touched[collapse.from] || touched[collapse.to])
+                                continue;
+                            if (flipsTriangle(indices, adjacency, adjacencyOffsets, collapse))
+                                continue;
+
+                            for (unsigned int k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1]; k++) {
+                                const unsigned int* t = &indices[adjacency[k] * 3];
+                                if (t[0] == collapse.to || t[1] == collapse.to || t[2] == collapse.to) {
+                                    triangles--;
+                                }
+                                touched[t[0]] = touched[t[1]] = touched[t[2]] = 1;
+                            }
+
+                            remap[collapse.from] = collapse.to;
+                            quadrics[collapse.to].add(quadrics[collapse.from]);
+                            maxCost = std::max(maxCost, collapse.cost);
+                            collapsed++;
+                        }
+
+                        if (collapsed == 0)
+                            break;
+
+                        size_t write = 0;
+                        for (size_t i = 0; i < indices.size(); i += 3) {
+                            const unsigned int a = remap[indices[i]];
+                            const unsigned int b = remap[indices[i + 1]];
+                            const unsigned int c = remap[indices[i + 2]];
+                            if (a == b || b == c || c == a)
+                                continue;
+
+                            indices[write++] = a;
+                            indices[write++] = b;
+                            indices[write++] = c;
+                        }
+                        indices.resize(write);
+                    }
+                }
+
+                /**
+                 * Square root of the most expensive collapse so far. The cost sums squared
+                 * distances to planes, so this bounds the distance to every single one of them.
+                 */
+                float getError() const {
+                    return (float) std::sqrt(std::max(maxCost, 0.0));
+                }
+
+            private:
+                double getCost(unsigned int from, unsigned int to) const {
+                    Quadric q = quadrics[from];
+                    q.add(quadrics[to]);
+                    return q.evaluate(vertices[to]);
+                }
+
+                bool flipsTriangle(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& adjacency,
+                    const std::vector<unsigned int>& adjacencyOffsets, const Collapse& collapse) const
+                {
+                    for (unsigned int k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1]; k++) {
+                        const unsigned int* t = &indices[adjacency[k] * 3];
+
+                        // Triangles along the edge disappear
+                        if (t[0] == collapse.to || t[1] == collapse.to || t[2] == collapse.to)
+                            continue;
+
+                        const Vector3f before = faceNormal(vertices[t[0]], vertices[t[1]], vertices[t[2]]);
+                        const Vector3f& a = vertices[t[0] == collapse.from ? collapse.to : t[0]];
+                        const Vector3f& b = vertices[t[1] == collapse.from ? collapse.to : t[1]];
+                        const Vector3f& c = vertices[t[2] == collapse.from ? collapse.to : t[2]];
+                        const Vector3f after = faceNormal(a, b, c);
+
+                        if (before.x * after.x + before.y * after.y + before.z * after.z <= 0)
+                            return true;
+                    }
+                    return false;
+                }
+
+                const std::vector<Vector3f>& vertices;
+                std::vector<Quadric> quadrics;
+                std::vector<bool> locked;
+                double maxCost = 0;
+            };
+        }
+
+        void MeshSimplifier::generateLods(Mesh& mesh) {
+            mesh.lods.clear();
+            if (mesh.indices.size() / 3 < MIN_TRIANGLES * 2)
+                return;
+
+            // Every level continues from the previous one, so the errors only grow along the chain
+            Simplifier simplifier(mesh);
+            std::vector<unsigned int> indices = mesh.indices;
+
+            for (unsigned int lod = 0; lod < MAX_LODS; lod++) {
+                const size_t triangles = indices.size() / 3;
+                if (triangles / 2 < MIN_TRIANGLES)
+                    break;
+
+                simplifier.simplify(indices, triangles / 2);
+
+                // Locked borders can leave too little to collapse for another level to pay off
+                if (indices.size() / 3 > triangles * 3 / 4)
+                    break;
+
+                MeshLod level;
+                level.indices = indices;
+                level.error = simplifier.getError();
+                mesh.lods.push_back(level);
+            }
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+namespace Flux {
+    namespace Editor {
+        class Mesh;
+
+        /**
+         * Builds coarser index lists over the vertices of a mesh by collapsing
+         * edges into one of their end points, cheapest first as measured by the
+         * quadric error of the planes around the removed vertex. No vertex is
+         * moved or added, so every level shares the vertex buffer of the full
+         * mesh. Vertices on open borders, which includes texture seams, stay in
+         * place so the surface never tears apart.
+         */
+        class MeshSimplifier {
+        public:
+            /** Replaces the levels of detail of the mesh, each one has about half the triangles of the previous one */
+            static void generateLods(Mesh& mesh);
+
+            static const unsigned int MAX_LODS = 4;
+            // Meshes this small are cheap enough to always draw at full detail
+            static const unsigned int MIN_TRIANGLES = 64;
+        };
+    }
+}
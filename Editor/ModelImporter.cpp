@@ -9,6 +9,7 @@
 #include "Util/Log.h"
 #include "Util/Path.h"
 #include "Mesh.h"
+#include "MeshSimplifier.h"
 
 #include <vector>
 #include <iostream>
@@ -87,6 +88,9 @@ namespace Flux {
                 mesh->materialName = std::string(name.C_Str());
                 std::cout << "Material name: " << mesh->materialName << std::endl;
 
+                MeshSimplifier::generateLods(*mesh);
+                std::cout << "Levels of detail: " << mesh->lods.size() << std::endl;
+
                 model.addMesh(mesh);
             }
 
@@ -11,6 +11,7 @@
 #include "Mesh.h"
 #include "MeshRenderer.h"
 #include "AttachedTo.h"
+#include "SceneLoader.h"
 #include "Camera.h"
 
 #include "PointLight.h"
@@ -49,6 +50,9 @@ namespace Flux {
             Buffer buffer;
             buffer.buf = new char[1000000000];
 
+            copy(buffer, SceneLoader::MAGIC);
+            copy(buffer, SceneLoader::VERSION);
+
             if (scene.skybox) {
                 const uint32_t type = 1;
                 copy(buffer, type);
@@ -166,6 +170,17 @@ namespace Flux {
                 copy(buffer, numIndices);
                 copy(buffer, mesh.indices.data(), numIndices * sizeof(unsigned int));
 
+                // Levels of detail index the vertices written above
+                const uint32_t numLods = (uint32_t)mesh.lods.size();
+                copy(buffer, numLods);
+                for (const MeshLod& lod : mesh.lods) {
+                    const uint32_t numLodIndices = (uint32_t)lod.indices.size();
+
+                    copy(buffer, &lod.error, sizeof(float));
+                    copy(buffer, numLodIndices);
+                    copy(buffer, lod.indices.data(), numLodIndices * sizeof(unsigned int));
+                }
+
                 clock_t endMeshTime = clock();
                 double elapsed = double(endMeshTime - meshTime) / CLOCKS_PER_SEC;
                 std::cout << "Writing mesh took: " << elapsed << " seconds." << std::endl;
@@ -175,6 +190,8 @@ namespace Flux {
                 MeshRenderer& mr = e->getComponent<MeshRenderer>();
 
                 copy(buffer, mr.materialID);
+                copy(buffer, &mr.isStatic, sizeof(bool));
+                copy(buffer, &mr.isOccluder, sizeof(bool));
             }
             if (e->hasComponent<Camera>()) {
                 copy(buffer, "c", sizeof(char));
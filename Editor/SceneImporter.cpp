@@ -58,7 +58,6 @@ namespace Flux {
                 DirectionalLight* dirLight = new DirectionalLight();
                 dirLight->color.set(rad[0], rad[1], rad[2]);
                 light->addComponent(dirLight);
-                light->addComponent(new Camera(-40, 40, -40, 40, -50, 50));
                 Transform* t1 = new Transform();
                 t1->rotation.set(dir[0], dir[1], dir[2]);
                 light->addComponent(t1);
@@ -112,6 +111,8 @@ namespace Flux {
                 e->name = name;
 
                 std::vector<MeshRenderer*> meshRenderers;
+                bool isStatic = false;
+                bool isOccluder = false;
                 for (json::iterator it = element["components"][0].begin(); it != element["components"][0].end(); ++it) {
                     std::cout << "Iterator: " << it.key() << " : " << it.value() << "\n";
 
@@ -189,6 +190,12 @@ namespace Flux {
 
                         e->addComponent(new Camera(fov, aspect, zNear, zFar));
                     }
+                    if (it.key() == "static") {
+                        isStatic = it.value().get<bool>();
+                    }
+                    if (it.key() == "occluder") {
+                        isOccluder = it.value().get<bool>();
+                    }
                     if (it.key() == "arealight") {
                         AreaLight* areaLight = new AreaLight();
                         areaLight->color.set(20, 10, 1);
@@ -216,6 +223,12 @@ namespace Flux {
                         e->addComponent(transform);
                     }
                 }
+
+                // The keys come in any order, so the flags are only known once all components are read
+                for (MeshRenderer* meshRenderer : meshRenderers) {
+                    meshRenderer->isStatic = isStatic;
+                    meshRenderer->isOccluder = isOccluder;
+                }
                 scene.addEntity(e);
             }
 
@@ -0,0 +1,40 @@
+#version 330 core
+
+in vec3 pass_position;
+in vec2 pass_texCoords;
+
+out vec4 fragColor;
+
+uniform sampler2D tex;
+uniform vec2 texelSize;
+
+uniform bool prefilter;
+uniform float threshold;
+uniform float knee;
+
+vec3 applyThreshold(vec3 color) {
+    float brightness = max(color.r, max(color.g, color.b));
+
+    // Quadratic curve between threshold - knee and threshold + knee avoids a hard cutoff
+    float soft = clamp(brightness - threshold + knee, 0, 2 * knee);
+    soft = knee > 0 ? soft * soft / (4 * knee) : 0;
+
+    return color * max(soft, brightness - threshold) / max(brightness, 0.0001);
+}
+
+void main()
+{
+    // Dual filter downsample, every bilinear tap already averages four texels of the higher level
+    vec3 color = textureLod(tex, pass_texCoords, 0).rgb * 4;
+    color += textureLod(tex, pass_texCoords + vec2(-texelSize.x, -texelSize.y), 0).rgb;
+    color += textureLod(tex, pass_texCoords + vec2( texelSize.x, -texelSize.y), 0).rgb;
+    color += textureLod(tex, pass_texCoords + vec2(-texelSize.x,  texelSize.y), 0).rgb;
+    color += textureLod(tex, pass_texCoords + vec2( texelSize.x,  texelSize.y), 0).rgb;
+    color /= 8;
+
+    if (prefilter) {
+        color = applyThreshold(color);
+    }
+
+    fragColor = vec4(color, 1);
+}
@@ -0,0 +1,33 @@
+#version 330 core
+
+in vec3 pass_position;
+in vec2 pass_texCoords;
+
+out vec4 fragColor;
+
+uniform sampler2D tex;
+uniform vec2 texelSize;
+
+uniform bool composite;
+uniform sampler2D sceneTex;
+uniform float intensity;
+
+void main()
+{
+    // Tent filter over the lower level, the result is added to the level it is drawn into
+    vec3 color = textureLod(tex, pass_texCoords + vec2(-texelSize.x * 2, 0), 0).rgb;
+    color += textureLod(tex, pass_texCoords + vec2( texelSize.x * 2, 0), 0).rgb;
+    color += textureLod(tex, pass_texCoords + vec2(0, -texelSize.y * 2), 0).rgb;
+    color += textureLod(tex, pass_texCoords + vec2(0,  texelSize.y * 2), 0).rgb;
+    color += textureLod(tex, pass_texCoords + vec2(-texelSize.x, -texelSize.y), 0).rgb * 2;
+    color += textureLod(tex, pass_texCoords + vec2( texelSize.x, -texelSize.y), 0).rgb * 2;
+    color += textureLod(tex, pass_texCoords + vec2(-texelSize.x,  texelSize.y), 0).rgb * 2;
+    color += textureLod(tex, pass_texCoords + vec2( texelSize.x,  texelSize.y), 0).rgb * 2;
+    color /= 12;
+
+    if (composite) {
+        color = texture(sceneTex, pass_texCoords).rgb + color * intensity;
+    }
+
+    fragColor = vec4(color, 1);
+}
@@ -6,42 +6,68 @@
 #define D_GGX
 #define G_Schlick
 
+#define MAX_DIRECTIONAL_LIGHTS 2
+#define MAX_CASCADES 4
+#define MAX_AREA_LIGHTS 4
+
+// Dimensions of the light cluster grid, must match LightClusters
+const uvec3 clusterGrid = uvec3(16u, 9u, 24u);
+
 struct DirectionalLight {
     vec3 direction;
     vec3 color;
-    sampler2DShadow shadowMap;
-    mat4 shadowMatrix;
-};
-
-struct PointLight {
-    vec3 position;
-    vec3 color;
-    samplerCubeShadow shadowMap;
+    // Cascades cover consecutive depth ranges of the view, each in its own tile of the shadow atlas
+    mat4 shadowMatrices[MAX_CASCADES];
+    // One split per cascade, a float array would take a vec4 per element in std140
+    vec4 cascadeSplits;
+    int cascadeCount;
 };
 
 struct AreaLight {
     vec3 color;
     vec3 vertices[4];
-    sampler2D ampTex;
-    sampler2D matTex;
+};
+
+layout(std140) uniform CameraBlock {
+    mat4 projMatrix;
+    mat4 viewMatrix;
+    mat4 projViewMatrix;
+    vec3 camPos;
+    float zNear;
+    float zFar;
+    mat4 invProjViewMatrix;
 };
 
 uniform sampler2D albedoMap;
 uniform sampler2D normalMap;
-uniform sampler2D positionMap;
+uniform sampler2D depthMap;
 uniform sampler2D emissionMap;
 
-uniform mat4 modelMatrix;
+// Directional and area lights of the frame, laid out like LightUniforms
+layout(std140) uniform LightBlock {
+    DirectionalLight dirLights[MAX_DIRECTIONAL_LIGHTS];
+    AreaLight areaLights[MAX_AREA_LIGHTS];
+    int dirLightCount;
+    int areaLightCount;
+};
 
-uniform DirectionalLight dirLight;
-uniform PointLight pointLight;
-uniform AreaLight areaLight;
+uniform sampler2D ampTex;
+uniform sampler2D matTex;
 
-uniform bool isPointLight;
-uniform bool isDirLight;
-uniform bool isAreaLight;
+// Two texels per point light: position and radius, color and shadow slot
+uniform samplerBuffer lights;
+// Offset and count of the light indices of every cluster
+uniform usamplerBuffer lightClusters;
+uniform usamplerBuffer lightIndices;
 
-uniform vec3 camPos;
+// Shadow views of all lights, with the tiles of the six faces of every shadowed point light
+uniform sampler2DShadow shadowAtlas;
+uniform samplerBuffer shadowTiles;
+
+uniform float sliceScale;
+uniform float sliceBias;
+// Point lights are drawn as separate light volumes when not clustered
+uniform bool clusteredLights;
 
 in vec3 pass_position;
 in vec2 pass_texCoords;
@@ -174,77 +200,148 @@ vec3 Evaluate_LTC(vec3 N, vec3 V, vec3 P, mat3 invMat, vec3 vertices[4]) {
     return vec3(E);
 }
 
+/* Looks up the cubemap face of the direction from the light and samples its tile in the atlas */
+float pointShadow(int slot, vec3 L) {
+    vec3 v = -L;
+    vec3 absV = abs(v);
+
+    // Face selection and coordinates follow the cubemap conventions the faces were rendered with
+    int face;
+    vec2 st;
+    if (absV.x >= absV.y && absV.x >= absV.z) {
+        face = v.x > 0 ? 0 : 1;
+        st = vec2(v.x > 0 ? -v.z : v.z, -v.y) / absV.x;
+    } else if (absV.y >= absV.z) {
+        face = v.y > 0 ? 2 : 3;
+        st = vec2(v.x, v.y > 0 ? v.z : -v.z) / absV.y;
+    } else {
+        face = v.z > 0 ? 4 : 5;
+        st = vec2(v.z > 0 ? v.x : -v.x, -v.y) / absV.z;
+    }
+
+    // Offset and size of the tile, clamped half a texel inside so filtering never reads a neighbouring tile
+    vec4 tile = texelFetch(shadowTiles, slot * 6 + face);
+    vec2 halfTexel = 0.5 / vec2(textureSize(shadowAtlas, 0));
+    vec2 coords = clamp(tile.xy + (st * 0.5 + 0.5) * tile.zw, tile.xy + halfTexel, tile.xy + tile.zw - halfTexel);
+
+    return texture(shadowAtlas, vec3(coords, vecToDepthVal(L)));
+}
+
+/* Returns the first cascade reaching beyond the view depth, or -1 if the depth lies beyond all of them */
+int getCascade(int index, float depth) {
+    for (int i = 0; i < dirLights[index].cascadeCount; i++) {
+        if (depth < dirLights[index].cascadeSplits[i])
+            return i;
+    }
+    return -1;
+}
+
+float directionalShadow(int index, vec3 P) {
+    int cascade = getCascade(index, -(viewMatrix * vec4(P, 1)).z);
+    if (cascade < 0)
+        return 1;
+
+    return textureProj(shadowAtlas, dirLights[index].shadowMatrices[cascade] * vec4(P, 1));
+}
+
+/* Returns the range of light indices of the cluster containing the pixel */
+uvec2 getCluster(vec3 P) {
+    float depth = -(viewMatrix * vec4(P, 1)).z;
+    uint slice = uint(clamp(floor(log(depth) * sliceScale - sliceBias), 0, float(clusterGrid.z - 1u)));
+    uvec2 tile = min(uvec2(pass_texCoords * vec2(clusterGrid.xy)), clusterGrid.xy - 1u);
+
+    uint cluster = (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+    return texelFetch(lightClusters, int(cluster)).xy;
+}
+
+vec3 DirectLight(vec3 N, vec3 V, vec3 L, vec3 BaseColor, float Metalness, float Roughness) {
+    vec3 H = normalize(L + V);
+
+    // Lambert Diffuse BRDF
+    vec3 LambertBRDF = (BaseColor / PI) * (1 - Metalness);
+
+    // Cook Torrance Specular BRDF
+    vec3 CookBRDF = clamp(CookTorrance(N, V, H, L, BaseColor, Metalness, Roughness), 0, 1);
+
+    return (LambertBRDF + CookBRDF) * CosTheta(N, L);
+}
+
+/* Unfolds an octahedral normal from the G-buffer */
+vec3 decodeNormal(vec2 encoded) {
+    encoded = encoded * 2 - 1;
+    vec3 N = vec3(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-N.z, 0);
+    N.x += N.x >= 0 ? -fold : fold;
+    N.y += N.y >= 0 ? -fold : fold;
+    return normalize(N);
+}
+
+/* Reconstructs the world position of a pixel from the depth buffer */
+vec3 getWorldPosition(vec2 texCoords) {
+    float depth = texture(depthMap, texCoords).r;
+    vec4 P = invProjViewMatrix * vec4(vec3(texCoords, depth) * 2 - 1, 1);
+    return P.xyz / P.w;
+}
+
 void main() {
     vec4 arMap = texture(albedoMap, pass_texCoords);
     vec4 nmMap = texture(normalMap, pass_texCoords);
-    vec4 peMap = texture(positionMap, pass_texCoords);
     vec3 Emission = texture(emissionMap, pass_texCoords).rgb;
     
     vec3 BaseColor = toLinear(arMap.rgb);
     float Roughness = arMap.w;
-    vec3 N = normalize(nmMap.rgb * 2 - 1);
-    float Metalness = nmMap.w;
-    vec3 P = peMap.rgb;
+    vec3 N = decodeNormal(nmMap.rg);
+    float Metalness = nmMap.b;
+    vec3 P = getWorldPosition(pass_texCoords);
     
     vec3 V = normalize(camPos - P);
-    vec3 R = normalize(reflect(-V, N));
-    
-    vec4 S = dirLight.shadowMatrix * vec4(P, 1);
-    
-    vec3 L;
-    vec3 Li = vec3(1, 1, 1);
-    float visibility = 1;
-    float Attenuation = 1;
     
     vec3 Radiance = vec3(0, 0, 0);
 
-    // Lambert Diffuse BRDF
-    vec3 LambertBRDF = (BaseColor / PI) * (1 - Metalness);
+    if (clusteredLights) {
+        uvec2 cluster = getCluster(P);
+        for (uint i = 0u; i < cluster.y; i++) {
+            int light = int(texelFetch(lightIndices, int(cluster.x + i)).x);
+            vec4 positionRadius = texelFetch(lights, light * 2);
+            vec4 colorSlot = texelFetch(lights, light * 2 + 1);
 
-    if (isPointLight) {
-        L = pointLight.position - P;
-        float distance = dot(L, L);
-        visibility = texture(pointLight.shadowMap, vec4(-L, vecToDepthVal(L)));
-        L = normalize(L);
-        Attenuation = CosTheta(N, L) * 1 / distance;
-        Li = pointLight.color;
+            vec3 L = positionRadius.xyz - P;
+            float distance = dot(L, L);
+            if (distance > positionRadius.w * positionRadius.w)
+                continue;
 
-        vec3 H = normalize(L + V);
+            float visibility = colorSlot.w < 0 ? 1 : pointShadow(int(colorSlot.w), L);
 
-        // Cook Torrance Specular BRDF
-        vec3 CookBRDF = clamp(CookTorrance(N, V, H, L, BaseColor, Metalness, Roughness), 0, 1);
+            // Fade out the inverse square falloff towards the radius the light was clustered with
+            float fade = clamp(1 - pow(distance / (positionRadius.w * positionRadius.w), 2), 0, 1);
+            float Attenuation = fade * fade / distance;
 
-        Radiance += (LambertBRDF + CookBRDF) * Li * Attenuation;
+            Radiance += DirectLight(N, V, normalize(L), BaseColor, Metalness, Roughness) * colorSlot.rgb * Attenuation * visibility;
+        }
     }
-    if (isDirLight) {
-        L = -dirLight.direction;
-        Attenuation = CosTheta(N, L);
-        Li = dirLight.color;
-        visibility = textureProj(dirLight.shadowMap, S);
 
-        vec3 H = normalize(L + V);
+    for (int i = 0; i < dirLightCount; i++) {
+        vec3 L = -dirLights[i].direction;
+        float visibility = directionalShadow(i, P);
 
-        // Cook Torrance Specular BRDF
-        vec3 CookBRDF = clamp(CookTorrance(N, V, H, L, BaseColor, Metalness, Roughness), 0, 1);
-
-        Radiance += (LambertBRDF + CookBRDF) * Li * Attenuation;
+        Radiance += DirectLight(N, V, L, BaseColor, Metalness, Roughness) * dirLights[i].color * visibility;
     }
-    if (isAreaLight) {
-        vec3 Li = areaLight.color;
+
+    for (int i = 0; i < areaLightCount; i++) {
+        vec3 Li = areaLights[i].color;
         
         float theta = acos(dot(N, V)) / (PI * 0.5);
         vec2 coords = vec2(Roughness, theta);
-        vec4 param = texture(areaLight.matTex, coords);
+        vec4 param = texture(matTex, coords);
 
         mat3 M = mat3(vec3(param.x, 0, param.w), vec3(0, param.z, 0), vec3(param.y, 0, 1));
         mat3 invMat = inverse(M);
-        //mat3 invMat = mat3(vec3(1, 0, param.y), vec3(0, param.z, 0), vec3(param.w, 0, param.x));
         
-        vec3 Ed = Evaluate_LTC(N, V, P, mat3(1), areaLight.vertices);
-        vec3 Es = Evaluate_LTC(N, V, P, invMat, areaLight.vertices);
+        vec3 Ed = Evaluate_LTC(N, V, P, mat3(1), areaLights[i].vertices);
+        vec3 Es = Evaluate_LTC(N, V, P, invMat, areaLights[i].vertices);
 
         vec3 DiffColor = (BaseColor) * (1 - Metalness);
-        vec2 schlick = texture(areaLight.ampTex, coords).xy;
+        vec2 schlick = texture(ampTex, coords).xy;
         vec3 SpecColor = mix(vec3(0.04), BaseColor, Metalness);
         // Scale by light intensity
         vec3 Rad = vec3(Ed * DiffColor + Es * (SpecColor*schlick.x + (1 - SpecColor) * schlick.y)) * Li;
@@ -255,5 +352,5 @@ void main() {
         Radiance += vec3(Rad);
     }
 
-    fragColor = vec4(Emission + Radiance * visibility, 1.0);
+    fragColor = vec4(Emission + Radiance, 1.0);
 }
@@ -2,7 +2,7 @@
 
 uniform sampler2D albedoMap;
 uniform sampler2D normalMap;
-uniform sampler2D positionMap;
+uniform sampler2D depthMap;
 
 uniform samplerCube irradianceMap;
 uniform samplerCube prefilterEnvmap;
@@ -11,6 +11,7 @@ uniform sampler2D scaleBiasMap;
 uniform vec3 camPos;
 uniform mat4 projMatrix;
 uniform mat4 viewMatrix;
+uniform mat4 invProjViewMatrix;
 
 in vec3 pass_position;
 in vec2 pass_texCoords;
@@ -32,15 +33,32 @@ vec3 ApproximateSpecularIBL(vec3 SpecularColor, float Roughness, vec3 N, vec3 V)
     return PrefilteredColor * (SpecularColor * EnvBRDF.x + EnvBRDF.y);
 }
 
+/* Unfolds an octahedral normal from the G-buffer */
+vec3 decodeNormal(vec2 encoded) {
+    encoded = encoded * 2 - 1;
+    vec3 N = vec3(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-N.z, 0);
+    N.x += N.x >= 0 ? -fold : fold;
+    N.y += N.y >= 0 ? -fold : fold;
+    return normalize(N);
+}
+
+/* Reconstructs the world position of a pixel from the depth buffer */
+vec3 getWorldPosition(vec2 texCoords) {
+    float depth = texture(depthMap, texCoords).r;
+    vec4 P = invProjViewMatrix * vec4(vec3(texCoords, depth) * 2 - 1, 1);
+    return P.xyz / P.w;
+}
+
 void main() {
     vec4 arMap = texture(albedoMap, pass_texCoords);
     vec4 nmMap = texture(normalMap, pass_texCoords);
-    vec3 P = texture(positionMap, pass_texCoords).rgb;
+    vec3 P = getWorldPosition(pass_texCoords);
 
     vec3 BaseColor = toLinear(arMap.rgb);
     float Roughness = arMap.w;
-    vec3 N = normalize(nmMap.rgb * 2 - 1);
-    float Metalness = nmMap.w;
+    vec3 N = decodeNormal(nmMap.rg);
+    float Metalness = nmMap.b;
 
     vec3 V = normalize(camPos - P);
     vec3 R = normalize(reflect(-V, N));
@@ -0,0 +1,279 @@
+#version 330 core
+
+#define PI 3.14159265359
+#define EPSILON 0.0001
+
+#define D_GGX
+#define G_Schlick
+
+#define POINT_LIGHT 0
+#define AREA_LIGHT 1
+
+layout(std140) uniform CameraBlock {
+    mat4 projMatrix;
+    mat4 viewMatrix;
+    mat4 projViewMatrix;
+    vec3 camPos;
+    float zNear;
+    float zFar;
+    mat4 invProjViewMatrix;
+};
+
+uniform sampler2D albedoMap;
+uniform sampler2D normalMap;
+uniform sampler2D depthMap;
+
+uniform vec2 windowSize;
+
+uniform int lightType;
+uniform vec3 color;
+
+// Point light
+uniform vec3 position;
+uniform float radius;
+// Index of the tiles of the light in the shadow atlas, or -1 if it casts no shadow
+uniform int shadowSlot;
+uniform sampler2DShadow shadowAtlas;
+uniform samplerBuffer shadowTiles;
+
+// Area light
+uniform vec3 vertices[4];
+uniform sampler2D ampTex;
+uniform sampler2D matTex;
+
+out vec4 fragColor;
+
+vec3 toLinear(vec3 gammaColor) {
+    return pow(gammaColor, vec3(2.2));
+}
+
+/* Calculates the diffuse contribution of the light */
+float CosTheta(vec3 N, vec3 L) {
+    return max(0, dot(N, L));
+}
+
+/* ------------------------ Fresnel functions -------------------------- */
+// Fresnel
+vec3 Fresnel(vec3 BaseColor, float Metalness, float b) {
+    vec3 F0 = mix(vec3(0.04), BaseColor, Metalness);
+    return F0 + (1.0 - F0) * pow(1.0 - b, 5.0);
+}
+
+/* ---------------------- Distribution functions ----------------------- */
+// GGX
+float GGX(float NdotH, float Roughness) {
+    float a = Roughness * Roughness;
+    float a2 = a * a;
+    float d = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    return a2 / (PI * d * d);
+}
+
+// Beckmann
+float Beckmann(float NdotH, float Roughness) {
+    float a = Roughness * Roughness;
+    float a2 = a * a;
+    float r1 = 1.0 / (4.0 * a2 * pow(NdotH, 4.0));
+    float r2 = (NdotH * NdotH - 1.0) / (a2 * NdotH * NdotH);
+    return r1 * exp(r2);
+}
+
+/* --------------------- Geometric shadowing terms --------------------- */
+// Schlick
+float Schlick(float NdotL, float NdotV, float Roughness) {
+    float a = Roughness + 1.0;
+    float k = a * a * 0.125;
+    float G1 = NdotL / (NdotL * (1.0 - k) + k);
+    float G2 = NdotV / (NdotV * (1.0 - k) + k);
+    return G1 * G2;
+}
+
+// Cook-Torrance
+float GCT(float NdotL, float NdotV, float NdotH, float VdotH) {
+    float G1 = (2.0 * NdotH * NdotV) / VdotH;
+    float G2 = (2.0 * NdotH * NdotL) / VdotH;
+    return min(1.0, min(G1, G2));
+}
+
+// Keleman
+float Keleman(float NdotL, float NdotV, float VdotH) {
+    return (NdotL * NdotV) / (VdotH * VdotH);
+}
+
+/* --------------------------- Shading model --------------------------- */
+// Cook-Torrance
+vec3 CookTorrance(vec3 N, vec3 V, vec3 H, vec3 L, vec3 BaseColor, float Metalness, float Roughness) {
+    float NdotH = max(0.0, dot(N, H));
+    float NdotV = max(1e-7, dot(N, V));
+    float NdotL = max(1e-7, dot(N, L));
+    float VdotH = max(0.0, dot(V, H));
+    #ifdef D_GGX
+    float D = GGX(NdotH, Roughness);
+    #endif
+    #ifdef D_Beckmann
+    float D = Beckmann(NdotH, Roughness);
+    #endif
+    
+    #ifdef G_Schlick
+    float G = Schlick(NdotL, NdotV, Roughness);
+    #endif
+    #ifdef G_CookTorrance
+    float G = GCT(NdotL, NdotV, NdotH, VdotH);
+    #endif
+    #ifdef G_Keleman
+    float G = Keleman(NdotL, NdotV, VdotH);
+    #endif
+    
+    vec3 F = Fresnel(BaseColor, Metalness, VdotH);
+    
+    return (D * F * G) / (4.0 * NdotL * NdotV);
+}
+
+float vecToDepthVal(vec3 v) {
+    vec3 absVec = abs(v);
+    float locZcomp = max(absVec.x, max(absVec.y, absVec.z));
+    
+    float f = 400;
+    float n = 0.1;
+    float normZcomp = (f + n) / (f - n) - (2*f*n) / (f-n) / locZcomp;
+    return (normZcomp + 1.0) * 0.5;
+}
+
+/* Looks up the cubemap face of the direction from the light and samples its tile in the atlas */
+float pointShadow(int slot, vec3 L) {
+    vec3 v = -L;
+    vec3 absV = abs(v);
+
+    // Face selection and coordinates follow the cubemap conventions the faces were rendered with
+    int face;
+    vec2 st;
+    if (absV.x >= absV.y && absV.x >= absV.z) {
+        face = v.x > 0 ? 0 : 1;
+        st = vec2(v.x > 0 ? -v.z : v.z, -v.y) / absV.x;
+    } else if (absV.y >= absV.z) {
+        face = v.y > 0 ? 2 : 3;
+        st = vec2(v.x, v.y > 0 ? v.z : -v.z) / absV.y;
+    } else {
+        face = v.z > 0 ? 4 : 5;
+        st = vec2(v.z > 0 ? v.x : -v.x, -v.y) / absV.z;
+    }
+
+    // Offset and size of the tile, clamped half a texel inside so filtering never reads a neighbouring tile
+    vec4 tile = texelFetch(shadowTiles, slot * 6 + face);
+    vec2 halfTexel = 0.5 / vec2(textureSize(shadowAtlas, 0));
+    vec2 coords = clamp(tile.xy + (st * 0.5 + 0.5) * tile.zw, tile.xy + halfTexel, tile.xy + tile.zw - halfTexel);
+
+    return texture(shadowAtlas, vec3(coords, vecToDepthVal(L)));
+}
+
+vec3 Evaluate_LTC(vec3 N, vec3 V, vec3 P, mat3 invMat, vec3 vertices[4]) {
+    // Construct orthonormal basis around N
+    vec3 T1, T2;
+    T1 = normalize(V - N*dot(V, N));
+    T2 = cross(N, T1);
+
+    // Calculate the inverse matrix for putting vertices in light space
+    invMat = invMat * transpose(mat3(T1, T2, N));
+
+    // Apply matrix to all vertices
+    vec3 verts[4];
+    for (int i = 0; i < 4; i++) {
+        verts[i] = normalize(invMat * (vertices[i] - P));
+    }
+
+    // Integrate
+    float E = 0;
+    for (int i = 0; i < 4; i++) {
+        vec3 pi = verts[i];
+        vec3 pj = verts[(i + 1) % 4];
+
+        float ft = acos(clamp(dot(pi, pj), -0.999, 0.999));
+        E += ft * normalize(cross(pi, pj)).z;
+    }
+
+    // Make it one-sided
+    E = max(0, -E);
+
+    return vec3(E);
+}
+
+vec3 DirectLight(vec3 N, vec3 V, vec3 L, vec3 BaseColor, float Metalness, float Roughness) {
+    vec3 H = normalize(L + V);
+
+    // Lambert Diffuse BRDF
+    vec3 LambertBRDF = (BaseColor / PI) * (1 - Metalness);
+
+    // Cook Torrance Specular BRDF
+    vec3 CookBRDF = clamp(CookTorrance(N, V, H, L, BaseColor, Metalness, Roughness), 0, 1);
+
+    return (LambertBRDF + CookBRDF) * CosTheta(N, L);
+}
+
+vec3 PointLight(vec3 N, vec3 V, vec3 P, vec3 BaseColor, float Metalness, float Roughness) {
+    vec3 L = position - P;
+    float distance = dot(L, L);
+    if (distance > radius * radius)
+        return vec3(0);
+
+    float visibility = shadowSlot < 0 ? 1 : pointShadow(shadowSlot, L);
+
+    // Fade out the inverse square falloff towards the radius of the light volume
+    float fade = clamp(1 - pow(distance / (radius * radius), 2), 0, 1);
+    float Attenuation = fade * fade / distance;
+
+    return DirectLight(N, V, normalize(L), BaseColor, Metalness, Roughness) * color * Attenuation * visibility;
+}
+
+vec3 AreaLight(vec3 N, vec3 V, vec3 P, vec3 BaseColor, float Metalness, float Roughness) {
+    float theta = acos(dot(N, V)) / (PI * 0.5);
+    vec2 coords = vec2(Roughness, theta);
+    vec4 param = texture(matTex, coords);
+
+    mat3 M = mat3(vec3(param.x, 0, param.w), vec3(0, param.z, 0), vec3(param.y, 0, 1));
+    mat3 invMat = inverse(M);
+
+    vec3 Ed = Evaluate_LTC(N, V, P, mat3(1), vertices);
+    vec3 Es = Evaluate_LTC(N, V, P, invMat, vertices);
+
+    vec3 DiffColor = (BaseColor) * (1 - Metalness);
+    vec2 schlick = texture(ampTex, coords).xy;
+    vec3 SpecColor = mix(vec3(0.04), BaseColor, Metalness);
+
+    return (Ed * DiffColor + Es * (SpecColor*schlick.x + (1 - SpecColor) * schlick.y)) * color / (2.0 * PI);
+}
+
+/* Unfolds an octahedral normal from the G-buffer */
+vec3 decodeNormal(vec2 encoded) {
+    encoded = encoded * 2 - 1;
+    vec3 N = vec3(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-N.z, 0);
+    N.x += N.x >= 0 ? -fold : fold;
+    N.y += N.y >= 0 ? -fold : fold;
+    return normalize(N);
+}
+
+/* Reconstructs the world position of a pixel from the depth buffer */
+vec3 getWorldPosition(vec2 texCoords) {
+    float depth = texture(depthMap, texCoords).r;
+    vec4 P = invProjViewMatrix * vec4(vec3(texCoords, depth) * 2 - 1, 1);
+    return P.xyz / P.w;
+}
+
+void main() {
+    vec2 texCoords = gl_FragCoord.xy / windowSize;
+
+    vec4 arMap = texture(albedoMap, texCoords);
+    vec4 nmMap = texture(normalMap, texCoords);
+
+    vec3 BaseColor = toLinear(arMap.rgb);
+    float Roughness = arMap.w;
+    vec3 N = decodeNormal(nmMap.rg);
+    float Metalness = nmMap.b;
+    vec3 P = getWorldPosition(texCoords);
+
+    vec3 V = normalize(camPos - P);
+
+    if (lightType == POINT_LIGHT)
+        fragColor = vec4(PointLight(N, V, P, BaseColor, Metalness, Roughness), 0);
+    else
+        fragColor = vec4(AreaLight(N, V, P, BaseColor, Metalness, Roughness), 0);
+}
@@ -0,0 +1,33 @@
+#version 330 core
+
+out float fragDepth;
+
+uniform sampler2D depthMap;
+uniform ivec2 sourceSize;
+
+float fetchDepth(ivec2 coords) {
+    return texelFetch(depthMap, min(coords, sourceSize - 1), 0).r;
+}
+
+void main()
+{
+    // Keep the farthest depth of the 2x2 texels of the level above
+    ivec2 coords = ivec2(gl_FragCoord.xy) * 2;
+    float depth = max(max(fetchDepth(coords), fetchDepth(coords + ivec2(1, 0))),
+                      max(fetchDepth(coords + ivec2(0, 1)), fetchDepth(coords + ivec2(1, 1))));
+
+    // An odd sized level leaves a row or column over, which the last texel of this level covers
+    bool extraColumn = coords.x + 3 == sourceSize.x;
+    bool extraRow = coords.y + 3 == sourceSize.y;
+    if (extraColumn) {
+        depth = max(depth, max(fetchDepth(coords + ivec2(2, 0)), fetchDepth(coords + ivec2(2, 1))));
+    }
+    if (extraRow) {
+        depth = max(depth, max(fetchDepth(coords + ivec2(0, 2)), fetchDepth(coords + ivec2(1, 2))));
+    }
+    if (extraColumn && extraRow) {
+        depth = max(depth, fetchDepth(coords + ivec2(2, 2)));
+    }
+
+    fragDepth = depth;
+}
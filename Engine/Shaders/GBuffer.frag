@@ -1,15 +1,6 @@
 #version 330 core
 
-struct Material {
-    vec3 diffuseColor;
-    
-    sampler2D diffuseMap;
-    sampler2D normalMap;
-    sampler2D metalMap;
-    sampler2D roughnessMap;
-    sampler2D stencilMap;
-    sampler2D emissionMap;
-
+layout(std140) uniform MaterialBlock {
     vec3 emission;
     vec2 tiling;
 
@@ -19,13 +10,24 @@ struct Material {
     bool hasRoughnessMap;
     bool hasStencilMap;
     bool hasEmissionMap;
-};
-
-uniform mat4 modelMatrix;
+} material;
 
-uniform Material material;
+uniform sampler2D diffuseMap;
+uniform sampler2D normalMap;
+uniform sampler2D metalMap;
+uniform sampler2D roughnessMap;
+uniform sampler2D stencilMap;
+uniform sampler2D emissionMap;
 
-uniform vec3 camPos;
+layout(std140) uniform CameraBlock {
+    mat4 projMatrix;
+    mat4 viewMatrix;
+    mat4 projViewMatrix;
+    vec3 camPos;
+    float zNear;
+    float zFar;
+    mat4 invProjViewMatrix;
+};
 
 in vec3 pass_position;
 in vec2 pass_texCoords;
@@ -33,10 +35,9 @@ in vec3 pass_normal;
 in vec3 pass_tangent;
 in vec3 pass_worldPos;
 
-out vec4 fragColor;
-out vec4 fragNormal;
-out vec4 fragPosition;
-out vec4 fragEmission;
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec4 fragNormal;
+layout(location = 2) out vec4 fragEmission;
 
 /* Samples a tiled texture */
 vec4 sampleTiled(sampler2D tex, vec2 texCoords) {
@@ -46,15 +47,23 @@ vec4 sampleTiled(sampler2D tex, vec2 texCoords) {
 /* Calculates the normal of the fragment using a normal map */
 vec3 calcNormal(vec3 normal, vec3 tangent, vec2 texCoord) {
     vec3 bitangent = cross(normal, tangent);
-    vec3 mapNormal = sampleTiled(material.normalMap, texCoord).rgb * 2 - 1;
+    vec3 mapNormal = sampleTiled(normalMap, texCoord).rgb * 2 - 1;
     
     mat3 TBN = mat3(tangent, bitangent, normal);
     return normalize(TBN * mapNormal);
 }
 
+/* Folds the unit sphere onto an octahedron and unfolds it into the unit square */
+vec2 encodeNormal(vec3 N) {
+    N /= abs(N.x) + abs(N.y) + abs(N.z);
+    vec2 signs = vec2(N.x >= 0 ? 1 : -1, N.y >= 0 ? 1 : -1);
+    vec2 encoded = N.z >= 0 ? N.xy : (1 - abs(N.yx)) * signs;
+    return encoded * 0.5 + 0.5;
+}
+
 void main() {
     if (material.hasStencilMap) {
-        float Stencil = sampleTiled(material.stencilMap, pass_texCoords).r;
+        float Stencil = sampleTiled(stencilMap, pass_texCoords).r;
         if (Stencil < 0.5) {
             discard;
         }
@@ -64,37 +73,36 @@ void main() {
     vec3 N = pass_normal;
 
     if (material.hasNormalMap) {
-        N = calcNormal(N, pass_tangent, pass_texCoords);
+        N = calcNormal(normalize(N), normalize(pass_tangent), pass_texCoords);
     }
-    N = normalize((modelMatrix * vec4(N, 0))).xyz;
+    N = normalize(N);
     
     vec3 V = normalize(camPos - P);
     vec3 R = normalize(reflect(-V, N));
 
     float Metalness = 0;
     if (material.hasMetalMap) {
-        Metalness = sampleTiled(material.metalMap, pass_texCoords).r;
+        Metalness = sampleTiled(metalMap, pass_texCoords).r;
     }
     
     float Roughness = 1;
     if (material.hasRoughnessMap) {
-        Roughness = sampleTiled(material.roughnessMap, pass_texCoords).r;
+        Roughness = sampleTiled(roughnessMap, pass_texCoords).r;
     }
     
     // Base Color
     vec3 BaseColor = vec3(1);
     if (material.hasDiffuseMap) {
-        BaseColor = sampleTiled(material.diffuseMap, pass_texCoords).rgb;
+        BaseColor = sampleTiled(diffuseMap, pass_texCoords).rgb;
     }
     
     // Emission
     vec3 Emission = vec3(0);
     if (material.hasEmissionMap) {
-        Emission = sampleTiled(material.emissionMap, pass_texCoords).rgb * material.emission.r;
+        Emission = sampleTiled(emissionMap, pass_texCoords).rgb * material.emission.r;
     }
     
     fragColor = vec4(BaseColor, Roughness);
-    fragNormal = vec4(N * 0.5 + 0.5, Metalness);
-    fragPosition = vec4(P, 0);
+    fragNormal = vec4(encodeNormal(N), Metalness, 0);
     fragEmission = vec4(Emission, 0);
 }
@@ -6,10 +6,9 @@ in vec2 pass_texCoords;
 
 out vec4 fragColor;
 
-vec3 correctGamma(vec3 gammaColor) {
-    return pow(gammaColor, vec3(0.4545));
-}
+// Defined in Stages/GammaCorrection.frag, which is linked into this program
+vec3 correctGamma(vec3 color, vec2 texCoords);
 
 void main() {
-    fragColor = vec4(correctGamma(texture(tex, pass_texCoords).rgb), 1);
+    fragColor = vec4(correctGamma(texture(tex, pass_texCoords).rgb, pass_texCoords), 1);
 }
@@ -0,0 +1,19 @@
+#version 330 core
+
+layout(location = 0) in vec3 position;
+
+layout(std140) uniform CameraBlock {
+    mat4 projMatrix;
+    mat4 viewMatrix;
+    mat4 projViewMatrix;
+    vec3 camPos;
+    float zNear;
+    float zFar;
+    mat4 invProjViewMatrix;
+};
+
+uniform mat4 modelMatrix;
+
+void main() {
+    gl_Position = projViewMatrix * modelMatrix * vec4(position, 1);
+}
@@ -1,14 +1,27 @@
 #version 330 core
 
-uniform mat4 projMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 modelMatrix;
-uniform mat4 PVM;
+layout(std140) uniform CameraBlock {
+    mat4 projMatrix;
+    mat4 viewMatrix;
+    mat4 projViewMatrix;
+    vec3 camPos;
+    float zNear;
+    float zFar;
+    mat4 invProjViewMatrix;
+};
 
-layout(location = 0) in vec4 position;
+// Dequantization of the mesh positions and the world matrices of the instances
+// in the current batch, the array size must match MAX_DRAW_INSTANCES
+layout(std140) uniform DrawBlock {
+    vec4 positionScale;
+    vec4 positionOffset;
+    mat4 modelMatrices[255];
+};
+
+layout(location = 0) in vec3 position;
 layout(location = 1) in vec2 texCoords;
-layout(location = 2) in vec3 normal;
-layout(location = 3) in vec3 tangent;
+layout(location = 2) in vec2 normal;
+layout(location = 3) in vec4 tangent;
 
 out vec3 pass_position;
 out vec2 pass_texCoords;
@@ -16,12 +29,28 @@ out vec3 pass_normal;
 out vec3 pass_tangent;
 out vec3 pass_worldPos;
 
+// The depth pre-pass and the G-buffer fill both use this shader and must produce identical depths
+invariant gl_Position;
+
+/* Decodes a normal stored as an octahedral projection */
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0 ? 1 : -1, n.y >= 0 ? 1 : -1);
+    }
+    return normalize(n);
+}
+
 void main() {
-    pass_position = position.xyz;
+    mat4 modelMatrix = modelMatrices[gl_InstanceID];
+    vec3 objectPos = positionOffset.xyz + positionScale.xyz * position;
+    vec4 worldPos = modelMatrix * vec4(objectPos, 1);
+
+    pass_position = objectPos;
     pass_texCoords = texCoords;
-    pass_normal = normal;
-    pass_tangent = tangent;
-    pass_worldPos = (modelMatrix * position).xyz;
+    pass_normal = (modelMatrix * vec4(decodeOctahedral(normal), 0)).xyz;
+    pass_tangent = (modelMatrix * vec4(tangent.xyz, 0)).xyz;
+    pass_worldPos = worldPos.xyz;
 
-    gl_Position = PVM * position;
+    gl_Position = projViewMatrix * worldPos;
 }
@@ -0,0 +1,7 @@
+#version 330 core
+
+// Bounds are only drawn to count the samples passing the depth test
+void main()
+{
+
+}
@@ -0,0 +1,32 @@
+#version 330 core
+
+layout(std140) uniform CameraBlock {
+    mat4 projMatrix;
+    mat4 viewMatrix;
+    mat4 projViewMatrix;
+    vec3 camPos;
+    float zNear;
+    float zFar;
+    mat4 invProjViewMatrix;
+};
+
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+
+// Corners of the faces of the box, bits 0, 1 and 2 of a corner select the maximum x, y and z
+const int corners[36] = int[36](
+    0, 4, 6, 0, 6, 2,
+    1, 3, 7, 1, 7, 5,
+    0, 1, 5, 0, 5, 4,
+    2, 6, 7, 2, 7, 3,
+    0, 2, 3, 0, 3, 1,
+    4, 5, 7, 4, 7, 6
+);
+
+void main()
+{
+    int corner = corners[gl_VertexID];
+    vec3 select = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+
+    gl_Position = projViewMatrix * vec4(mix(boxMin, boxMax, select), 1);
+}
@@ -1,17 +1,22 @@
 #version 330 core
 
 uniform sampler2D normalMap;
-uniform sampler2D positionMap;
 uniform sampler2D depthMap;
 
 uniform sampler2D noiseMap;
 uniform vec3 kernel[32];
-uniform int kernelSize;
+// Interleaved subset of the kernel evaluated this frame
+uniform int sampleCount;
+uniform int sampleOffset;
+uniform int sampleStride;
+// Turns the noise every frame so accumulated frames sample different directions
+uniform float noiseRotation;
 
 uniform ivec2 windowSize;
 uniform vec3 camPos;
 uniform mat4 projMatrix;
 uniform mat4 viewMatrix;
+uniform mat4 invProjViewMatrix;
 
 in vec3 pass_position;
 in vec2 pass_texCoords;
@@ -30,13 +35,30 @@ mat3 CreateOrthonormalBasis(vec3 u, vec3 v)
     return mat3(tangent, bitangent, u);
 }
 
+/* Unfolds an octahedral normal from the G-buffer */
+vec3 decodeNormal(vec2 encoded) {
+    encoded = encoded * 2 - 1;
+    vec3 N = vec3(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-N.z, 0);
+    N.x += N.x >= 0 ? -fold : fold;
+    N.y += N.y >= 0 ? -fold : fold;
+    return normalize(N);
+}
+
+/* Reconstructs the world position of a pixel from the depth buffer */
+vec3 getWorldPosition(vec2 texCoords) {
+    float depth = texture(depthMap, texCoords).r;
+    vec4 P = invProjViewMatrix * vec4(vec3(texCoords, depth) * 2 - 1, 1);
+    return P.xyz / P.w;
+}
+
 void main() {
     float Depth = texture(depthMap, pass_texCoords).r;
     if (Depth == 1)
         discard;
 
-    vec3 P = texture(positionMap, pass_texCoords).rgb;
-    vec3 N = texture(normalMap, pass_texCoords).rgb * 2 - 1;
+    vec3 P = getWorldPosition(pass_texCoords);
+    vec3 N = decodeNormal(texture(normalMap, pass_texCoords).rg);
 
     vec3 V = normalize(camPos - P);
     
@@ -46,13 +68,15 @@ void main() {
     
     // Perform Gram-Schmidt process to determine orthonormal basis in normal direction
     vec3 rotation = texture(noiseMap, pass_texCoords * windowSize/4).xyz * 2.0 - 1.0;
+    float c = cos(noiseRotation), s = sin(noiseRotation);
+    rotation.xy = mat2(c, s, -s, c) * rotation.xy;
     mat3 TBN = CreateOrthonormalBasis(viewN, rotation);
     
     // Apply kernel
     float occlusion = 0.0;
     float radius = 0.01;
-    for (int i = 0; i < kernelSize; ++i) {
-        vec3 sample = TBN * (kernel[i]);
+    for (int i = 0; i < sampleCount; ++i) {
+        vec3 sample = TBN * (kernel[sampleOffset + i * sampleStride]);
         sample = sample + viewP;
 
         // Get the position of the sample in NDC
@@ -70,7 +94,8 @@ void main() {
         // If the sample is deeper than the depth at the sample position then it's occluded
         occlusion += float(depthKernel.z > sampleDepth) * rangeCheck;
     }
-    float visibility = 1.0 - (occlusion / kernelSize);
+    float visibility = 1.0 - (occlusion / sampleCount);
 
-    fragColor = vec4(vec3(visibility), 1);
+    // The view depth guides the accumulation and the upsampling
+    fragColor = vec4(visibility, -viewP.z, 0, 1);
 }
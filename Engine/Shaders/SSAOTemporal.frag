@@ -0,0 +1,58 @@
+#version 330 core
+
+// Occlusion and view depth of the current frame
+uniform sampler2D aoMap;
+// Accumulated occlusion, view depth and encoded normal of the previous frame
+uniform sampler2D historyMap;
+uniform sampler2D normalMap;
+uniform sampler2D depthMap;
+
+uniform mat4 invProjViewMatrix;
+uniform mat4 prevViewMatrix;
+uniform mat4 prevProjViewMatrix;
+uniform bool historyValid;
+uniform float feedback;
+
+in vec2 pass_texCoords;
+
+out vec4 fragColor;
+
+/* Unfolds an octahedral normal from the G-buffer */
+vec3 decodeNormal(vec2 encoded) {
+    encoded = encoded * 2 - 1;
+    vec3 N = vec3(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-N.z, 0);
+    N.x += N.x >= 0 ? -fold : fold;
+    N.y += N.y >= 0 ? -fold : fold;
+    return normalize(N);
+}
+
+void main() {
+    vec4 current = texture(aoMap, pass_texCoords);
+    vec2 normal = texture(normalMap, pass_texCoords).rg;
+    float depth = texture(depthMap, pass_texCoords).r;
+
+    float occlusion = current.r;
+
+    if (historyValid && depth < 1) {
+        // Find where the surface of the pixel was seen in the previous frame
+        vec4 P = invProjViewMatrix * vec4(vec3(pass_texCoords, depth) * 2 - 1, 1);
+        P /= P.w;
+        vec4 prevClip = prevProjViewMatrix * P;
+        vec2 prevCoords = prevClip.xy / prevClip.w * 0.5 + 0.5;
+        float prevDepth = -(prevViewMatrix * P).z;
+
+        if (all(greaterThanEqual(prevCoords, vec2(0))) && all(lessThanEqual(prevCoords, vec2(1)))) {
+            vec4 history = texture(historyMap, prevCoords);
+
+            // History of a different surface, revealed or moved, is discarded
+            bool sameDepth = abs(history.g - prevDepth) < 0.05 * prevDepth;
+            bool sameNormal = dot(decodeNormal(history.ba), decodeNormal(normal)) > 0.9;
+            if (sameDepth && sameNormal) {
+                occlusion = mix(current.r, history.r, feedback);
+            }
+        }
+    }
+
+    fragColor = vec4(occlusion, current.g, normal);
+}
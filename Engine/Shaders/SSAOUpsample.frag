@@ -0,0 +1,41 @@
+#version 330 core
+
+#define EPSILON 0.0001
+
+uniform sampler2D sourceTex;
+// Accumulated occlusion and view depth at half resolution
+uniform sampler2D aoMap;
+uniform sampler2D depthMap;
+
+uniform mat4 invProjMatrix;
+
+in vec2 pass_texCoords;
+
+out vec4 fragColor;
+
+void main() {
+    float depth = texture(depthMap, pass_texCoords).r;
+    vec4 viewP = invProjMatrix * vec4(vec3(pass_texCoords, depth) * 2 - 1, 1);
+    float viewDepth = -viewP.z / viewP.w;
+
+    // Bilinear weights of the four nearest half resolution texels, lowered where their depth differs
+    ivec2 size = textureSize(aoMap, 0);
+    vec2 coords = pass_texCoords * size - 0.5;
+    ivec2 base = ivec2(floor(coords));
+    vec2 f = fract(coords);
+
+    float occlusion = 0;
+    float weightSum = 0;
+    for (int i = 0; i < 4; i++) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        vec2 tap = texelFetch(aoMap, clamp(base + offset, ivec2(0), size - 1), 0).rg;
+
+        float bilinear = (offset.x == 1 ? f.x : 1 - f.x) * (offset.y == 1 ? f.y : 1 - f.y);
+        float weight = bilinear / (EPSILON + abs(viewDepth - tap.g) / viewDepth);
+        occlusion += tap.r * weight;
+        weightSum += weight;
+    }
+    occlusion = weightSum > 0 ? occlusion / weightSum : 1;
+
+    fragColor = vec4(texture(sourceTex, pass_texCoords).rgb * occlusion, 1);
+}
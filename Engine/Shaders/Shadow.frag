@@ -1,14 +1,7 @@
 #version 330 core
 
-struct Material {
-    vec3 diffuseColor;
-    
-    sampler2D diffuseMap;
-    sampler2D normalMap;
-    sampler2D metalMap;
-    sampler2D roughnessMap;
-    sampler2D stencilMap;
-
+layout(std140) uniform MaterialBlock {
+    vec3 emission;
     vec2 tiling;
 
     bool hasDiffuseMap;
@@ -16,9 +9,10 @@ struct Material {
     bool hasMetalMap;
     bool hasRoughnessMap;
     bool hasStencilMap;
-};
+    bool hasEmissionMap;
+} material;
 
-uniform Material material;
+uniform sampler2D stencilMap;
 
 in vec2 pass_texCoords;
 
@@ -30,7 +24,7 @@ vec4 sampleTiled(sampler2D tex, vec2 texCoords) {
 void main()
 {
     if (material.hasStencilMap) {
-        float Stencil = sampleTiled(material.stencilMap, pass_texCoords).r;
+        float Stencil = sampleTiled(stencilMap, pass_texCoords).r;
         if (Stencil < 0.5) {
             discard;
         }
@@ -0,0 +1,25 @@
+#version 330 core
+
+// Dequantization of the mesh positions and the world matrices of the instances
+// in the current batch, the array size must match MAX_DRAW_INSTANCES
+layout(std140) uniform DrawBlock {
+    vec4 positionScale;
+    vec4 positionOffset;
+    mat4 modelMatrices[255];
+};
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 texCoords;
+
+out vec2 geom_texCoords;
+flat out int geom_instance;
+
+void main() {
+    vec3 objectPos = positionOffset.xyz + positionScale.xyz * position;
+
+    geom_texCoords = texCoords;
+    geom_instance = gl_InstanceID;
+
+    // The geometry shader projects the world position onto every cubemap face
+    gl_Position = modelMatrices[gl_InstanceID] * vec4(objectPos, 1);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+uniform sampler3D lut;
+
+vec3 gradeColor(vec3 color, vec2 texCoords) {
+    color = color.rbg;
+    if (color.r > 1 || color.g > 1 || color.b > 1 || color.r < 0 || color.g < 0 || color.b < 0) {
+        return vec3(1, 0, 1);
+    }
+
+    return texture(lut, color).rgb;
+}
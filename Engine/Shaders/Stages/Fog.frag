@@ -0,0 +1,20 @@
+#version 330 core
+
+uniform sampler2D depthMap;
+
+uniform float zNear;
+uniform float zFar;
+uniform vec3 fogColor;
+
+vec3 applyFog(vec3 radiance, vec2 texCoords) {
+    float z = texture(depthMap, texCoords).r;
+    float n = zNear;
+    float f = zFar;
+    float depth = (2 * n) / (f + n - z * (f - n));
+
+    if (z > 0.9999) {
+        return radiance;
+    }
+
+    return mix(radiance, fogColor, clamp(depth*2, 0, 1));
+}
@@ -0,0 +1,5 @@
+#version 330 core
+
+vec3 correctGamma(vec3 gammaColor, vec2 texCoords) {
+    return pow(gammaColor, vec3(0.4545));
+}
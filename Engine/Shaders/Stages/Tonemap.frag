@@ -0,0 +1,26 @@
+#version 330 core
+
+uniform int tonemapper;
+uniform float exposure;
+
+vec3 reinhardToneMapping(vec3 color, float exposure)
+{
+    color *= exposure / ((color / exposure) + 1);
+    return color;
+}
+
+vec3 filmicToneMapping(vec3 color)
+{
+    color = max(vec3(0), color - vec3(0.004));
+    color = (color * (6.2 * color + 0.5)) / (color * (6.2 * color + 1.7) + 0.06);
+    return color;
+}
+
+vec3 tonemap(vec3 radiance, vec2 texCoords) {
+    switch(tonemapper)
+    {
+    case 0: return reinhardToneMapping(radiance, exposure);
+    case 1: return filmicToneMapping(radiance);
+    }
+    return radiance;
+}
@@ -6,10 +6,15 @@
 #include <GDT/Vector3f.h>
 
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
 namespace Flux {
     class AreaLight : public Component {
     public:
+        static const ComponentType TYPE = ComponentType::AreaLight;
+
         AreaLight()
             : energy(DEFAULT_ENERGY)
             , color(1, 1, 1)
@@ -20,7 +25,25 @@ namespace Flux {
             vertices.push_back(Vector3f(-1, 1, 0));
         }
 
-        const float DEFAULT_ENERGY = 1.0f;
+        /** Radius of a sphere around the light center beyond which it contributes less than the cutoff */
+        float getRadius(const std::vector<Vector3f>& worldVertices, float cutoff) const {
+            Vector3f center(0, 0, 0);
+            for (const Vector3f& vertex : worldVertices) {
+                center += vertex;
+            }
+            center /= (float) worldVertices.size();
+            float extent = 0;
+            for (const Vector3f& vertex : worldVertices) {
+                extent = std::max(extent, (vertex - center).length());
+            }
+
+            // A small emitter of the given area falls off roughly with its form factor, area / (pi * d^2)
+            float area = GDT::cross(worldVertices[1] - worldVertices[0], worldVertices[3] - worldVertices[0]).length();
+            float intensity = std::max(color.x, std::max(color.y, color.z)) * energy;
+            return extent + std::sqrt(intensity * area / (3.14159265f * cutoff));
+        }
+
+        static constexpr float DEFAULT_ENERGY = 1.0f;
 
         Vector3f color;
         float energy;
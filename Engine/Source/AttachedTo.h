@@ -1,12 +1,18 @@
 #pragma once
 
 #include "Component.h"
+#include "EntityHandle.h"
 
 namespace Flux {
     class AttachedTo : public Component {
     public:
+        static const ComponentType TYPE = ComponentType::AttachedTo;
+
         AttachedTo(uint32_t parentId) : parentId(parentId) { }
 
+        // Identifier of the parent as stored in the scene file
         uint32_t parentId;
+        // Runtime handle of the parent, resolved once the scene is loaded
+        EntityHandle parent;
     };
 }
@@ -24,6 +24,8 @@ using GDT::Matrix4f;
 namespace Flux {
     class Camera : public Component {
     public:
+        static const ComponentType TYPE = ComponentType::Camera;
+
         Camera();
         Camera(float left, float right, float bottom, float top, float zNear, float zFar);
         Camera(float fovy, float aspect, float zNear, float zFar);
@@ -49,16 +51,16 @@ namespace Flux {
         void setBounds(float left, float right, float bottom, float top);
 
     private:
-        const bool DEFAULT_PERSPECTIVE = true;
-        const float DEFAULT_FOVY = 90;
-        const float DEFAULT_ASPECT = 1;
-        const float DEFAULT_ZNEAR = 0.1f;
-        const float DEFAULT_ZFAR = 100;
+        static constexpr bool DEFAULT_PERSPECTIVE = true;
+        static constexpr float DEFAULT_FOVY = 90;
+        static constexpr float DEFAULT_ASPECT = 1;
+        static constexpr float DEFAULT_ZNEAR = 0.1f;
+        static constexpr float DEFAULT_ZFAR = 100;
 
-        const float DEFAULT_LEFT = -1;
-        const float DEFAULT_RIGHT = 1;
-        const float DEFAULT_BOTTOM = -1;
-        const float DEFAULT_TOP = 1;
+        static constexpr float DEFAULT_LEFT = -1;
+        static constexpr float DEFAULT_RIGHT = 1;
+        static constexpr float DEFAULT_BOTTOM = -1;
+        static constexpr float DEFAULT_TOP = 1;
 
         bool perspective = DEFAULT_PERSPECTIVE;
         float fovy = DEFAULT_FOVY;
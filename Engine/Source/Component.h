@@ -12,6 +12,23 @@
 #pragma once
 
 namespace Flux {
+    /**
+     * Compile-time identifiers of the component types stored in the
+     * component registry. Every component class exposes its identifier
+     * through a static TYPE member so lookups never need RTTI.
+     */
+    enum class ComponentType {
+        Transform,
+        Mesh,
+        MeshRenderer,
+        Camera,
+        AttachedTo,
+        PointLight,
+        DirectionalLight,
+        AreaLight,
+        Count
+    };
+
     class Component {
     public:
         virtual ~Component() { }
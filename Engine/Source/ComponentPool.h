@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace Flux {
+    const uint32_t INVALID_COMPONENT = 0xFFFFFFFF;
+
+    /**
+     * Type-independent part of a component pool. Keeps track of which
+     * entities own a component so that views can intersect pools
+     * without knowing their component types.
+     */
+    class BaseComponentPool {
+    public:
+        virtual ~BaseComponentPool() { }
+
+        virtual void remove(uint32_t entity) = 0;
+
+        bool has(uint32_t entity) const {
+            return entity < sparse.size() && sparse[entity] != INVALID_COMPONENT;
+        }
+
+        size_t size() const {
+            return owners.size();
+        }
+
+        const std::vector<uint32_t>& getEntities() const {
+            return owners;
+        }
+
+    protected:
+        // Entity index of every packed component
+        std::vector<uint32_t> owners;
+        // Maps an entity index to the position of its component in the packed array
+        std::vector<uint32_t> sparse;
+    };
+
+    /**
+     * Stores all components of a single type contiguously in memory.
+     * Components are addressed by entity index in O(1) through a sparse
+     * lookup table, and removal swaps the last component into the hole
+     * so the packed array never contains gaps.
+     */
+    template <class T>
+    class ComponentPool : public BaseComponentPool {
+    public:
+        template <class... Args>
+        T& add(uint32_t entity, Args&&... args) {
+            if (has(entity)) {
+                T& component = components[sparse[entity]];
+                component = T(std::forward<Args>(args)...);
+                return component;
+            }
+
+            if (entity >= sparse.size()) {
+                sparse.resize(entity + 1, INVALID_COMPONENT);
+            }
+            sparse[entity] = (uint32_t) components.size();
+            owners.push_back(entity);
+            components.emplace_back(std::forward<Args>(args)...);
+
+            return components.back();
+        }
+
+        void remove(uint32_t entity) override {
+            if (!has(entity))
+                return;
+
+            const uint32_t index = sparse[entity];
+            const uint32_t last = (uint32_t) components.size() - 1;
+
+            if (index != last) {
+                components[index] = std::move(components[last]);
+                owners[index] = owners[last];
+                sparse[owners[index]] = index;
+            }
+
+            components.pop_back();
+            owners.pop_back();
+            sparse[entity] = INVALID_COMPONENT;
+        }
+
+        T& get(uint32_t entity) {
+            return components[sparse[entity]];
+        }
+
+        T* tryGet(uint32_t entity) {
+            return has(entity) ? &components[sparse[entity]] : nullptr;
+        }
+
+        T* data() {
+            return components.data();
+        }
+
+    private:
+        std::vector<T> components;
+    };
+}
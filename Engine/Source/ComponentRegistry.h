@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Component.h"
+#include "ComponentPool.h"
+#include "EntityHandle.h"
+
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace Flux {
+    /**
+     * Iterates over every entity that owns all of the given component types.
+     * The smallest of the involved pools drives the iteration, the remaining
+     * pools are only probed through their sparse lookup tables.
+     */
+    template <class... Ts>
+    class View {
+    public:
+        View(ComponentPool<Ts>&... componentPools)
+        :   pools(&componentPools...)
+        ,   bases{ &componentPools... }
+        {
+
+        }
+
+        /**
+         * Calls func(entity, components...) for every matching entity.
+         * Components must not be added to or removed from the involved
+         * pools while iterating.
+         */
+        template <class Func>
+        void each(Func func) const {
+            const BaseComponentPool* driver = bases[0];
+            for (const BaseComponentPool* pool : bases) {
+                if (pool->size() < driver->size()) {
+                    driver = pool;
+                }
+            }
+
+            for (uint32_t entity : driver->getEntities()) {
+                if (!containsAll(entity))
+                    continue;
+
+                func(entity, std::get<ComponentPool<Ts>*>(pools)->get(entity)...);
+            }
+        }
+
+    private:
+        bool containsAll(uint32_t entity) const {
+            for (const BaseComponentPool* pool : bases) {
+                if (!pool->has(entity)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::tuple<ComponentPool<Ts>*...> pools;
+        const BaseComponentPool* bases[sizeof...(Ts)];
+    };
+
+    /**
+     * Owns one packed pool per component type and hands out entity handles.
+     * Entity slots form a slot map: freed indices are recycled with a new
+     * generation so stale handles can be detected in O(1).
+     */
+    class ComponentRegistry {
+    public:
+        EntityHandle createEntity() {
+            if (!freeIndices.empty()) {
+                uint32_t index = freeIndices.back();
+                freeIndices.pop_back();
+                return EntityHandle(index, generations[index]);
+            }
+
+            generations.push_back(0);
+            return EntityHandle((uint32_t) generations.size() - 1, 0);
+        }
+
+        /** Removes all components of the entity and invalidates every handle to it */
+        void destroyEntity(EntityHandle handle) {
+            if (!isValid(handle))
+                return;
+
+            for (std::unique_ptr<BaseComponentPool>& pool : pools) {
+                if (pool) {
+                    pool->remove(handle.index);
+                }
+            }
+
+            generations[handle.index]++;
+            freeIndices.push_back(handle.index);
+        }
+
+        bool isValid(EntityHandle handle) const {
+            return handle.index < generations.size() && generations[handle.index] == handle.generation;
+        }
+
+        template <class T>
+        ComponentPool<T>& getPool() {
+            std::unique_ptr<BaseComponentPool>& pool = pools[static_cast<size_t>(T::TYPE)];
+
+            if (!pool) {
+                pool.reset(new ComponentPool<T>());
+            }
+            return static_cast<ComponentPool<T>&>(*pool);
+        }
+
+        template <class... Ts>
+        View<Ts...> view() {
+            return View<Ts...>(getPool<Ts>()...);
+        }
+
+    private:
+        std::vector<uint32_t> generations;
+        std::vector<uint32_t> freeIndices;
+
+        std::unique_ptr<BaseComponentPool> pools[static_cast<size_t>(ComponentType::Count)];
+    };
+}
@@ -4,7 +4,6 @@
 
 #include "Transform.h"
 #include "Camera.h"
-#include "AttachedTo.h"
 #include "MeshRenderer.h"
 #include "AssetManager.h"
 #include "TextureUnit.h"
@@ -18,8 +17,14 @@
 #include "PointLight.h"
 #include "Util/Path.h"
 #include "Util/Size.h"
+#include "Util/Frustum.h"
+#include "Util/Math.h"
 
 #include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <thread>
 
 #include <GDT/Matrix4f.h>
 #include "nvToolsExt.h"
@@ -37,8 +42,94 @@ namespace Flux {
         gBufferShader.loadFromFile("res/Shaders/Model.vert", "res/Shaders/GBuffer.frag");
         shadowShader.loadFromFile("res/Shaders/Model.vert", "res/Shaders/Shadow.frag");
         textureShader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/Texture.frag");
+        boundsShader.loadFromFile("res/Shaders/OcclusionBox.vert", "res/Shaders/OcclusionBox.frag");
 
-        createShadowMaps(scene);
+        for (ShaderProgram* shader : { &gBufferShader, &shadowShader }) {
+            RenderState::useProgram(*shader);
+            UniformBuffer::bindCurrentProgramBlock("CameraBlock", CAMERA_BLOCK);
+            UniformBuffer::bindCurrentProgramBlock("DrawBlock", DRAW_BLOCK);
+            Material::setTextureUnits(*shader);
+        }
+        drawBuffer.create();
+
+        cubeShadowShader.addShader(GDT::VERTEX, "res/Shaders/ShadowCube.vert");
+        cubeShadowShader.addShader(GDT::GEOMETRY, "res/Shaders/ShadowCube.geom");
+        cubeShadowShader.addShader(GDT::FRAGMENT, "res/Shaders/Shadow.frag");
+        cubeShadowShader.build();
+
+        RenderState::useProgram(cubeShadowShader);
+        UniformBuffer::bindCurrentProgramBlock("DrawBlock", DRAW_BLOCK);
+        UniformBuffer::bindCurrentProgramBlock("FaceBlock", FACE_BLOCK);
+        UniformBuffer::bindCurrentProgramBlock("CubeBlock", CUBE_BLOCK);
+        Material::setTextureUnits(cubeShadowShader);
+        faceBuffer.create();
+        cubeBuffer.create();
+        cubeBuffer.setData(sizeof(CubeUniforms), nullptr, GL_DYNAMIC_DRAW);
+
+        RenderState::useProgram(boundsShader);
+        UniformBuffer::bindCurrentProgramBlock("CameraBlock", CAMERA_BLOCK);
+        glGenVertexArrays(1, &boundsVao);
+
+        gBufferState.addCapability(STENCIL_TEST, true);
+        gBufferState.addCapability(DEPTH_TEST, true);
+        gBufferState.addCapability(POLYGON_OFFSET, false);
+        gBufferState.addCapability(FACE_CULLING, true);
+        gBufferState.setDepthFunc(GL_LESS);
+        gBufferState.setDepthMask(true);
+        gBufferState.setColorMask(true);
+        gBufferState.setStencilMask(0xFF);
+        gBufferState.setStencilFunc(GL_ALWAYS, 1, 0xFF);
+        gBufferState.setStencilOp(GL_KEEP, GL_REPLACE, GL_REPLACE);
+
+        depthPrepassState.addCapability(STENCIL_TEST, false);
+        depthPrepassState.addCapability(DEPTH_TEST, true);
+        depthPrepassState.addCapability(POLYGON_OFFSET, false);
+        depthPrepassState.setDepthFunc(GL_LESS);
+        depthPrepassState.setDepthMask(true);
+        depthPrepassState.setColorMask(false);
+
+        // Both passes transform positions with Model.vert, whose invariant output makes the depths match exactly
+        gBufferEqualState.addCapability(STENCIL_TEST, true);
+        gBufferEqualState.addCapability(DEPTH_TEST, true);
+        gBufferEqualState.setDepthFunc(GL_EQUAL);
+        gBufferEqualState.setDepthMask(false);
+        gBufferEqualState.setColorMask(true);
+
+        glGenQueries(PREPASS_QUERY_COUNT, prepassQueries);
+
+        // The bounds may enclose the camera, so the faces behind it have to count as well
+        occlusionQueryState.addCapability(STENCIL_TEST, false);
+        occlusionQueryState.addCapability(DEPTH_TEST, true);
+        occlusionQueryState.addCapability(FACE_CULLING, false);
+        occlusionQueryState.addCapability(POLYGON_OFFSET, false);
+        occlusionQueryState.setDepthFunc(GL_LEQUAL);
+        occlusionQueryState.setDepthMask(false);
+        occlusionQueryState.setColorMask(false);
+
+        // A few workers are enough for the low resolution of the occlusion buffer, the render thread helps as well
+        const unsigned int occlusionWorkers = std::min(std::max(std::thread::hardware_concurrency(), 1u) - 1, 3u);
+        occlusionRasterizer.create(OcclusionRasterizer::DEFAULT_WIDTH, OcclusionRasterizer::DEFAULT_HEIGHT, occlusionWorkers);
+
+        shadowState.addCapability(DEPTH_TEST, true);
+        shadowState.addCapability(POLYGON_OFFSET, true);
+        shadowState.setDepthFunc(GL_LESS);
+        shadowState.setDepthMask(true);
+        shadowState.setColorMask(false);
+        shadowState.setPolygonOffset(2.5f, 10.0f);
+        // Scissoring would also restrict the copies of cached shadow layers
+        shadowState.addCapability(SCISSOR_TEST, false);
+
+        if (packedGeometry) {
+            scene.view<Mesh>().each([&](uint32_t, Mesh& mesh) {
+                meshPool.add(mesh);
+            });
+            meshPool.upload();
+        }
+
+        scene.view<DirectionalLight>().each([&](uint32_t, DirectionalLight& dirLight) {
+            dirLight.cascadeCount = std::min(std::max(dirLight.cascadeCount, 1u), DirectionalLight::MAX_CASCADES);
+        });
+        shadowAtlas.create(shadowBudget, staticShadowCache);
 
         std::unique_ptr<TonemapPass> toneMapPass = std::make_unique<TonemapPass>();
         std::unique_ptr<IndirectLightPass> indirectLightPass = std::make_unique<IndirectLightPass>(scene);
@@ -48,6 +139,7 @@ namespace Flux {
         indirectLightPass->SetGBuffer(&gBuffer);
         ssaoPass->SetGBuffer(&gBuffer);
         directLightPass->SetGBuffer(&gBuffer);
+        directLightPass->SetShadowAtlas(&shadowAtlas);
 
         addHdrPass(std::move(indirectLightPass));
         addHdrPass(std::move(ssaoPass));
@@ -57,58 +149,17 @@ namespace Flux {
 
         renderState.enable(FACE_CULLING);
 
-        renderShadowMaps(scene);
+        // Shadows are first rendered by update, once the window size is known to pack the atlas for
+        updateBounds(scene);
 
         return true;
     }
 
-    void DeferredRenderer::createBackBuffers(const unsigned int width, const unsigned int height) {
-        hdrBuffer.create();
-        hdrBuffer.bind();
-        hdrBuffer.addColorTexture(0, createHdrTexture(width, height));
-        hdrBuffer.addColorTexture(1, createHdrTexture(width, height));
-        hdrBuffer.addDepthStencilTexture(gBuffer.depthTex);
-        hdrBuffer.validate();
-        hdrBuffer.release();
-
-        ldrBuffer.create();
-        ldrBuffer.bind();
-        ldrBuffer.addColorTexture(0, createLdrTexture(width, height));
-        ldrBuffer.addColorTexture(1, createLdrTexture(width, height));
-        ldrBuffer.validate();
-        ldrBuffer.release();
-    }
-
-    void DeferredRenderer::createShadowMaps(const Scene& scene) {
-        for (Entity* entity : scene.lights) {
-            Transform& t = entity->getComponent<Transform>();
-            Camera& camera = entity->getComponent<Camera>();
-
-            if (entity->hasComponent<DirectionalLight>()) {
-                DirectionalLight& dirLight = entity->getComponent<DirectionalLight>();
-                dirLight.shadowBuffer.create();
-                dirLight.shadowBuffer.bind();
-                dirLight.shadowBuffer.disableColor();
-                dirLight.shadowBuffer.release();
-                dirLight.shadowMap = createShadowMap(4096, 4096);
-            }
-            if (entity->hasComponent<PointLight>()) {
-                PointLight& pointLight = entity->getComponent<PointLight>();
-                pointLight.shadowBuffer.create();
-                pointLight.shadowBuffer.bind();
-                pointLight.shadowBuffer.disableColor();
-                pointLight.shadowBuffer.release();
-
-                pointLight.shadowMap = createShadowCubemap(512);
-            }
-        }
-    }
-
     void DeferredRenderer::onResize(const Size windowSize) {
         this->windowSize.setSize(windowSize.width, windowSize.height);
 
         gBuffer.create(windowSize.width, windowSize.height);
-        createBackBuffers(windowSize.width, windowSize.height);
+        depthPyramid.create(windowSize.width, windowSize.height);
 
         for (const std::unique_ptr<RenderPhase>& renderPass : getHdrPasses()) {
             renderPass->Resize(windowSize);
@@ -116,6 +167,10 @@ namespace Flux {
         for (const std::unique_ptr<RenderPhase>& renderPass : getLdrPasses()) {
             renderPass->Resize(windowSize);
         }
+        getToneMapPass().Resize(windowSize);
+
+        // Targets of the previous size are destroyed once the graph is rebuilt
+        renderGraphDirty = true;
     }
 
     void DeferredRenderer::update(const Scene& scene) {
@@ -129,212 +184,914 @@ namespace Flux {
         if (scene.getMainCamera() == nullptr)
             return;
 
+        cullStats.clear();
+        drawStats = DrawStats();
+        RenderState::resetStats();
+        updateBounds(scene);
+
         renderShadowMaps(scene);
 
         renderGBuffer(scene);
 
-        // HDR Rendering
-        hdrBuffer.bind();
+        // HDR and LDR passes
+        if (isRenderGraphDirty()) {
+            const unsigned int width = windowSize.width;
+            const unsigned int height = windowSize.height;
+            buildRenderGraph(
+                RenderTargetDesc(width, height, GL_RGBA16F, LINEAR, 1, gBuffer.depthTex.getHandle()),
+                RenderTargetDesc(width, height, GL_RGBA8, NEAREST));
+        }
+        renderGraph.execute(renderState, scene);
+
+        renderFramebuffer(renderGraph.getFramebuffer(graphOutput));
+    }
+
+    void DeferredRenderer::updateBounds(const Scene& scene) {
+        sceneBounds = AABB(Vector3f(INFINITY, INFINITY, INFINITY), Vector3f(-INFINITY, -INFINITY, -INFINITY));
+
+        scene.view<Transform, Mesh>().each([&](uint32_t entity, Transform&, Mesh& mesh) {
+            if (entity >= worldBounds.size()) {
+                worldBounds.resize(entity + 1);
+                worldSpheres.resize(entity + 1);
+            }
+            const Matrix4f& worldMatrix = scene.getWorldMatrix(entity);
+
+            worldBounds[entity] = mesh.bounds.transform(worldMatrix);
+            worldSpheres[entity] = mesh.boundingSphere.transform(worldMatrix);
+
+            const AABB& bounds = worldBounds[entity];
+            sceneBounds.min.set(std::min(sceneBounds.min.x, bounds.min.x), std::min(sceneBounds.min.y, bounds.min.y), std::min(sceneBounds.min.z, bounds.min.z));
+            sceneBounds.max.set(std::max(sceneBounds.max.x, bounds.max.x), std::max(sceneBounds.max.y, bounds.max.y), std::max(sceneBounds.max.z, bounds.max.z));
+        });
+    }
+
+    void DeferredRenderer::cullScene(const Scene& scene, const char* view, uint32_t viewEntity, int face) {
+        nvtxRangePushA("Cull");
+
+        Frustum frustum(renderState.projMatrix * renderState.viewMatrix);
+        CullStats stats = { view, viewEntity, face, 0, 0 };
+
+        visibleEntities.clear();
+        scene.view<Transform, Mesh, MeshRenderer>().each([&](uint32_t entity, Transform&, Mesh&, MeshRenderer&) {
+            if (isVisible(frustum, entity)) {
+                visibleEntities.push_back(entity);
+                stats.visible++;
+            } else {
+                stats.culled++;
+            }
+        });
+        cullStats.push_back(stats);
+
+        nvtxRangePop();
+    }
+
+    void DeferredRenderer::cullCube(const Scene& scene, uint32_t viewEntity, const Matrix4f faceMatrices[6]) {
+        nvtxRangePushA("Cull");
+
+        Frustum frustums[6];
+        CullStats stats[6];
+        for (int i = 0; i < 6; i++) {
+            frustums[i] = Frustum(faceMatrices[i]);
+            stats[i] = { "Point light", viewEntity, i, 0, 0 };
+        }
+
+        // Remember which faces every mesh overlaps, so it is only emitted to those
+        visibleEntities.clear();
+        scene.view<Transform, Mesh, MeshRenderer>().each([&](uint32_t entity, Transform&, Mesh&, MeshRenderer&) {
+            uint32_t mask = 0;
+            for (int i = 0; i < 6; i++) {
+                if (isVisible(frustums[i], entity)) {
+                    mask |= 1u << i;
+                    stats[i].visible++;
+                } else {
+                    stats[i].culled++;
+                }
+            }
+
+            if (entity >= faceMasks.size()) {
+                faceMasks.resize(entity + 1);
+            }
+            faceMasks[entity] = mask;
+
+            if (mask != 0) {
+                visibleEntities.push_back(entity);
+            }
+        });
+        cullStats.insert(cullStats.end(), stats, stats + 6);
+
+        nvtxRangePop();
+    }
+
+    void DeferredRenderer::cullOccluded(const Scene& scene) {
+        nvtxRangePushA("Occlusion Cull");
+
+        occlusionCandidates.clear();
+
+        if (occlusionCulling == OCCLUSION_RASTERIZER) {
+            // Occluders outside the frustum cover no pixels of the view
+            bool hasOccluders = false;
+            occlusionRasterizer.clear(renderState.projMatrix * renderState.viewMatrix);
+            for (uint32_t entity : visibleEntities) {
+                if (!scene.getComponent<MeshRenderer>(entity)->isOccluder)
+                    continue;
+
+                const Mesh* mesh = scene.getComponent<Mesh>(entity);
+                occlusionRasterizer.addOccluder(mesh->vertices, mesh->indices, scene.getWorldMatrix(entity));
+                hasOccluders = true;
+            }
+
+            if (hasOccluders) {
+                const size_t count = visibleEntities.size();
+                occlusionRasterizer.rasterize();
+                occlusionRasterizer.cull(visibleEntities, worldBounds);
+
+                // The result is final, so occluded meshes count as culled for the camera
+                CullStats& stats = cullStats.back();
+                stats.visible -= (uint32_t) (count - visibleEntities.size());
+                stats.culled += (uint32_t) (count - visibleEntities.size());
+            }
+
+            nvtxRangePop();
+            return;
+        }
+
+        depthPyramid.update();
+
+        // Meshes that may be visible keep their order, hidden ones wait for their query
+        size_t visibleCount = 0;
+        for (uint32_t entity : visibleEntities) {
+            if (depthPyramid.isOccluded(worldBounds[entity])) {
+                occlusionCandidates.push_back(entity);
+            } else {
+                visibleEntities[visibleCount++] = entity;
+            }
+        }
+        visibleEntities.resize(visibleCount);
+        drawStats.occlusionQueries += (uint32_t) occlusionCandidates.size();
 
-        for (const auto& renderPass : getHdrPasses()) {
-            renderPass->SetSource(&hdrBuffer.getTexture());
-            hdrBuffer.setDrawBuffer(1 - hdrBuffer.getDrawBuffer());
+        nvtxRangePop();
+    }
+
+    bool DeferredRenderer::isVisible(const Frustum& frustum, uint32_t entity) const {
+        const BoundingSphere& sphere = worldSpheres[entity];
+
+        // The sphere test is cheap and settles most meshes, only straddling ones test their box
+        return frustum.contains(sphere) || (frustum.intersects(sphere) && frustum.intersects(worldBounds[entity]));
+    }
 
-            renderPass->render(renderState, scene);
+    uint32_t DeferredRenderer::getShaderKey(const ShaderProgram& shader) {
+        for (uint32_t i = 0; i < shaderKeys.size(); i++) {
+            if (shaderKeys[i] == &shader)
+                return i;
         }
+        shaderKeys.push_back(&shader);
+        return (uint32_t) shaderKeys.size() - 1;
+    }
+
+    void DeferredRenderer::setLodView(float viewportHeight, float bias) {
+        // Vertical projection scale maps view space to normalized device coordinates, the viewport to pixels
+        const float threshold = lodThreshold * bias;
+        lodScale = threshold > 0 ? renderState.projMatrix[5] * viewportHeight * 0.5f / threshold : 0;
+        lodPerspective = renderState.projMatrix[11] != 0;
+    }
 
-        // Tonemap Pass
-        ldrBuffer.bind();
-        getToneMapPass().SetSource(&hdrBuffer.getTexture());
-        getToneMapPass().render(renderState, scene);
+    uint32_t DeferredRenderer::selectLod(const Mesh& mesh, uint32_t entity, const Vector3f& viewCenter) const {
+        if (mesh.lods.empty() || lodScale <= 0)
+            return 0;
 
-        // LDR Rendering
-        for (const auto& renderPass : getLdrPasses()) {
-            renderPass->SetSource(&ldrBuffer.getTexture());
-            ldrBuffer.setDrawBuffer(1 - ldrBuffer.getDrawBuffer());
+        // Errors are stored in object space, the bounding spheres tell how much the entity scales them
+        const BoundingSphere& sphere = worldSpheres[entity];
+        float scale = mesh.boundingSphere.radius > 0 ? lodScale * sphere.radius / mesh.boundingSphere.radius : lodScale;
 
-            renderPass->render(renderState, scene);
+        // Distance to the nearest point of the sphere, independent of the view direction so all cube faces agree
+        if (lodPerspective) {
+            const float distance = viewCenter.length() - sphere.radius;
+            if (distance <= 0)
+                return 0;
+            scale /= distance;
         }
 
-        renderFramebuffer(ldrBuffer);
+        // Errors grow along the chain, take the last level that stays within the threshold
+        uint32_t lod = 0;
+        while (lod < mesh.lods.size() && mesh.lods[lod].error * scale <= 1) {
+            lod++;
+        }
+        return lod;
     }
 
     void DeferredRenderer::renderScene(const Scene& scene, ShaderProgram& shader) {
-        for (Entity* e : scene.entities) {
-            if (!e->hasComponent<Mesh>())
+        renderScene(scene, shader, false);
+    }
+
+    void DeferredRenderer::renderScene(const Scene& scene, ShaderProgram& shader, bool positionsOnly, bool layered, bool frontToBack, bool conditional) {
+        nvtxRangePushA("Draw List");
+
+        const uint32_t shaderKey = getShaderKey(shader);
+
+        drawList.clear();
+        for (uint32_t entity : visibleEntities) {
+            const Mesh* mesh = scene.getComponent<Mesh>(entity);
+            const MeshRenderer* mr = scene.getComponent<MeshRenderer>(entity);
+
+            const Vector3f center = renderState.viewMatrix.transform(worldSpheres[entity].center, 1);
+            const float depth = -center.z;
+            const uint32_t lod = selectLod(*mesh, entity, center);
+            uint64_t key = frontToBack
+                ? DrawList::makeDepthKey(mr->materialID, mesh->handle, depth)
+                : DrawList::makeKey(shaderKey, mr->materialID, mesh->handle, lod, depth);
+
+            drawList.add(DrawCommand{ key, entity, mr->materialID, mesh, lod });
+        }
+        drawList.sort();
+
+        // Conditional draws depend on the query of their own mesh, so every instance is drawn on its own
+        buildBatches(scene, layered, conditional ? 1 : MAX_DRAW_INSTANCES);
+
+        nvtxRangePop();
+
+        const Material* boundMaterial = nullptr;
+
+        for (const DrawBatch& batch : batches) {
+            const Material* material = scene.materials[batch.materialID];
+
+            // Count the work of binding and releasing the material and setting the matrices by name for
+            // every instance, then subtract what is actually done. The uniform blocks that replace those
+            // writes are bound once per material change and once per batch, each bind counts as one write.
+            unsigned int textureCount = material->getTextureCount();
+            drawStats.textureBindsSaved += textureCount * batch.instanceCount;
+            drawStats.uniformWritesSaved += (2 * textureCount + 10) * batch.instanceCount;
+            drawStats.materialBindsSaved += batch.instanceCount;
+
+            if (material != boundMaterial) {
+                material->bind();
+                boundMaterial = material;
+
+                drawStats.materialBinds++;
+                drawStats.materialBindsSaved--;
+                drawStats.textureBindsSaved -= textureCount;
+                drawStats.uniformWritesSaved--;
+            }
+
+            drawBuffer.bindRange(DRAW_BLOCK, batch.offset, DRAW_BLOCK_SIZE);
+            drawStats.uniformWritesSaved--;
+            if (layered) {
+                faceBuffer.bindRange(FACE_BLOCK, batch.faceOffset, FACE_BLOCK_SIZE);
+                drawStats.uniformWritesSaved--;
+            }
+
+            if (conditional) {
+                glBeginConditionalRender(occlusionQueries[entityQueries[batch.entity]], GL_QUERY_WAIT);
+            }
+
+            // Alpha tested materials still need their texture coordinates in depth only passes
+            if (positionsOnly && !material->stencilTex.isCreated()) {
+                renderMeshPositions(*batch.mesh, batch.instanceCount, batch.lod);
+            } else {
+                renderMesh(*batch.mesh, batch.instanceCount, batch.lod);
+            }
+
+            if (conditional) {
+                glEndConditionalRender();
+            }
+        }
+    }
+
+    void DeferredRenderer::buildBatches(const Scene& scene, bool layered, uint32_t maxInstances) {
+        const std::vector<DrawCommand>& commands = drawList.getCommands();
+        const size_t alignment = UniformBuffer::getOffsetAlignment();
+
+        batches.clear();
+        drawData.clear();
+        faceData.clear();
+
+        size_t i = 0;
+        while (i < commands.size()) {
+            const DrawCommand& first = commands[i];
+
+            if (!scene.materials[first.materialID]) {
+                i++;
                 continue;
+            }
 
-            if (e->hasComponent<MeshRenderer>()) {
-                MeshRenderer& mr = e->getComponent<MeshRenderer>();
-                Material* material = scene.materials[mr.materialID];
+            // Sorting placed draws of the same mesh, material and level of detail next to each other
+            size_t end = i + 1;
+            while (end < commands.size() && end - i < maxInstances
+                && commands[end].mesh->handle == first.mesh->handle
+                && commands[end].materialID == first.materialID
+                && commands[end].lod == first.lod) {
+                end++;
+            }
 
-                if (material) {
-                    material->bind(shader);
+            // Every batch starts at an offset that can be bound as a uniform buffer range
+            size_t offset = drawData.size();
+            size_t size = sizeof(DrawUniforms) + (end - i) * sizeof(InstanceUniforms);
+            drawData.resize(offset + ((size + alignment - 1) / alignment) * alignment);
+
+            const Mesh& mesh = *first.mesh;
+            DrawUniforms uniforms = {
+                { mesh.positionScale.x, mesh.positionScale.y, mesh.positionScale.z, 0 },
+                { mesh.positionOffset.x, mesh.positionOffset.y, mesh.positionOffset.z, 0 }
+            };
+            memcpy(&drawData[offset], &uniforms, sizeof(DrawUniforms));
+
+            unsigned char* instances = &drawData[offset + sizeof(DrawUniforms)];
+            for (size_t j = i; j < end; j++) {
+                const Matrix4f& modelMatrix = scene.getWorldMatrix(commands[j].entity);
+                memcpy(instances + (j - i) * sizeof(InstanceUniforms), modelMatrix.toArray(), sizeof(InstanceUniforms));
+            }
 
-                    renderMesh(scene, shader, e);
+            // Face masks are tightly packed uints, which std140 lays out the same as the uvec4 array of the FaceBlock
+            size_t faceOffset = faceData.size();
+            if (layered) {
+                size_t faceSize = (end - i) * sizeof(uint32_t);
+                faceData.resize(faceOffset + ((faceSize + alignment - 1) / alignment) * alignment);
 
-                    material->release(shader);
+                for (size_t j = i; j < end; j++) {
+                    memcpy(&faceData[faceOffset + (j - i) * sizeof(uint32_t)], &faceMasks[commands[j].entity], sizeof(uint32_t));
                 }
             }
 
-            //renderMesh(scene, e);
+            batches.push_back(DrawBatch{ first.mesh, first.materialID, (uint32_t) (end - i), offset, faceOffset, first.entity, first.lod });
+            i = end;
+        }
+
+        // Orphan the previous storage so the upload does not wait on draws still using it. The
+        // storage reaches a whole block past the last batch, but only the instances in use are uploaded.
+        if (!drawData.empty()) {
+            drawBuffer.setData(std::max(drawData.size(), batches.back().offset + (size_t) DRAW_BLOCK_SIZE), nullptr, GL_STREAM_DRAW);
+            drawBuffer.setSubData(0, drawData.size(), drawData.data());
         }
+        if (!faceData.empty()) {
+            faceBuffer.setData(std::max(faceData.size(), batches.back().faceOffset + (size_t) FACE_BLOCK_SIZE), nullptr, GL_STREAM_DRAW);
+            faceBuffer.setSubData(0, faceData.size(), faceData.data());
+        }
+    }
+
+    void DeferredRenderer::renderMesh(const Mesh& mesh, uint32_t instanceCount) {
+        renderMesh(mesh, instanceCount, 0);
     }
 
-    void DeferredRenderer::renderMesh(const Scene& scene, ShaderProgram& shader, Entity* e) {
+    void DeferredRenderer::renderMesh(const Mesh& mesh, uint32_t instanceCount, uint32_t lod) {
+        drawMesh(mesh, packedGeometry ? meshPool.getHandle() : mesh.handle, instanceCount, lod);
+    }
+
+    void DeferredRenderer::renderMeshPositions(const Mesh& mesh, uint32_t instanceCount, uint32_t lod) {
+        drawMesh(mesh, packedGeometry ? meshPool.getPositionHandle() : mesh.positionHandle, instanceCount, lod);
+    }
+
+    void DeferredRenderer::drawMesh(const Mesh& mesh, GLuint vao, uint32_t instanceCount, uint32_t lod) {
         nvtxRangePushA("Mesh");
-        Transform& transform = e->getComponent<Transform>();
-        Mesh& mesh = e->getComponent<Mesh>();
 
-        renderState.modelMatrix.setIdentity();
-        
-        if (e->hasComponent<AttachedTo>()) {
-            Entity* parent = scene.getEntityById(e->getComponent<AttachedTo>().parentId);
-
-            if (parent != nullptr) {
-                Transform& parentT = parent->getComponent<Transform>();
-                renderState.modelMatrix.translate(parentT.position);
-                renderState.modelMatrix.rotate(parentT.rotation);
-                renderState.modelMatrix.scale(parentT.scale);
-            }
+        if (vao != RenderState::getVertexArray()) {
+            renderState.bindVertexArray(vao);
+            drawStats.meshBinds++;
+        } else {
+            drawStats.meshBindsSaved++;
         }
 
-        renderState.modelMatrix.translate(transform.position);
-        renderState.modelMatrix.rotate(transform.rotation);
-        renderState.modelMatrix.scale(transform.scale);
+        // Levels of detail follow the full indices in the same index buffer
+        GLsizei count = (GLsizei)mesh.indices.size();
+        unsigned int firstIndex = 0;
+        if (lod > 0) {
+            const MeshLod& level = mesh.lods[lod - 1];
+            count = (GLsizei) level.indexCount;
+            firstIndex = level.firstIndex;
+            drawStats.lodInstances += instanceCount;
+        }
 
-        Matrix4f PVM = renderState.projMatrix * renderState.viewMatrix * renderState.modelMatrix;
-        shader.uniformMatrix4f("modelMatrix", renderState.modelMatrix);
-        shader.uniformMatrix4f("PVM", PVM);
+        if (packedGeometry) {
+            GLenum indexType = meshPool.getIndexType();
+            const GLvoid* indexOffset = (const GLvoid*) (size_t) ((mesh.firstIndex + firstIndex) * VertexFormat::getIndexSize(indexType));
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, count, indexType, indexOffset, instanceCount, mesh.baseVertex);
+        } else {
+            const GLvoid* indexOffset = (const GLvoid*) (size_t) (firstIndex * VertexFormat::getIndexSize(mesh.indexType));
+            glDrawElementsInstanced(GL_TRIANGLES, count, mesh.indexType, indexOffset, instanceCount);
+        }
+        drawStats.drawCalls++;
+        drawStats.instances += instanceCount;
 
-        glBindVertexArray(mesh.handle);
-        glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT, 0);
         nvtxRangePop();
     }
 
     void DeferredRenderer::renderGBuffer(const Scene& scene)
     {
-        renderState.enable(STENCIL_TEST);
-        renderState.enable(DEPTH_TEST);
+        renderState.require(gBufferState);
 
         nvtxRangePushA("GBuffer");
 
-        glViewport(0, 0, windowSize.width, windowSize.height);
+        renderState.setViewport(0, 0, windowSize.width, windowSize.height);
 
         LOG("Rendering GBuffer");
         gBuffer.bind();
-        gBufferShader.bind();
         
-        glStencilMask(0xFF);
-        glStencilFunc(GL_ALWAYS, 1, 0xFF);
-        glStencilOp(GL_KEEP, GL_REPLACE, GL_REPLACE);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-        renderState.setCamera(gBufferShader, *scene.getMainCamera());
-        
+        renderState.setCamera(*scene.getMainCamera());
+        setLodView((float) windowSize.height, 1);
+        cullScene(scene, "Camera", scene.getMainCamera()->getIndex(), -1);
+        if (occlusionCulling != OCCLUSION_NONE) {
+            cullOccluded(scene);
+        } else {
+            occlusionCandidates.clear();
+        }
+
+        const bool prepass = useDepthPrepass();
+
+        // Time the whole fill, a free query is only missing while earlier results are still outstanding
+        int query = -1;
+        if (depthPrepass == PREPASS_AUTO) {
+            for (unsigned int i = 0; i < PREPASS_QUERY_COUNT && query < 0; i++) {
+                if (!prepassQueryPending[i]) {
+                    query = i;
+                }
+            }
+        }
+        if (query >= 0) {
+            glBeginQuery(GL_TIME_ELAPSED, prepassQueries[query]);
+        }
+
+        if (prepass) {
+            renderDepth(scene);
+            renderState.require(gBufferEqualState);
+        }
+
+        RenderState::useProgram(gBufferShader);
         renderScene(scene, gBufferShader);
+
+        if (!occlusionCandidates.empty()) {
+            renderOccluded(scene);
+        }
+
+        if (query >= 0) {
+            glEndQuery(GL_TIME_ELAPSED);
+            prepassQueryPending[query] = true;
+            prepassQueryUsed[query] = prepass;
+        }
+        prepassFrame++;
+
+        // Next frame tests its meshes against the depth of this one
+        if (occlusionCulling == OCCLUSION_DEPTH_PYRAMID) {
+            depthPyramid.build(renderState, gBuffer.depthTex, renderState.projMatrix * renderState.viewMatrix);
+            renderState.setViewport(0, 0, windowSize.width, windowSize.height);
+        }
         LOG("Finished GBuffer");
-        glStencilMask(0x00);
-        glStencilFunc(GL_EQUAL, 1, 0xFF);
-        glDepthMask(GL_FALSE);
+        renderState.setStencilMask(0x00);
+        renderState.setStencilFunc(GL_EQUAL, 1, 0xFF);
+        renderState.setDepthMask(false);
 
         nvtxRangePop();
     }
     
     void DeferredRenderer::renderDepth(const Scene& scene) {
-        renderState.enable(DEPTH_TEST);
+        renderState.require(depthPrepassState);
+
+        nvtxRangePushA("Depth Prepass");
 
-        nvtxRangePushA("Depth");
+        // Draws the meshes culled for the camera, nearest first so later ones are mostly rejected
+        RenderState::useProgram(shadowShader);
+        renderScene(scene, shadowShader, true, false, true);
 
-        shadowShader.bind();
+        nvtxRangePop();
+    }
 
-        glClear(GL_DEPTH_BUFFER_BIT);
-        glColorMask(false, false, false, false);
+    void DeferredRenderer::renderOccluded(const Scene& scene) {
+        nvtxRangePushA("Occlusion Queries");
 
-        renderState.setCamera(shadowShader, *scene.getMainCamera());
-        renderScene(scene, shadowShader);
+        if (occlusionQueries.size() < occlusionCandidates.size()) {
+            const size_t first = occlusionQueries.size();
+            occlusionQueries.resize(occlusionCandidates.size());
+            glGenQueries((GLsizei) (occlusionQueries.size() - first), &occlusionQueries[first]);
+        }
+        if (entityQueries.size() < worldBounds.size()) {
+            entityQueries.resize(worldBounds.size());
+        }
 
-        glColorMask(true, true, true, true);
+        // Test the bounds of every candidate against the depth of the meshes drawn so far
+        renderState.require(occlusionQueryState);
+        RenderState::useProgram(boundsShader);
+        renderState.bindVertexArray(boundsVao);
+        for (uint32_t i = 0; i < occlusionCandidates.size(); i++) {
+            const AABB& bounds = worldBounds[occlusionCandidates[i]];
+            entityQueries[occlusionCandidates[i]] = i;
+
+            boundsShader.uniform3f("boxMin", bounds.min);
+            boundsShader.uniform3f("boxMax", bounds.max);
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, occlusionQueries[i]);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+        }
 
         nvtxRangePop();
+
+        // The GPU skips the meshes whose bounds passed no samples, the CPU never waits for the results
+        renderState.require(gBufferState);
+        RenderState::useProgram(gBufferShader);
+        visibleEntities.swap(occlusionCandidates);
+        renderScene(scene, gBufferShader, false, false, false, true);
+        visibleEntities.swap(occlusionCandidates);
+
+        // Other draws of the camera view still get every mesh in the frustum
+        visibleEntities.insert(visibleEntities.end(), occlusionCandidates.begin(), occlusionCandidates.end());
+    }
+
+    bool DeferredRenderer::useDepthPrepass() {
+        if (depthPrepass != PREPASS_AUTO)
+            return depthPrepass == PREPASS_ALWAYS;
+
+        readPrepassTimings();
+
+        // Measure both ways first, afterwards keep the faster one but retry the other now and then as the view changes
+        if (prepassTime[1] == 0)
+            return true;
+        if (prepassTime[0] == 0)
+            return false;
+
+        const bool faster = prepassTime[1] < prepassTime[0];
+        return prepassFrame % PREPASS_PROBE_INTERVAL == 0 ? !faster : faster;
+    }
+
+    void DeferredRenderer::readPrepassTimings() {
+        for (unsigned int i = 0; i < PREPASS_QUERY_COUNT; i++) {
+            if (!prepassQueryPending[i])
+                continue;
+
+            // Never wait for the GPU, unfinished queries are checked again next frame
+            GLint available = 0;
+            glGetQueryObjectiv(prepassQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                continue;
+
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(prepassQueries[i], GL_QUERY_RESULT, &elapsed);
+            prepassQueryPending[i] = false;
+
+            double& average = prepassTime[prepassQueryUsed[i] ? 1 : 0];
+            average = average == 0 ? (double) elapsed : average * 0.9 + elapsed * 0.1;
+        }
     }
 
     void DeferredRenderer::renderShadowMaps(const Scene& scene) {
+        // Cascades and the atlas are fitted to the main camera, without one there is nothing to shadow
+        Entity* cameraEntity = scene.getMainCamera();
+        if (cameraEntity == nullptr)
+            return;
+
         nvtxRangePushA("Shadow");
 
-        shadowShader.bind();
+        RenderState::useProgram(shadowShader);
+
+        renderState.require(shadowState);
+
+        const Camera& mainCamera = cameraEntity->getComponent<Camera>();
+        const Matrix4f& cameraMatrix = scene.getWorldMatrix(cameraEntity->getIndex());
+
+        // Moved tiles hold the depth of other views, so none of the cached views can be reused
+        if (shadowAtlas.update(scene, mainCamera, Vector3f(cameraMatrix[12], cameraMatrix[13], cameraMatrix[14]), windowSize.height)) {
+            invalidateShadowCaches(scene);
+        }
+
+        // Set the clear depth to be the furthest distance possible
+        renderState.setClearDepth(1);
+
+        scene.view<Transform, DirectionalLight>().each([&](uint32_t entity, Transform& t, DirectionalLight& dirLight) {
+            const Vector3f direction = Math::directionFromRotation(t.rotation, Vector3f(0, 0, -1));
+
+            // Split the shadowed part of the view between a uniform and a logarithmic distribution
+            const float zNear = mainCamera.getZNear();
+            const float zFar = std::min(mainCamera.getZFar(), dirLight.shadowDistance);
+            const unsigned int count = dirLight.cascadeCount;
+
+            float splitNear = zNear;
+            for (unsigned int i = 0; i < count; i++) {
+                ShadowCascade& cascade = dirLight.cascades[i];
+                const ShadowTile& tile = cascade.tile;
+
+                const float fraction = (float) (i + 1) / count;
+                const float logSplit = zNear * std::pow(zFar / zNear, fraction);
+                const float uniformSplit = zNear + (zFar - zNear) * fraction;
+                cascade.splitDepth = dirLight.splitLambda * logSplit + (1 - dirLight.splitLambda) * uniformSplit;
+
+                const float cascadeNear = splitNear;
+                splitNear = cascade.splitDepth;
+                if (tile.size == 0)
+                    continue;
+
+                fitCascade(scene, direction, cascadeNear, cascade.splitDepth, tile.size);
+                cullScene(scene, "Directional light", entity, i);
+
+                // Map the cascade into its tile of the atlas
+                Matrix4f region;
+                region.setIdentity();
+                region[0] = (float) tile.size / shadowAtlas.getWidth();
+                region[5] = (float) tile.size / shadowAtlas.getHeight();
+                region[12] = (float) tile.x / shadowAtlas.getWidth();
+                region[13] = (float) tile.y / shadowAtlas.getHeight();
+                cascade.shadowSpace = region * Matrix4f::BIAS * renderState.projMatrix * renderState.viewMatrix;
+
+                setLodView((float) tile.size, shadowLodBias);
+                if (!updateShadowCache(scene, cascade.shadowCache))
+                    continue;
+
+                renderState.setViewport(tile.x, tile.y, tile.size, tile.size);
+                renderShadowView(scene, tile);
+            }
+        });
+
+        scene.view<Transform, PointLight>().each([&](uint32_t entity, Transform& t, PointLight& pointLight) {
+            if (pointLight.shadowSlot < 0)
+                return;
+
+            Camera cam(90, 1, 0.1, 100);
+
+            if (layeredShadows) {
+                renderShadowCube(scene, entity, t, cam, pointLight);
+                return;
+            }
+
+            // Orient a copy so the light's own transform is not marked as changed every frame
+            Transform faceTransform = t;
+
+            for (int i = 0; i < 6; i++) {
+                faceTransform.rotation.set(PointLight::faceRotation(i));
+
+                renderState.setCamera(faceTransform, cam);
+                cullScene(scene, "Point light", entity, i);
 
-        glColorMask(false, false, false, false);
+                // Faces whose light and casters did not change keep their depth from an earlier frame
+                const ShadowTile& tile = pointLight.shadowTiles[i];
+                setLodView((float) tile.size, shadowLodBias);
+                if (!updateShadowCache(scene, pointLight.shadowCache[i]))
+                    continue;
 
-        glPolygonOffset(2.5f, 10.0f);
-        renderState.enable(POLYGON_OFFSET);
+                renderState.setViewport(tile.x, tile.y, tile.size, tile.size);
+                renderShadowView(scene, tile);
+            }
+        });
+        renderState.disable(POLYGON_OFFSET);
+        renderState.setColorMask(true);
+
+        nvtxRangePop();
+    }
+
+    void DeferredRenderer::invalidateShadowCaches(const Scene& scene) {
+        scene.view<DirectionalLight>().each([&](uint32_t, DirectionalLight& dirLight) {
+            for (ShadowCascade& cascade : dirLight.cascades) {
+                cascade.shadowCache.invalidate();
+            }
+        });
+        scene.view<PointLight>().each([&](uint32_t, PointLight& pointLight) {
+            for (ShadowCache& cache : pointLight.shadowCache) {
+                cache.invalidate();
+            }
+        });
+    }
+
+    bool DeferredRenderer::updateShadowCache(const Scene& scene, ShadowCache& cache) {
+        staticCasters.clear();
+        dynamicCasters.clear();
+
+        ShadowSignature staticSignature;
+        ShadowSignature dynamicSignature;
+
+        // Both layers depend on the view of the light
+        const Matrix4f projView = renderState.projMatrix * renderState.viewMatrix;
+        staticSignature.add(projView);
+        dynamicSignature.add(projView);
+
+        // So do the levels of detail, which also change with their threshold
+        staticSignature.add(lodScale);
+        dynamicSignature.add(lodScale);
+
+        for (uint32_t entity : visibleEntities) {
+            const Mesh* mesh = scene.getComponent<Mesh>(entity);
+            const MeshRenderer* mr = scene.getComponent<MeshRenderer>(entity);
 
-        renderState.enable(DEPTH_TEST);
-        glDepthMask(GL_TRUE);
+            bool isStatic = staticShadowCache && mr->isStatic;
+            ShadowSignature& signature = isStatic ? staticSignature : dynamicSignature;
+            signature.add(entity);
+            signature.add(scene.getTransformVersion(entity));
+            signature.add(mesh->handle);
+            signature.add(mr->materialID);
 
-        for (Entity* entity : scene.lights) {
-            Transform& t = entity->getComponent<Transform>();
-            Camera& camera = entity->getComponent<Camera>();
+            (isStatic ? staticCasters : dynamicCasters).push_back(entity);
+        }
 
-            if (entity->hasComponent<DirectionalLight>()) {
-                DirectionalLight& dirLight = entity->getComponent<DirectionalLight>();
-                renderState.setCamera(shadowShader, *entity);
+        staticLayerChanged = staticSignature.get() != cache.staticSignature;
+        if (!staticLayerChanged && dynamicSignature.get() == cache.dynamicSignature) {
+            drawStats.shadowViewsCached++;
+            return false;
+        }
 
-                dirLight.shadowSpace = Matrix4f::BIAS * renderState.projMatrix * renderState.viewMatrix;
+        cache.staticSignature = staticSignature.get();
+        cache.dynamicSignature = dynamicSignature.get();
+        drawStats.shadowViewsRendered++;
+        return true;
+    }
 
-                dirLight.shadowBuffer.bind();
-                dirLight.shadowBuffer.addDepthTexture(dirLight.shadowMap);
-                glViewport(0, 0, dirLight.shadowMap.getWidth(), dirLight.shadowMap.getHeight());
+    void DeferredRenderer::renderShadowView(const Scene& scene, const ShadowTile& tile) {
+        const Framebuffer& buffer = shadowAtlas.getBuffer();
+        const Framebuffer* staticBuffer = shadowAtlas.getStaticBuffer();
+        const int x = tile.x, y = tile.y, size = tile.size;
 
+        // Other views share the atlas, so clears only touch the tile of this one
+        renderState.enable(SCISSOR_TEST);
+        renderState.setScissor(x, y, size, size);
+
+        if (staticBuffer) {
+            if (staticLayerChanged) {
+                staticBuffer->bind();
                 glClear(GL_DEPTH_BUFFER_BIT);
 
-                renderScene(scene, shadowShader);
+                visibleEntities = staticCasters;
+                renderScene(scene, shadowShader, true);
             }
-            if (entity->hasComponent<PointLight>()) {
-                PointLight& pointLight = entity->getComponent<PointLight>();
-                Camera cam(90, 1, 0.1, 100);
 
-                pointLight.shadowBuffer.bind();
-                pointLight.shadowBuffer.disableColor();
+            // Start from the cached depth of the static casters and draw the moving ones over it
+            staticBuffer->bindRead();
+            buffer.bindDraw();
+            glBlitFramebuffer(x, y, x + size, y + size, x, y, x + size, y + size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            buffer.bind();
+        } else {
+            buffer.bind();
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+
+        if (!dynamicCasters.empty()) {
+            visibleEntities = dynamicCasters;
+            renderScene(scene, shadowShader, true);
+        }
 
-                // Set the clear depth to be the furthest distance possible
-                glClearDepth(1);
+        renderState.disable(SCISSOR_TEST);
+    }
 
-                // Set the viewport to the size of the shadow map
-                glViewport(0, 0, pointLight.shadowMap.getResolution(), pointLight.shadowMap.getResolution());
+    void DeferredRenderer::renderShadowCube(const Scene& scene, uint32_t entity, const Transform& transform, Camera& camera, PointLight& pointLight) {
+        // Orient a copy so the light's own transform is not marked as changed every frame
+        Transform faceTransform = transform;
 
-                for (int i = 0; i < 6; i++) {
-                    Vector3f rotation = pointLight.transforms[i];
-                    t.rotation.set(rotation);
+        Matrix4f faceMatrices[6];
+        for (int i = 0; i < 6; i++) {
+            faceTransform.rotation.set(PointLight::faceRotation(i));
 
-                    renderState.setCamera(shadowShader, t, cam);
+            renderState.setCamera(faceTransform, camera);
+            faceMatrices[i] = renderState.projMatrix * renderState.viewMatrix;
+        }
 
-                    // Set up the framebuffer and validate it
-                    pointLight.shadowBuffer.setDepthCubemap(pointLight.shadowMap, i, 0);
-                    pointLight.shadowBuffer.validate();
+        cullCube(scene, entity, faceMatrices);
 
-                    // Clear the framebuffer and render the scene from the view of the light
-                    glClear(GL_DEPTH_BUFFER_BIT);
+        // All faces share the projection and their tiles the size, so one level of detail fits every face
+        setLodView((float) pointLight.shadowTiles[0].size, shadowLodBias);
 
-                    renderScene(scene, shadowShader);
-                }
+        // The whole cubemap is cached at once, the light position is part of the last face matrix
+        if (!updateShadowCache(scene, pointLight.shadowCache[0]))
+            return;
+
+        RenderState::useProgram(cubeShadowShader);
+        CubeUniforms uniforms;
+        for (int i = 0; i < 6; i++) {
+            memcpy(uniforms.faceMatrices[i], faceMatrices[i].toArray(), sizeof(uniforms.faceMatrices[i]));
+            shadowAtlas.getTileTransform(pointLight.shadowTiles[i], uniforms.faceTiles[i]);
+        }
+        cubeBuffer.setSubData(0, sizeof(CubeUniforms), &uniforms);
+        cubeBuffer.bindBase(CUBE_BLOCK);
+
+        const Framebuffer& buffer = shadowAtlas.getBuffer();
+        const Framebuffer* staticBuffer = shadowAtlas.getStaticBuffer();
+        const ShadowTile* tiles = pointLight.shadowTiles;
+
+        if (staticBuffer && staticLayerChanged) {
+            staticBuffer->bind();
+            renderState.enable(SCISSOR_TEST);
+            for (int i = 0; i < 6; i++) {
+                renderState.setScissor(tiles[i].x, tiles[i].y, tiles[i].size, tiles[i].size);
+                glClear(GL_DEPTH_BUFFER_BIT);
             }
+            renderState.disable(SCISSOR_TEST);
+
+            renderLayered(scene, staticCasters);
         }
-        renderState.disable(POLYGON_OFFSET);
 
-        glColorMask(true, true, true, true);
+        // Start every face from the static layer or from the furthest depth
+        renderState.enable(SCISSOR_TEST);
+        for (int i = 0; i < 6; i++) {
+            const int x = tiles[i].x, y = tiles[i].y, size = tiles[i].size;
+            renderState.setScissor(x, y, size, size);
+
+            if (staticBuffer) {
+                staticBuffer->bindRead();
+                buffer.bindDraw();
+                glBlitFramebuffer(x, y, x + size, y + size, x, y, x + size, y + size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            } else {
+                buffer.bind();
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+        }
+        renderState.disable(SCISSOR_TEST);
 
-        nvtxRangePop();
+        buffer.bind();
+        renderLayered(scene, dynamicCasters);
+
+        RenderState::useProgram(shadowShader);
+    }
+
+    void DeferredRenderer::renderLayered(const Scene& scene, const std::vector<uint32_t>& casters) {
+        if (casters.empty())
+            return;
+
+        // Every face is drawn over the whole atlas, its clip planes keep it inside its own tile
+        renderState.setViewport(0, 0, shadowAtlas.getWidth(), shadowAtlas.getHeight());
+        for (Capability clipDistance : { CLIP_DISTANCE0, CLIP_DISTANCE1, CLIP_DISTANCE2, CLIP_DISTANCE3 }) {
+            renderState.enable(clipDistance);
+        }
+
+        visibleEntities = casters;
+        renderScene(scene, cubeShadowShader, true, true);
+
+        for (Capability clipDistance : { CLIP_DISTANCE0, CLIP_DISTANCE1, CLIP_DISTANCE2, CLIP_DISTANCE3 }) {
+            renderState.disable(clipDistance);
+        }
+    }
+
+    void DeferredRenderer::fitCascade(const Scene& scene, const Vector3f& lightDirection, float nearDepth, float farDepth, unsigned int resolution) {
+        Entity* cameraEntity = scene.getMainCamera();
+        Camera& camera = cameraEntity->getComponent<Camera>();
+
+        // Includes the parents of the camera, like the atlas sizing does
+        const Matrix4f& cameraWorld = scene.getWorldMatrix(cameraEntity->getIndex());
+
+        // Corners of the slice of the camera frustum covered by the cascade
+        Vector3f corners[8];
+        for (int i = 0; i < 8; i++) {
+            float depth = (i & 4) ? farDepth : nearDepth;
+            float x, y;
+            if (camera.isPerspective()) {
+                float tanHalfFov = std::tan(Math::toRadians(camera.getFovy()) / 2);
+                x = (i & 1 ? 1 : -1) * depth * tanHalfFov * camera.getAspectRatio();
+                y = (i & 2 ? 1 : -1) * depth * tanHalfFov;
+            } else {
+                x = (i & 1) ? camera.getRight() : camera.getLeft();
+                y = (i & 2) ? camera.getTop() : camera.getBottom();
+            }
+            corners[i] = cameraWorld.transform(Vector3f(x, y, -depth), 1);
+        }
+
+        // A sphere around the slice keeps the cascade size constant while the camera rotates
+        Vector3f center(0, 0, 0);
+        for (const Vector3f& corner : corners) {
+            center += corner;
+        }
+        center /= 8;
+
+        float radius = 0;
+        for (const Vector3f& corner : corners) {
+            radius = std::max(radius, (corner - center).length());
+        }
+        radius = std::ceil(radius * 16) / 16;
+
+        // Light space basis looking down the light direction
+        Vector3f zAxis = -lightDirection;
+        Vector3f up = std::abs(zAxis.y) > 0.99f ? Vector3f(1, 0, 0) : Vector3f(0, 1, 0);
+        Vector3f xAxis = GDT::cross(up, zAxis);
+        xAxis.normalize();
+        Vector3f yAxis = GDT::cross(zAxis, xAxis);
+
+        Matrix4f viewMatrix;
+        viewMatrix.setIdentity();
+        viewMatrix[0] = xAxis.x; viewMatrix[4] = xAxis.y; viewMatrix[8] = xAxis.z;
+        viewMatrix[1] = yAxis.x; viewMatrix[5] = yAxis.y; viewMatrix[9] = yAxis.z;
+        viewMatrix[2] = zAxis.x; viewMatrix[6] = zAxis.y; viewMatrix[10] = zAxis.z;
+
+        // Snap the center to whole texels so the shadow map does not shimmer while the camera moves
+        Vector3f lightCenter = viewMatrix.transform(center, 1);
+        const float texelSize = 2 * radius / resolution;
+        lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+        // Extend the depth range towards the light to include every caster of the scene
+        float maxDepth = lightCenter.z + radius;
+        for (int i = 0; i < 8 && sceneBounds.min.x <= sceneBounds.max.x; i++) {
+            Vector3f corner((i & 1) ? sceneBounds.max.x : sceneBounds.min.x,
+                            (i & 2) ? sceneBounds.max.y : sceneBounds.min.y,
+                            (i & 4) ? sceneBounds.max.z : sceneBounds.min.z);
+            maxDepth = std::max(maxDepth, viewMatrix.transform(corner, 1).z);
+        }
+
+        Camera shadowCamera(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius,
+            -maxDepth - 1, -(lightCenter.z - radius));
+        Matrix4f projMatrix;
+        shadowCamera.loadProjectionMatrix(projMatrix);
+
+        renderState.setCamera(projMatrix, viewMatrix, center, shadowCamera.getZNear(), shadowCamera.getZFar());
     }
 
     void DeferredRenderer::renderFramebuffer(const Framebuffer& framebuffer) {
         LOG("Rendering framebuffer");
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDrawBuffer(GL_BACK);
-        glClearColor(0.5, 1, 0, 1);
+        RenderState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLenum backBuffer = GL_BACK;
+        RenderState::setDrawBuffers(1, &backBuffer);
+        renderState.setClearColor(0.5, 1, 0, 1);
         glClear(GL_COLOR_BUFFER_BIT);
         
-        textureShader.bind();
+        RenderState::useProgram(textureShader);
         framebuffer.getTexture().bind(TextureUnit::TEXTURE);
         textureShader.uniform1i("tex", TextureUnit::TEXTURE);
         renderState.drawQuad();
@@ -2,13 +2,38 @@
 
 #include "Renderer.h"
 #include "Renderer/GBuffer.h"
+#include "Renderer/DrawList.h"
+#include "Renderer/MeshPool.h"
+#include "Renderer/ShadowCache.h"
+#include "Renderer/ShadowAtlas.h"
+#include "Renderer/DepthPyramid.h"
+#include "Renderer/OcclusionRasterizer.h"
 
 #include "Texture.h"
+#include "Util/Bounds.h"
 
 #include <memory>
 
 namespace Flux {
     class Size;
+    class Frustum;
+
+    /** Whether the G-buffer fill is preceded by a depth only pass */
+    enum DepthPrepass {
+        PREPASS_NEVER,
+        PREPASS_ALWAYS,
+        // Times the G-buffer fill with and without the pre-pass and keeps the faster one
+        PREPASS_AUTO
+    };
+
+    /** How meshes hidden behind other meshes are kept from being drawn */
+    enum OcclusionCulling {
+        OCCLUSION_NONE,
+        // Tests against the depth of an earlier frame, with occlusion queries as a second chance
+        OCCLUSION_DEPTH_PYRAMID,
+        // Tests against the occluder meshes of the current frame, rasterized on the CPU
+        OCCLUSION_RASTERIZER
+    };
 
     class DeferredRenderer : public Renderer {
     public:
@@ -17,24 +42,191 @@ namespace Flux {
         virtual bool create(const Scene& scene, const Size windowSize);
         virtual void onResize(const Size windowSize);
         virtual void update(const Scene& scene);
+        /** Renders the meshes that passed the last call to cullScene */
         virtual void renderScene(const Scene& scene, ShaderProgram& shader);
-        virtual void renderMesh(const Scene& scene, ShaderProgram& shader, Entity* e);
+        virtual void renderMesh(const Mesh& mesh, uint32_t instanceCount);
+
+        /** Draws instances of a level of detail of the mesh, zero being the full mesh */
+        void renderMesh(const Mesh& mesh, uint32_t instanceCount, uint32_t lod);
+
+        /** Draws instances of the mesh sourcing only vertex positions */
+        void renderMeshPositions(const Mesh& mesh, uint32_t instanceCount, uint32_t lod = 0);
+
+        /**
+         * Packs all meshes into shared buffers when the renderer is created, so that
+         * the draw loop never switches vertex arrays. Must be set before create().
+         */
+        void setPackedGeometry(bool enabled) {
+            packedGeometry = enabled;
+        }
+
+        /** Renders all six faces of a point light shadow in one layered pass instead of one pass per face */
+        void setLayeredShadows(bool enabled) {
+            layeredShadows = enabled;
+        }
+
+        /**
+         * Keeps the shadows of static meshes in a depth layer of their own, so
+         * that a moving caster only has to redraw the dynamic casters on top
+         * of a copy of that layer. Must be set before create().
+         */
+        void setStaticShadowCache(bool enabled) {
+            staticShadowCache = enabled;
+        }
+
+        /** Memory in bytes the shadow atlas may take, including the static layer. Must be set before create(). */
+        void setShadowBudget(size_t bytes) {
+            shadowBudget = bytes;
+        }
+
+        /**
+         * Draws the visible meshes front to back into the depth buffer before the G-buffer
+         * is filled with an equal depth test, so every pixel only shades its closest surface.
+         */
+        void setDepthPrepass(DepthPrepass mode) {
+            depthPrepass = mode;
+        }
+
+        /**
+         * Skips meshes hidden behind others. The depth pyramid rejects meshes behind the depth of
+         * an earlier frame, those get a second chance after the visible ones are drawn, when their
+         * bounds are tested against the new depth with occlusion queries and they are drawn
+         * conditionally. The rasterizer only considers meshes marked as occluders, but its result
+         * belongs to the current frame and needs neither a readback nor a second pass.
+         */
+        void setOcclusionCulling(OcclusionCulling mode) {
+            occlusionCulling = mode;
+        }
+
+        /**
+         * Draws every mesh with the coarsest level of detail whose error, projected onto
+         * the view, stays within the given number of pixels. Zero always draws full detail.
+         */
+        void setLodThreshold(float pixels) {
+            lodThreshold = pixels;
+        }
+
+        /**
+         * Scales the threshold in shadow views, where a coarser caster rarely shows.
+         * Their resolution already lowers the detail that is picked, this goes further.
+         */
+        void setShadowLodBias(float bias) {
+            shadowLodBias = bias;
+        }
+
+        /** Work and timing of the software occlusion rasterizer during the last frame */
+        const OcclusionStats& getOcclusionStats() const {
+            return occlusionRasterizer.getStats();
+        }
+
+        static const size_t DEFAULT_SHADOW_BUDGET = 32 * 1024 * 1024;
+        static constexpr float DEFAULT_SHADOW_LOD_BIAS = 4;
 
     private:
-        void createBackBuffers(const unsigned int width, const unsigned int height);
-        void createShadowMaps(const Scene& scene);
+        void updateBounds(const Scene& scene);
+        void cullScene(const Scene& scene, const char* view, uint32_t viewEntity, int face);
+        void cullCube(const Scene& scene, uint32_t viewEntity, const Matrix4f faceMatrices[6]);
+        bool isVisible(const Frustum& frustum, uint32_t entity) const;
+        uint32_t getShaderKey(const ShaderProgram& shader);
+        void cullOccluded(const Scene& scene);
+        void renderScene(const Scene& scene, ShaderProgram& shader, bool positionsOnly, bool layered = false, bool frontToBack = false, bool conditional = false);
+        void drawMesh(const Mesh& mesh, GLuint vao, uint32_t instanceCount, uint32_t lod);
+        void setLodView(float viewportHeight, float bias);
+        uint32_t selectLod(const Mesh& mesh, uint32_t entity, const Vector3f& viewCenter) const;
+        void buildBatches(const Scene& scene, bool layered, uint32_t maxInstances);
 
         void renderGBuffer(const Scene& scene);
         void renderDepth(const Scene& scene);
+        void renderOccluded(const Scene& scene);
+        bool useDepthPrepass();
+        void readPrepassTimings();
         void renderShadowMaps(const Scene& scene);
+        void renderShadowCube(const Scene& scene, uint32_t entity, const Transform& transform, Camera& camera, PointLight& pointLight);
+        void renderLayered(const Scene& scene, const std::vector<uint32_t>& casters);
+        void fitCascade(const Scene& scene, const Vector3f& lightDirection, float nearDepth, float farDepth, unsigned int resolution);
+        bool updateShadowCache(const Scene& scene, ShadowCache& cache);
+        void renderShadowView(const Scene& scene, const ShadowTile& tile);
+        void invalidateShadowCaches(const Scene& scene);
         void renderFramebuffer(const Framebuffer& framebuffer);
 
         ShaderProgram gBufferShader;
         ShaderProgram shadowShader;
+        ShaderProgram cubeShadowShader;
         ShaderProgram textureShader;
+        ShaderProgram boundsShader;
+
+        // World space bounds of every mesh, indexed by entity
+        std::vector<AABB> worldBounds;
+        std::vector<BoundingSphere> worldSpheres;
+        std::vector<uint32_t> visibleEntities;
+        // Bounds of all meshes, limits how far shadow views extend towards the light
+        AABB sceneBounds;
+
+        DrawList drawList;
+        std::vector<const ShaderProgram*> shaderKeys;
+
+        PipelineState gBufferState;
+        PipelineState shadowState;
+        PipelineState depthPrepassState;
+        // G-buffer fill after the pre-pass, only the fragments matching the stored depth pass
+        PipelineState gBufferEqualState;
+
+        static const unsigned int PREPASS_QUERY_COUNT = 4;
+        static const unsigned int PREPASS_PROBE_INTERVAL = 120;
+
+        DepthPrepass depthPrepass = PREPASS_AUTO;
+        // Timer queries of the G-buffer fill, their results arrive a few frames later
+        GLuint prepassQueries[PREPASS_QUERY_COUNT];
+        bool prepassQueryPending[PREPASS_QUERY_COUNT] = {};
+        bool prepassQueryUsed[PREPASS_QUERY_COUNT] = {};
+        // Average time of the G-buffer fill without and with the pre-pass in nanoseconds, zero until measured
+        double prepassTime[2] = {};
+        unsigned int prepassFrame = 0;
+
+        OcclusionCulling occlusionCulling = OCCLUSION_DEPTH_PYRAMID;
+        DepthPyramid depthPyramid;
+        OcclusionRasterizer occlusionRasterizer;
+        // Meshes in the frustum that were hidden in the depth pyramid, drawn only if their query passes
+        std::vector<uint32_t> occlusionCandidates;
+        std::vector<GLuint> occlusionQueries;
+        // Query of every candidate, indexed by entity
+        std::vector<uint32_t> entityQueries;
+        // Bounds are generated from the vertex index, but a vertex array must still be bound
+        GLuint boundsVao = 0;
+        PipelineState occlusionQueryState;
+
+        bool packedGeometry = false;
+
+        float lodThreshold = 1;
+        float shadowLodBias = DEFAULT_SHADOW_LOD_BIAS;
+        // Pixels per object space unit of error at unit distance in the current view, divided by its threshold
+        float lodScale = 0;
+        bool lodPerspective = true;
+
+        bool layeredShadows = true;
+        // Cubemap faces overlapped by every entity, indexed by entity
+        std::vector<uint32_t> faceMasks;
+        UniformBuffer faceBuffer;
+        // Face matrices and atlas tiles of the point light being rendered
+        UniformBuffer cubeBuffer;
+        std::vector<unsigned char> faceData;
+
+        // Shadow views of all lights share one depth texture
+        ShadowAtlas shadowAtlas;
+        size_t shadowBudget = DEFAULT_SHADOW_BUDGET;
+
+        bool staticShadowCache = false;
+        // Visible casters of the current shadow view, split by whether they can be cached
+        std::vector<uint32_t> staticCasters;
+        std::vector<uint32_t> dynamicCasters;
+        bool staticLayerChanged = false;
+        MeshPool meshPool;
+
+        // Instance matrices of every batch in the current draw list
+        std::vector<DrawBatch> batches;
+        UniformBuffer drawBuffer;
+        std::vector<unsigned char> drawData;
 
         GBuffer gBuffer;
-        Framebuffer hdrBuffer;
-        Framebuffer ldrBuffer;
     };
 }
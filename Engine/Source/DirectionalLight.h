@@ -1,31 +1,63 @@
 #pragma once
 
-#include "Framebuffer.h"
 #include "Component.h"
+#include "Renderer/ShadowCache.h"
 
 #include <GDT/Vector3f.h>
 #include <GDT/Matrix4f.h>
 
 #include <memory>
+#include <algorithm>
 
 using GDT::Vector3f;
 using GDT::Matrix4f;
 
 namespace Flux {
+    /** Tile of the shadow atlas covering one depth slice of the main camera frustum */
+    struct ShadowCascade {
+        // Resolution asked for in the shadow atlas, rounded up to a power of two
+        unsigned int resolution = 1024;
+        ShadowTile tile;
+        // View depth up to which the cascade is used
+        float splitDepth = 0;
+        // Transforms world space positions into the tile of the cascade in the shadow atlas
+        Matrix4f shadowSpace;
+        ShadowCache shadowCache;
+    };
+
     class DirectionalLight : public Component {
     public:
+        static const ComponentType TYPE = ComponentType::DirectionalLight;
+
         DirectionalLight()
         :   energy(DEFAULT_ENERGY)
         ,   color(1, 1, 1)
-        { }
-
-        const float DEFAULT_ENERGY = 1.0f;
+        ,   cascadeCount(DEFAULT_CASCADE_COUNT)
+        ,   splitLambda(DEFAULT_SPLIT_LAMBDA)
+        ,   shadowDistance(DEFAULT_SHADOW_DISTANCE)
+        ,   shadowImportance(1)
+        {
+            cascades[0].resolution = 2048;
+        }
+
+        static constexpr float DEFAULT_ENERGY = 1.0f;
+
+        /** Maximum number of cascades, must match DeferredDirect.frag */
+        static const unsigned int MAX_CASCADES = 4;
+        static const unsigned int DEFAULT_CASCADE_COUNT = 3;
+        static constexpr float DEFAULT_SPLIT_LAMBDA = 0.75f;
+        static constexpr float DEFAULT_SHADOW_DISTANCE = 150;
 
         float energy;
         Vector3f color;
 
-        Texture2D shadowMap;
-        Matrix4f shadowSpace;
-        Framebuffer shadowBuffer;
+        unsigned int cascadeCount;
+        ShadowCascade cascades[MAX_CASCADES];
+        // Blends the cascade splits between uniform (0) and logarithmic (1) distribution
+        float splitLambda;
+        // Distance from the camera up to which shadows are drawn
+        float shadowDistance;
+        // Scales the resolution of all cascades in the shadow atlas
+        float shadowImportance;
     };
 }
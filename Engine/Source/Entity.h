@@ -1,19 +1,19 @@
 #pragma once
 
-#include "Component.h"
+#include "ComponentRegistry.h"
 
 #include "Exceptions/ComponentNotFoundException.h"
 
-#include <vector>
-#include <memory>
+#include <string>
+#include <utility>
 
 namespace Flux {
-    static uint32_t idGenerator = 0;
-
     class Entity {
     public:
-        Entity()
-        :   id(idGenerator++)
+        Entity(ComponentRegistry& registry, EntityHandle handle)
+        :   registry(registry)
+        ,   handle(handle)
+        ,   id(handle.index)
         {
 
         }
@@ -26,42 +26,40 @@ namespace Flux {
             return id;
         }
 
-        void addComponent(Component* component) {
-            components.push_back(std::unique_ptr<Component>(component));
+        EntityHandle getHandle() const {
+            return handle;
         }
 
-        template <class T>
-        T& getComponent() {
-            for (int i = 0; i < components.size(); i++) {
-                Component* c = components[i].get();
-
-                if (dynamic_cast<T*>(c)) {
-                    return *(dynamic_cast<T*>(c));
-                }
-            }
+        /** Returns the slot of this entity in the component registry */
+        uint32_t getIndex() const {
+            return handle.index;
+        }
 
-            throw ComponentNotFoundException();
+        template <class T, class... Args>
+        T& addComponent(Args&&... args) {
+            return registry.getPool<T>().add(handle.index, std::forward<Args>(args)...);
         }
 
         template <class T>
-        bool hasComponent() {
-            for (int i = 0; i < components.size(); i++) {
-                std::unique_ptr<Component>& c = components[i];
+        T& getComponent() {
+            T* component = registry.getPool<T>().tryGet(handle.index);
 
-                if (dynamic_cast<T*>(c.get())) {
-                    return true;
-                }
+            if (component == nullptr) {
+                throw ComponentNotFoundException();
             }
-            return false;
+            return *component;
         }
 
-        const size_t numComponents() {
-            return components.size();
+        template <class T>
+        bool hasComponent() {
+            return registry.getPool<T>().has(handle.index);
         }
 
         std::string name;
     private:
+        ComponentRegistry& registry;
+
+        EntityHandle handle;
         uint32_t id;
-        std::vector<std::unique_ptr<Component>> components;
     };
 }
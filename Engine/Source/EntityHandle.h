@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Flux {
+    /**
+     * Refers to an entity slot in the component registry. The generation
+     * is bumped every time a slot is freed, so a handle to a destroyed
+     * entity never resolves to the entity that later reuses its slot.
+     */
+    struct EntityHandle {
+        static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+        EntityHandle() : index(INVALID_INDEX), generation(0) { }
+        EntityHandle(uint32_t index, uint32_t generation) : index(index), generation(generation) { }
+
+        bool isNull() const {
+            return index == INVALID_INDEX;
+        }
+
+        bool operator==(const EntityHandle& handle) const {
+            return index == handle.index && generation == handle.generation;
+        }
+
+        bool operator!=(const EntityHandle& handle) const {
+            return !(*this == handle);
+        }
+
+        uint32_t index;
+        uint32_t generation;
+    };
+}
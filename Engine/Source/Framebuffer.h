@@ -24,6 +24,7 @@ namespace Flux {
         }
 
         void destroy() {
+            RenderState::releaseFramebuffer(handle);
             glDeleteFramebuffers(1, &handle);
 
             // NOTE: Don't destroy textures, because we may not own them
@@ -32,20 +33,19 @@ namespace Flux {
         }
 
         void bind() const {
-            glBindFramebuffer(GL_FRAMEBUFFER, handle);
-            RenderState::currentFramebuffer = this;
+            RenderState::bindFramebuffer(GL_FRAMEBUFFER, handle);
         }
 
         void bindDraw() const {
-            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, handle);
+            RenderState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, handle);
         }
 
         void bindRead() const {
-            glBindFramebuffer(GL_READ_FRAMEBUFFER, handle);
+            RenderState::bindFramebuffer(GL_READ_FRAMEBUFFER, handle);
         }
 
         void release() const {
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            RenderState::bindFramebuffer(GL_FRAMEBUFFER, 0);
         }
 
         const Texture2D& getTexture() const {
@@ -56,14 +56,14 @@ namespace Flux {
             return colorTexture[attachment];
         }
 
-        void addColorTexture(unsigned int colorAttachment, Texture2D texture) {
+        void addColorTexture(unsigned int colorAttachment, Texture2D texture, int mipmapLevel = 0) {
             if (colorAttachment > MAX_COLOR_ATTACHMENTS) {
                 Log::error("Tried to add color attachment with index greater than 8.");
                 return;
             }
             colorTexture[colorAttachment] = texture;
             GLint attachment = GL_COLOR_ATTACHMENT0 + colorAttachment;
-            setTexture(attachment, texture);
+            setTexture(attachment, texture, mipmapLevel);
             addDrawBuffer(attachment);
         }
 
@@ -80,8 +80,8 @@ namespace Flux {
             setTexture(GL_DEPTH_STENCIL_ATTACHMENT, texture);
         }
 
-        void setTexture(GLuint attachment, Texture& texture) {
-            glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture.getHandle(), 0);
+        void setTexture(GLuint attachment, Texture& texture, int mipmapLevel = 0) {
+            glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture.getHandle(), mipmapLevel);
         }
 
         void setDepthCubemap(Cubemap cubemap, unsigned int face, int mipmapLevel) {
@@ -94,7 +94,7 @@ namespace Flux {
 
         void addDrawBuffer(GLenum target) {
             drawBuffers.push_back(target);
-            glDrawBuffers((GLsizei) drawBuffers.size(), drawBuffers.data());
+            RenderState::setDrawBuffers((GLsizei) drawBuffers.size(), drawBuffers.data());
         }
 
         unsigned int getDrawBuffer() {
@@ -107,17 +107,20 @@ namespace Flux {
                 return;
             }
             currentDrawBuffer = colorAttachment;
-            glDrawBuffer(GL_COLOR_ATTACHMENT0 + colorAttachment);
+            GLenum target = GL_COLOR_ATTACHMENT0 + colorAttachment;
+            RenderState::setDrawBuffers(1, &target);
         }
 
         void enableColor(int target) {
             glReadBuffer(target);
-            glDrawBuffer(target);
+            GLenum drawTarget = target;
+            RenderState::setDrawBuffers(1, &drawTarget);
         }
 
         void disableColor() {
             glReadBuffer(GL_NONE);
-            glDrawBuffer(GL_NONE);
+            GLenum target = GL_NONE;
+            RenderState::setDrawBuffers(1, &target);
         }
 
         void validate() const {
@@ -145,7 +148,7 @@ namespace Flux {
             }
         }
     private:
-        const unsigned int MAX_COLOR_ATTACHMENTS = 8;
+        static constexpr unsigned int MAX_COLOR_ATTACHMENTS = 8;
 
         GLuint handle;
 
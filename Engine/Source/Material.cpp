@@ -1,53 +1,70 @@
 #include "Material.h"
 
 #include "TextureUnit.h"
+#include "Renderer/RenderState.h"
 
 #include <GDT/Shader.h>
 
 using GDT::ShaderProgram;
 
 namespace Flux {
-    void Material::bind(ShaderProgram& shader) const {
+    void Material::upload() {
+        MaterialUniforms uniforms;
+        uniforms.emission[0] = emission.x;
+        uniforms.emission[1] = emission.y;
+        uniforms.emission[2] = emission.z;
+        uniforms.padding = 0;
+        uniforms.tiling[0] = tilingX;
+        uniforms.tiling[1] = tilingY;
+        uniforms.hasDiffuseMap = diffuseTex.isCreated();
+        uniforms.hasNormalMap = normalTex.isCreated();
+        uniforms.hasMetalMap = metalTex.isCreated();
+        uniforms.hasRoughnessMap = roughnessTex.isCreated();
+        uniforms.hasStencilMap = stencilTex.isCreated();
+        uniforms.hasEmissionMap = emissionTex.isCreated();
+
+        if (!uniformBuffer.isCreated()) {
+            uniformBuffer.create();
+        }
+        uniformBuffer.setData(sizeof(MaterialUniforms), &uniforms, GL_STATIC_DRAW);
+    }
+
+    void Material::bind() const {
         if (diffuseTex.isCreated()) {
             diffuseTex.bind(TextureUnit::ALBEDO);
-            shader.uniform1i("material.diffuseMap", TextureUnit::ALBEDO);
-            shader.uniform1i("material.hasDiffuseMap", 1);
         }
         if (normalTex.isCreated()) {
             normalTex.bind(TextureUnit::NORMAL);
-            shader.uniform1i("material.normalMap", TextureUnit::NORMAL);
-            shader.uniform1i("material.hasNormalMap", 1);
         }
         if (roughnessTex.isCreated()) {
             roughnessTex.bind(TextureUnit::ROUGHNESS);
-            shader.uniform1i("material.roughnessMap", TextureUnit::ROUGHNESS);
-            shader.uniform1i("material.hasRoughnessMap", 1);
         }
         if (metalTex.isCreated()) {
             metalTex.bind(TextureUnit::METALNESS);
-            shader.uniform1i("material.metalMap", TextureUnit::METALNESS);
-            shader.uniform1i("material.hasMetalMap", 1);
         }
         if (stencilTex.isCreated()) {
             stencilTex.bind(TextureUnit::STENCIL);
-            shader.uniform1i("material.stencilMap", TextureUnit::STENCIL);
-            shader.uniform1i("material.hasStencilMap", 1);
         }
         if (emissionTex.isCreated()) {
             emissionTex.bind(TextureUnit::EMISSION);
-            shader.uniform1i("material.emissionMap", TextureUnit::EMISSION);
-            shader.uniform1i("material.hasEmissionMap", 1);
         }
-        shader.uniform3f("material.emission", emission);
-        shader.uniform2f("material.tiling", tilingX, tilingY);
+        uniformBuffer.bindBase(MATERIAL_BLOCK);
     }
 
-    void Material::release(ShaderProgram& shader) const {
-        shader.uniform1i("material.hasDiffuseMap", 0);
-        shader.uniform1i("material.hasNormalMap", 0);
-        shader.uniform1i("material.hasMetalMap", 0);
-        shader.uniform1i("material.hasRoughnessMap", 0);
-        shader.uniform1i("material.hasStencilMap", 0);
-        shader.uniform1i("material.hasEmissionMap", 0);
+    unsigned int Material::getTextureCount() const {
+        return diffuseTex.isCreated() + normalTex.isCreated() + roughnessTex.isCreated()
+             + metalTex.isCreated() + stencilTex.isCreated() + emissionTex.isCreated();
+    }
+
+    void Material::setTextureUnits(ShaderProgram& shader) {
+        RenderState::useProgram(shader);
+        shader.uniform1i("diffuseMap", TextureUnit::ALBEDO);
+        shader.uniform1i("normalMap", TextureUnit::NORMAL);
+        shader.uniform1i("roughnessMap", TextureUnit::ROUGHNESS);
+        shader.uniform1i("metalMap", TextureUnit::METALNESS);
+        shader.uniform1i("stencilMap", TextureUnit::STENCIL);
+        shader.uniform1i("emissionMap", TextureUnit::EMISSION);
+
+        UniformBuffer::bindCurrentProgramBlock("MaterialBlock", MATERIAL_BLOCK);
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Texture.h"
+#include "Renderer/UniformBuffer.h"
 
 #include <GDT/Vector3f.h>
 
@@ -31,7 +32,19 @@ namespace Flux {
         GDT::Vector3f emission;
         float tilingX, tilingY;
 
-        void bind(ShaderProgram& shader) const;
-        void release(ShaderProgram& shader) const;
+        /** Uploads the material parameters to its uniform buffer, call after changing them */
+        void upload();
+
+        /** Binds the textures and the uniform buffer of the material */
+        void bind() const;
+
+        /** Number of textures bound by this material */
+        unsigned int getTextureCount() const;
+
+        /** Assigns the material texture units to the samplers of the shader and connects its material block */
+        static void setTextureUnits(ShaderProgram& shader);
+
+    private:
+        UniformBuffer uniformBuffer;
     };
 }
@@ -82,6 +82,8 @@ namespace Flux {
                 material->tilingY = std::stof(tokens[2].c_str());
             }
         }
+        material->upload();
+
         return material;
     }
 }
@@ -2,6 +2,7 @@
 
 #include "Component.h"
 #include "Util/Vector2f.h"
+#include "Util/Bounds.h"
 
 #include <GDT/Vector3f.h>
 
@@ -11,8 +12,19 @@
 using GDT::Vector3f;
 
 namespace Flux {
+    /** Simplified index list over the vertices of the full mesh */
+    struct MeshLod {
+        // Range relative to the first full index, the lodIndices follow the full indices wherever the mesh is uploaded
+        unsigned int firstIndex;
+        unsigned int indexCount;
+        // Square root of the largest collapse cost in object space, an upper bound on how far a kept vertex lies off the original planes it replaced
+        float error;
+    };
+
     class Mesh : public Component {
     public:
+        static const ComponentType TYPE = ComponentType::Mesh;
+
         std::string name;
         std::vector<Vector3f> vertices;
         std::vector<Vector2f> texCoords;
@@ -20,8 +32,28 @@ namespace Flux {
         std::vector<Vector3f> tangents;
         std::vector<unsigned int> indices;
 
+        // Increasingly coarse levels of detail, level zero is the full mesh and has no entry
+        std::vector<unsigned int> lodIndices;
+        std::vector<MeshLod> lods;
+
+        // Object space bounds, computed when the mesh is loaded
+        AABB bounds;
+        BoundingSphere boundingSphere;
+
+        // Vertex array with all attributes, and one with only positions for depth passes
         unsigned int handle;
+        unsigned int positionHandle;
         unsigned int indexBuffer;
+        unsigned int indexType;
+
+        // Transforms the stored, possibly quantized, positions back into object space
+        bool quantized = false;
+        Vector3f positionScale = Vector3f(1, 1, 1);
+        Vector3f positionOffset = Vector3f(0, 0, 0);
+
+        // Location of the geometry when the mesh is packed into a MeshPool
+        int baseVertex = 0;
+        unsigned int firstIndex = 0;
         std::string materialName;
     };
 }
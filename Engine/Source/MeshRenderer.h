@@ -6,6 +6,14 @@
 namespace Flux {
     class MeshRenderer : public Component {
     public:
+        static const ComponentType TYPE = ComponentType::MeshRenderer;
+
         uint32_t materialID;
+
+        // Static meshes never move, their shadows can be cached apart from moving casters
+        bool isStatic = false;
+
+        // Large and simple meshes hiding much of the scene, drawn into the software occlusion buffer
+        bool isOccluder = false;
     };
 }
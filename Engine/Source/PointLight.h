@@ -1,36 +1,68 @@
 #pragma once
 
 #include "Component.h"
-#include "Framebuffer.h"
+#include "Renderer/ShadowCache.h"
 
 #include <GDT/Vector3f.h>
 
 #include <memory>
+#include <algorithm>
+#include <cmath>
 
 namespace Flux {
     class PointLight : public Component {
     public:
-        const Vector3f transforms[6] = {
-            Vector3f(180, 90, 0),  // Positive X
-            Vector3f(180, -90, 0), // Negative X
-            Vector3f(90, 0, 0),    // Positive Y
-            Vector3f(-90, 0, 0),   // Negative Y
-            Vector3f(180, 0, 0),   // Positive Z
-            Vector3f(180, 180, 0)  // Negative Z
-        };
+        static const ComponentType TYPE = ComponentType::PointLight;
+
+        /** Returns the camera rotation looking down the given cubemap face */
+        static const Vector3f& faceRotation(unsigned int face) {
+            static const Vector3f transforms[6] = {
+                Vector3f(180, 90, 0),  // Positive X
+                Vector3f(180, -90, 0), // Negative X
+                Vector3f(90, 0, 0),    // Positive Y
+                Vector3f(-90, 0, 0),   // Negative Y
+                Vector3f(180, 0, 0),   // Positive Z
+                Vector3f(180, 180, 0)  // Negative Z
+            };
+            return transforms[face];
+        }
 
         PointLight()
             :
             energy(DEFAULT_ENERGY),
-            color(1, 1, 1)
+            color(1, 1, 1),
+            castShadows(true),
+            shadowImportance(1),
+            shadowSlot(-1)
         { }
 
-        const float DEFAULT_ENERGY = 1.0f;
+        /** Color of the light scaled by its energy */
+        Vector3f getIntensity() const {
+            return Vector3f(color.x * energy, color.y * energy, color.z * energy);
+        }
+
+        /** Distance at which the inverse square falloff of the light drops below the cutoff intensity */
+        float getRadius(float cutoff = CUTOFF_INTENSITY) const {
+            Vector3f intensity = getIntensity();
+            return std::sqrt(std::max(intensity.x, std::max(intensity.y, intensity.z)) / cutoff);
+        }
+
+        static constexpr float DEFAULT_ENERGY = 1.0f;
+        static constexpr float CUTOFF_INTENSITY = 0.01f;
 
         Vector3f color;
         float energy;
 
-        Cubemap shadowMap;
-        Framebuffer shadowBuffer;
+        // Lights without shadows skip the cubemap passes
+        bool castShadows;
+        // Scales the resolution the light asks for in the shadow atlas
+        float shadowImportance;
+
+        // Faces of the cubemap unrolled into the shadow atlas, in cubemap face order
+        ShadowTile shadowTiles[6];
+        // Index of the tiles in the atlas tile buffer, or -1 if the light got no space
+        int shadowSlot;
+        // One cache per face, layered rendering only uses the first for the whole cubemap
+        ShadowCache shadowCache[6];
     };
 }
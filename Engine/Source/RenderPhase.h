@@ -13,6 +13,9 @@
 using GDT::ShaderProgram;
 
 namespace Flux {
+    class RenderGraph;
+    class Framebuffer;
+
     class RenderPhase {
     public:
         RenderPhase(const char* name) : RenderPhase(String(name)) { }
@@ -32,6 +35,11 @@ namespace Flux {
             this->source = source;
         }
 
+        /** Framebuffer the pass renders its result into */
+        void SetTarget(const Framebuffer* target) {
+            this->target = target;
+        }
+
         void enable() {
             enabled = true;
         }
@@ -47,10 +55,29 @@ namespace Flux {
         virtual void Resize(const Size& windowSize) = 0;
         virtual void render(RenderState& renderState, const Scene& scene) = 0;
 
+        /** Declares the targets the pass renders into besides its own target, called after Resize whenever the graph is rebuilt */
+        virtual void setup(RenderGraph& graph) { }
+
+        /** Whether the pass reads the result of the pass before it, passes that do not leave the earlier ones unused */
+        virtual bool readsSource() const { return true; }
+
+        /**
+         * Shader file defining the function of a pass that only reads the pixel it writes,
+         * such passes can be fused into a single shader. Returns nullptr for other passes.
+         */
+        virtual const char* getStageSource() const { return nullptr; }
+
+        /** Name of the stage function, taking and returning the color of the pixel at the given texture coordinates */
+        virtual const char* getStageFunction() const { return nullptr; }
+
+        /** Binds the textures and sets the uniforms used by the stage function */
+        virtual void setStageUniforms(ShaderProgram& shader, const Scene& scene) { }
+
     protected:
         const Texture2D* source;
+        const Framebuffer* target;
 
-        CapabilitySet requiredSet;
+        PipelineState requiredSet;
 
     private:
         String name;
@@ -18,18 +18,180 @@ namespace Flux {
         return *toneMapPass;
     }
 
+    const std::vector<RenderPhase*>& Renderer::getHdrPipeline()
+    {
+        if (pipelinesDirty || passesToggled()) {
+            buildPipelines();
+        }
+        return hdrPipeline;
+    }
+
+    const std::vector<RenderPhase*>& Renderer::getLdrPipeline()
+    {
+        if (pipelinesDirty || passesToggled()) {
+            buildPipelines();
+        }
+        return ldrPipeline;
+    }
+
     void Renderer::addHdrPass(std::unique_ptr<RenderPhase> hdrPass)
     {
         hdrPasses.push_back(std::move(hdrPass));
+        pipelinesDirty = true;
+        renderGraphDirty = true;
     }
 
     void Renderer::addLdrPass(std::unique_ptr<RenderPhase> ldrPass)
     {
         ldrPasses.push_back(std::move(ldrPass));
+        pipelinesDirty = true;
+        renderGraphDirty = true;
     }
 
     void Renderer::setToneMapPass(std::unique_ptr<TonemapPass> toneMapPass)
     {
         this->toneMapPass.reset(toneMapPass.release());
+        pipelinesDirty = true;
+        renderGraphDirty = true;
+    }
+
+    void Renderer::setPassFusion(bool enabled)
+    {
+        passFusion = enabled;
+        pipelinesDirty = true;
+        renderGraphDirty = true;
+    }
+
+    bool Renderer::isRenderGraphDirty()
+    {
+        return renderGraphDirty || pipelinesDirty || passesToggled();
+    }
+
+    void Renderer::getPasses(std::vector<RenderPhase*>& passes)
+    {
+        passes.clear();
+        for (const std::unique_ptr<RenderPhase>& hdrPass : hdrPasses) {
+            passes.push_back(hdrPass.get());
+        }
+        if (toneMapPass) {
+            passes.push_back(toneMapPass.get());
+        }
+        for (const std::unique_ptr<RenderPhase>& ldrPass : ldrPasses) {
+            passes.push_back(ldrPass.get());
+        }
+    }
+
+    bool Renderer::passesToggled()
+    {
+        std::vector<RenderPhase*> passes;
+        getPasses(passes);
+
+        if (passes.size() != enabledPasses.size())
+            return true;
+        for (size_t i = 0; i < passes.size(); i++) {
+            if (passes[i]->isEnabled() != enabledPasses[i])
+                return true;
+        }
+        return false;
+    }
+
+    void Renderer::buildPipelines()
+    {
+        fusedPasses.clear();
+
+        // Disabled passes are left out here, so they are neither fused nor added to the graph
+        std::vector<RenderPhase*> passes;
+        getPasses(passes);
+        enabledPasses.clear();
+        for (RenderPhase* pass : passes) {
+            enabledPasses.push_back(pass->isEnabled());
+        }
+
+        passes.clear();
+        for (const std::unique_ptr<RenderPhase>& hdrPass : hdrPasses) {
+            if (hdrPass->isEnabled()) {
+                passes.push_back(hdrPass.get());
+            }
+        }
+        fusePasses(passes, hdrPipeline);
+
+        passes.clear();
+        if (toneMapPass && toneMapPass->isEnabled()) {
+            passes.push_back(toneMapPass.get());
+        }
+        for (const std::unique_ptr<RenderPhase>& ldrPass : ldrPasses) {
+            if (ldrPass->isEnabled()) {
+                passes.push_back(ldrPass.get());
+            }
+        }
+        fusePasses(passes, ldrPipeline);
+
+        pipelinesDirty = false;
+    }
+
+    void Renderer::buildRenderGraph(const RenderTargetDesc& hdrDesc, const RenderTargetDesc& ldrDesc)
+    {
+        renderGraph.clear();
+
+        RenderResource color = renderGraph.createTarget(hdrDesc);
+        for (RenderPhase* pass : getHdrPipeline()) {
+            RenderResource output = renderGraph.createTarget(hdrDesc);
+            renderGraph.addPass(pass, color, output);
+            color = output;
+        }
+
+        // The first LDR pass tonemaps the HDR result
+        for (RenderPhase* pass : getLdrPipeline()) {
+            RenderResource output = renderGraph.createTarget(ldrDesc);
+            renderGraph.addPass(pass, color, output);
+            color = output;
+        }
+
+        renderGraph.setOutput(color);
+        renderGraph.compile(targetPool);
+        graphOutput = color;
+
+        renderGraphDirty = false;
+    }
+
+    void Renderer::fusePasses(const std::vector<RenderPhase*>& passes, std::vector<RenderPhase*>& pipeline)
+    {
+        pipeline.clear();
+
+        std::vector<RenderPhase*> stages;
+        auto flushStages = [&]() {
+            // A single stage gains nothing from a generated shader
+            if (stages.size() == 1) {
+                pipeline.push_back(stages[0]);
+            }
+            else if (stages.size() > 1) {
+                std::unique_ptr<FusedPass> fusedPass = std::make_unique<FusedPass>(stages);
+
+                // Without a working fused shader every stage still has its own
+                if (fusedPass->isValid()) {
+                    fusedPasses.push_back(std::move(fusedPass));
+                    pipeline.push_back(fusedPasses.back().get());
+                } else {
+                    pipeline.insert(pipeline.end(), stages.begin(), stages.end());
+                }
+            }
+            stages.clear();
+        };
+
+        for (RenderPhase* pass : passes) {
+            if (passFusion && FusedPass::canFuse(stages, pass)) {
+                stages.push_back(pass);
+                continue;
+            }
+            flushStages();
+
+            if (passFusion && pass->getStageSource()) {
+                stages.push_back(pass);
+            }
+            else {
+                pipeline.push_back(pass);
+            }
+        }
+        flushStages();
     }
 }
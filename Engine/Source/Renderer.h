@@ -5,6 +5,8 @@
 #include "Renderer/RenderState.h"
 #include "RenderPhase.h"
 #include "Renderer/TonemapPass.h"
+#include "Renderer/FusedPass.h"
+#include "Renderer/RenderGraph.h"
 
 #include "Framebuffer.h"
 #include "Util/Size.h"
@@ -17,10 +19,40 @@
 using GDT::ShaderProgram;
 
 namespace Flux {
+    class Mesh;
+
+    /** Number of meshes drawn and rejected by frustum culling for a single view */
+    struct CullStats {
+        const char* view;
+        uint32_t entity;
+        int face;
+        uint32_t visible;
+        uint32_t culled;
+    };
+
+    /** Draw submission counters, including the state changes avoided by sorting */
+    struct DrawStats {
+        uint32_t drawCalls;
+        uint32_t instances;
+        uint32_t materialBinds;
+        uint32_t materialBindsSaved;
+        uint32_t meshBinds;
+        uint32_t meshBindsSaved;
+        uint32_t textureBindsSaved;
+        uint32_t uniformWritesSaved;
+        uint32_t shadowViewsRendered;
+        uint32_t shadowViewsCached;
+        // Meshes hidden in the depth pyramid that were left to an occlusion query
+        uint32_t occlusionQueries;
+        // Instances drawn with a simplified index list
+        uint32_t lodInstances;
+    };
+
     class Renderer {
     public:
         Renderer() :
-            windowSize(800, 600)
+            windowSize(800, 600),
+            drawStats()
         {
             
         }
@@ -29,26 +61,76 @@ namespace Flux {
         virtual void onResize(const Size windowSize) = 0;
         virtual void update(const Scene& scene) = 0;
         virtual void renderScene(const Scene& scene, ShaderProgram& shader) = 0;
-        virtual void renderMesh(const Scene& scene, ShaderProgram& shader, Entity* entity) = 0;
+        /** Draws instances of the mesh using the uniform blocks that are currently bound */
+        virtual void renderMesh(const Mesh& mesh, uint32_t instanceCount) = 0;
 
         const std::vector<std::unique_ptr<RenderPhase>>& getHdrPasses();
         const std::vector<std::unique_ptr<RenderPhase>>& getLdrPasses();
         TonemapPass& getToneMapPass();
 
+        /** Passes to run for HDR rendering, with consecutive per pixel passes fused if enabled */
+        const std::vector<RenderPhase*>& getHdrPipeline();
+        /** Passes to run for LDR rendering starting with the tonemap pass, which reads the HDR buffer */
+        const std::vector<RenderPhase*>& getLdrPipeline();
+
+        /** Culling results of every view rendered during the last frame */
+        const std::vector<CullStats>& getCullStats() const {
+            return cullStats;
+        }
+
+        /** Submission counters of all views rendered during the last frame */
+        const DrawStats& getDrawStats() const {
+            return drawStats;
+        }
+
         void addHdrPass(std::unique_ptr<RenderPhase> hdrPass);
         void addLdrPass(std::unique_ptr<RenderPhase> ldrPass);
         void setToneMapPass(std::unique_ptr<TonemapPass> tonemapPass);
+        void setPassFusion(bool enabled);
 
     protected:
+        /**
+         * Rebuilds the graph running the HDR passes followed by the LDR passes, every
+         * pass rendering into a new target of the given description. Disabled passes
+         * are left out, passes that nothing reads from are culled.
+         */
+        void buildRenderGraph(const RenderTargetDesc& hdrDesc, const RenderTargetDesc& ldrDesc);
+
+        /** Whether the graph has to be rebuilt, also after a pass was enabled or disabled */
+        bool isRenderGraphDirty();
+
         RenderState renderState;
 
+        RenderTargetPool targetPool;
+        RenderGraph renderGraph;
+        // Target holding the final image after the graph ran
+        RenderResource graphOutput = 0;
+        // Set when a pass or the window size changed since the graph was built
+        bool renderGraphDirty = true;
+
         Size windowSize;
 
         std::vector<Framebuffer> backBuffers;
         std::vector<Framebuffer> hdrBackBuffers;
+
+        std::vector<CullStats> cullStats;
+        DrawStats drawStats;
     private:
         std::vector<std::unique_ptr<RenderPhase>> hdrPasses;
         std::vector<std::unique_ptr<RenderPhase>> ldrPasses;
         std::unique_ptr<TonemapPass> toneMapPass;
+
+        void getPasses(std::vector<RenderPhase*>& passes);
+        bool passesToggled();
+        void buildPipelines();
+        void fusePasses(const std::vector<RenderPhase*>& passes, std::vector<RenderPhase*>& pipeline);
+
+        bool passFusion = true;
+        bool pipelinesDirty = true;
+        std::vector<RenderPhase*> hdrPipeline;
+        std::vector<RenderPhase*> ldrPipeline;
+        std::vector<std::unique_ptr<FusedPass>> fusedPasses;
+        // Whether every pass was enabled when the pipelines were built, in the order of getPasses
+        std::vector<bool> enabledPasses;
     };
 }
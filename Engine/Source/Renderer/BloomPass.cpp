@@ -6,34 +6,58 @@
 #include "Texture.h"
 #include "Framebuffer.h"
 
+#include <algorithm>
+
 namespace Flux {
-    BloomPass::BloomPass() : RenderPhase("Bloom")
+    BloomPass::BloomPass() : RenderPhase("Bloom"),
+        windowSize(1, 1),
+        levels(1),
+        threshold(0),
+        knee(0),
+        intensity(0.5f)
     {
-        shader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/Bloom.frag");
+        downsampleShader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/BloomDownsample.frag");
+        upsampleShader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/BloomUpsample.frag");
 
         requiredSet.addCapability(STENCIL_TEST, true);
         requiredSet.addCapability(DEPTH_TEST, false);
+        requiredSet.addCapability(BLENDING, false);
+        requiredSet.setStencilFunc(GL_ALWAYS, 0, 0xFF);
+
+        upsampleSet.addCapability(STENCIL_TEST, false);
+        upsampleSet.addCapability(DEPTH_TEST, false);
+        upsampleSet.addCapability(BLENDING, true);
+        upsampleSet.setBlendFunc(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
     }
 
     void BloomPass::Resize(const Size& windowSize)
     {
-        Texture2D bloomTex;
-        bloomTex.create();
-        bloomTex.bind(TextureUnit::TEXTURE0);
-        bloomTex.setData(windowSize.width, windowSize.height, GL_RGBA16F, GL_RGBA, GL_FLOAT, nullptr);
-        bloomTex.setWrapping(CLAMP, CLAMP);
-        bloomTex.setSampling(LINEAR, LINEAR, LINEAR);
-        bloomTex.generateMipmaps();
-        bloomTex.release();
-
-        buffer.create();
-        buffer.bind();
-        // Textures are linearly sampled for first step of gaussian bloom blur
-        buffer.addColorTexture(0, bloomTex);
-        buffer.validate();
-        buffer.release();
-
-        blurPass.Resize(windowSize);
+        this->windowSize = windowSize;
+
+        const unsigned int width = std::max(windowSize.width / 2, 1u);
+        const unsigned int height = std::max(windowSize.height / 2, 1u);
+
+        // Stop before the smallest level degenerates into a single texel
+        levels = 1;
+        while (levels < MAX_LEVELS && (width >> levels) >= 2 && (height >> levels) >= 2) {
+            levels++;
+        }
+    }
+
+    void BloomPass::setup(RenderGraph& graph)
+    {
+        graph.createPassTarget(RenderTargetDesc(std::max(windowSize.width / 2, 1u), std::max(windowSize.height / 2, 1u), GL_RGBA16F, LINEAR, levels), &bloomTarget);
+    }
+
+    void BloomPass::setThreshold(float threshold, float knee)
+    {
+        this->threshold = threshold;
+        this->knee = knee;
+    }
+
+    void BloomPass::setIntensity(float intensity)
+    {
+        this->intensity = intensity;
     }
 
     void BloomPass::render(RenderState& renderState, const Scene& scene)
@@ -41,33 +65,62 @@ namespace Flux {
         renderState.require(requiredSet);
         nvtxRangePushA(getPassName().c_str());
 
-        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        Texture2D& bloomTex = bloomTarget->getTexture();
 
-        const Framebuffer* sourceFramebuffer = RenderState::currentFramebuffer;
+        // Reading and writing different levels of the bloom texture is only defined while
+        // the sampled range is restricted to the level being read
+        auto restrictLevel = [&bloomTex](unsigned int level) {
+            bloomTex.bind(TextureUnit::TEXTURE);
+            bloomTex.setBaseMipmapLevel(level);
+            bloomTex.setMaxMipmapLevel(level);
+        };
 
-        shader.bind();
+        RenderState::useProgram(downsampleShader);
+        downsampleShader.uniform1i("tex", TextureUnit::TEXTURE);
+        downsampleShader.uniform1f("threshold", threshold);
+        downsampleShader.uniform1f("knee", knee);
 
+        // The first step reads the source and applies the threshold
         source->bind(TextureUnit::TEXTURE);
-
-        shader.uniform1i("tex", TextureUnit::TEXTURE);
-        shader.uniform1f("threshold", 0);
-
-        buffer.bind();
-
+        downsampleShader.uniform1i("prefilter", true);
+        downsampleShader.uniform2f("texelSize", 1.0f / source->getWidth(), 1.0f / source->getHeight());
+        bloomTarget->getFramebuffer(0).bind();
+        renderState.setViewport(0, 0, bloomTex.getWidth(), bloomTex.getHeight());
         renderState.drawQuad();
 
-        // Blur the buffer
-        blurPass.SetSource(&buffer.getTexture());
-        blurPass.render(renderState, scene);
-
-        // Add the bloom to the HDR buffer
-        sourceFramebuffer->bind();
-
-        std::vector<Texture2D> sources{ *source, buffer.getTexture() };
-        std::vector<float> weights{ 1, 0.5f };
-        addPass.SetTextures(sources);
-        addPass.SetWeights(weights);
-        addPass.render(renderState, scene);
+        downsampleShader.uniform1i("prefilter", false);
+        for (unsigned int level = 1; level < levels; level++) {
+            restrictLevel(level - 1);
+            downsampleShader.uniform2f("texelSize", 1.0f / (bloomTex.getWidth() >> (level - 1)), 1.0f / (bloomTex.getHeight() >> (level - 1)));
+            bloomTarget->getFramebuffer(level).bind();
+            renderState.setViewport(0, 0, bloomTex.getWidth() >> level, bloomTex.getHeight() >> level);
+            renderState.drawQuad();
+        }
+
+        // Accumulate every level onto the one above it, the downsampled result stays as the base
+        renderState.require(upsampleSet);
+        RenderState::useProgram(upsampleShader);
+        upsampleShader.uniform1i("tex", TextureUnit::TEXTURE);
+        upsampleShader.uniform1i("composite", false);
+        for (unsigned int level = levels - 1; level > 0; level--) {
+            restrictLevel(level);
+            upsampleShader.uniform2f("texelSize", 1.0f / (bloomTex.getWidth() >> level), 1.0f / (bloomTex.getHeight() >> level));
+            bloomTarget->getFramebuffer(level - 1).bind();
+            renderState.setViewport(0, 0, bloomTex.getWidth() >> (level - 1), bloomTex.getHeight() >> (level - 1));
+            renderState.drawQuad();
+        }
+
+        // Add the top level to the HDR buffer, the top level holds the sum of all levels
+        renderState.require(requiredSet);
+        restrictLevel(0);
+        source->bind(TextureUnit::TEXTURE1);
+        upsampleShader.uniform1i("composite", true);
+        upsampleShader.uniform1i("sceneTex", TextureUnit::TEXTURE1);
+        upsampleShader.uniform1f("intensity", intensity / levels);
+        upsampleShader.uniform2f("texelSize", 1.0f / bloomTex.getWidth(), 1.0f / bloomTex.getHeight());
+        target->bind();
+        renderState.setViewport(0, 0, windowSize.width, windowSize.height);
+        renderState.drawQuad();
 
         nvtxRangePop();
     }
@@ -1,15 +1,17 @@
 #pragma once
 
 #include "RenderPhase.h"
-#include "AddPass.h"
-#include "GaussianBlurPass.h"
+#include "Renderer/RenderGraph.h"
 
-#include <memory>
+#include "Util/Size.h"
 
 namespace Flux {
-    class Texture2D;
-    class Framebuffer;
-
+    /**
+     * Dual filter bloom. The thresholded source is downsampled straight into
+     * the mip chain of a half resolution texture, after which every level is
+     * upsampled with a tent filter and added onto the level above it. The
+     * last upsample is composited onto the source in the same draw.
+     */
     class BloomPass : public RenderPhase
     {
     public:
@@ -17,14 +19,29 @@ namespace Flux {
 
         void Resize(const Size& windowSize) override;
 
+        void setup(RenderGraph& graph) override;
+
         void render(RenderState& renderState, const Scene& scene) override;
 
+        /** Only radiance above the threshold blooms, fading in over the knee below and above it */
+        void setThreshold(float threshold, float knee);
+        void setIntensity(float intensity);
+
+        static const unsigned int MAX_LEVELS = 6;
+
     private:
-        ShaderProgram shader;
+        ShaderProgram downsampleShader;
+        ShaderProgram upsampleShader;
+
+        PipelineState upsampleSet;
 
-        Framebuffer buffer;
+        Size windowSize;
+        unsigned int levels;
+        // Half resolution target whose mip levels hold the chain
+        RenderTarget* bloomTarget = nullptr;
 
-        GaussianBlurPass blurPass;
-        AddPass addPass;
+        float threshold;
+        float knee;
+        float intensity;
     };
 }
@@ -11,7 +11,10 @@
 namespace Flux {
     ColorGradingPass::ColorGradingPass() : RenderPhase("Color Grading")
     {
-        shader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/ColorGrading.frag");
+        shader.addShader(GDT::VERTEX, "res/Shaders/Quad.vert");
+        shader.addShader(GDT::FRAGMENT, "res/Shaders/ColorGrading.frag");
+        shader.addShader(GDT::FRAGMENT, getStageSource());
+        shader.build();
         lut.loadFromFile(Path("res/reinhart_grading.png"), COLOR);
         lut.setWrapping(CLAMP, CLAMP, CLAMP);
         lut.setSampling(LINEAR, LINEAR);
@@ -25,18 +28,23 @@ namespace Flux {
 
     }
 
+    void ColorGradingPass::setStageUniforms(ShaderProgram& shader, const Scene& scene)
+    {
+        lut.bind(TextureUnit::TEXTURE1);
+        shader.uniform1i("lut", TextureUnit::TEXTURE1);
+    }
+
     void ColorGradingPass::render(RenderState& renderState, const Scene& scene)
     {
         renderState.require(requiredSet);
 
         nvtxRangePushA(getPassName().c_str());
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
         source->bind(TextureUnit::TEXTURE0);
         shader.uniform1i("tex", TextureUnit::TEXTURE0);
-        lut.bind(TextureUnit::TEXTURE1);
-        shader.uniform1i("lut", TextureUnit::TEXTURE1);
+        setStageUniforms(shader, scene);
 
         renderState.drawQuad();
 
@@ -18,6 +18,10 @@ namespace Flux
 
         void render(RenderState& renderState, const Scene& scene) override;
 
+        const char* getStageSource() const override { return "res/Shaders/Stages/ColorGrading.frag"; }
+        const char* getStageFunction() const override { return "gradeColor"; }
+        void setStageUniforms(ShaderProgram& shader, const Scene& scene) override;
+
     private:
         ShaderProgram shader;
 
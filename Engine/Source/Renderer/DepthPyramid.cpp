@@ -0,0 +1,287 @@
+#include "Renderer/DepthPyramid.h"
+
+#include "TextureUnit.h"
+
+#include "nvToolsExt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Flux {
+    namespace
+    {
+        // Depths are stored with 24 bits, a box touching its own surface must not hide behind it
+        const float DEPTH_TOLERANCE = 1e-5f;
+
+        /** Maps a normalized device coordinate to a texel of a level that halved the full resolution the given number of times */
+        unsigned int toTexel(float ndc, unsigned int fullSize, unsigned int shift, unsigned int levelSize)
+        {
+            int pixel = (int) std::floor((ndc * 0.5f + 0.5f) * fullSize);
+            pixel = std::min(std::max(pixel, 0), (int) fullSize - 1);
+            return std::min((unsigned int) pixel >> shift, levelSize - 1);
+        }
+
+        /** Same footprint as DepthPyramid.frag, the last texel of a row or column also covers an odd one left over */
+        void reduceLevel(const std::vector<float>& source, unsigned int sourceWidth, unsigned int sourceHeight,
+            std::vector<float>& dest, unsigned int width, unsigned int height)
+        {
+            dest.resize(width * height);
+            for (unsigned int y = 0; y < height; y++) {
+                const unsigned int y1 = y + 1 == height ? sourceHeight - 1 : std::min(y * 2 + 1, sourceHeight - 1);
+
+                for (unsigned int x = 0; x < width; x++) {
+                    const unsigned int x1 = x + 1 == width ? sourceWidth - 1 : std::min(x * 2 + 1, sourceWidth - 1);
+
+                    float depth = 0;
+                    for (unsigned int sy = y * 2; sy <= y1; sy++) {
+                        for (unsigned int sx = x * 2; sx <= x1; sx++) {
+                            depth = std::max(depth, source[sy * sourceWidth + sx]);
+                        }
+                    }
+                    dest[y * width + x] = depth;
+                }
+            }
+        }
+    }
+
+    void DepthPyramid::create(unsigned int width, unsigned int height) {
+        if (!shader.isLinked()) {
+            shader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/DepthPyramid.frag");
+
+            requiredSet.addCapability(BLENDING, false);
+            requiredSet.setColorMask(true);
+        }
+
+        destroy();
+
+        this->width = width;
+        this->height = height;
+
+        readbackLevel = 0;
+        while (getLevelWidth(readbackLevel) > MAX_READBACK_WIDTH) {
+            readbackLevel++;
+        }
+
+        texture.create();
+        texture.bind(TextureUnit::TEXTURE0);
+        texture.setData(getLevelWidth(0), getLevelHeight(0), GL_R32F, GL_RED, GL_FLOAT, nullptr);
+        for (unsigned int level = 1; level <= readbackLevel; level++) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, getLevelWidth(level), getLevelHeight(level), 0, GL_RED, GL_FLOAT, nullptr);
+        }
+        texture.setWrapping(CLAMP, CLAMP);
+        texture.setSampling(NEAREST, NEAREST, NEAREST);
+        texture.setMaxMipmapLevel(readbackLevel);
+        texture.release();
+
+        levels.resize(readbackLevel + 1);
+        for (unsigned int level = 0; level <= readbackLevel; level++) {
+            Framebuffer& framebuffer = levels[level];
+            framebuffer.create();
+            framebuffer.bind();
+            framebuffer.addColorTexture(0, texture, level);
+            framebuffer.validate();
+            framebuffer.release();
+        }
+
+        const GLsizeiptr size = getLevelWidth(readbackLevel) * getLevelHeight(readbackLevel) * sizeof(float);
+        glGenBuffers(READBACK_BUFFERS, packBuffers);
+        for (unsigned int i = 0; i < READBACK_BUFFERS; i++) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+            packFences[i] = nullptr;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        nextBuffer = 0;
+    }
+
+    void DepthPyramid::destroy() {
+        if (!texture.isCreated())
+            return;
+
+        for (Framebuffer& framebuffer : levels) {
+            framebuffer.destroy();
+        }
+        levels.clear();
+        texture.destroy();
+
+        for (unsigned int i = 0; i < READBACK_BUFFERS; i++) {
+            if (packFences[i]) {
+                glDeleteSync(packFences[i]);
+                packFences[i] = nullptr;
+            }
+        }
+        glDeleteBuffers(READBACK_BUFFERS, packBuffers);
+
+        // A copy of another resolution no longer matches the texel mapping
+        copyLevels.clear();
+        copyWidths.clear();
+        copyHeights.clear();
+    }
+
+    unsigned int DepthPyramid::getLevelWidth(unsigned int level) const {
+        return std::max(width >> (level + 1), 1u);
+    }
+
+    unsigned int DepthPyramid::getLevelHeight(unsigned int level) const {
+        return std::max(height >> (level + 1), 1u);
+    }
+
+    void DepthPyramid::build(RenderState& renderState, const Texture2D& depthTex, const Matrix4f& projViewMatrix) {
+        renderState.require(requiredSet);
+        nvtxRangePushA("Depth Pyramid");
+
+        RenderState::useProgram(shader);
+        shader.uniform1i("depthMap", TextureUnit::TEXTURE0);
+
+        // Every level reads the one above it, restricted to that level so reading and writing do not overlap
+        for (unsigned int level = 0; level <= readbackLevel; level++) {
+            if (level == 0) {
+                depthTex.bind(TextureUnit::TEXTURE0);
+                shader.uniform2i("sourceSize", width, height);
+            } else {
+                texture.bind(TextureUnit::TEXTURE0);
+                texture.setBaseMipmapLevel(level - 1);
+                texture.setMaxMipmapLevel(level - 1);
+                shader.uniform2i("sourceSize", getLevelWidth(level - 1), getLevelHeight(level - 1));
+            }
+            levels[level].bind();
+            renderState.setViewport(0, 0, getLevelWidth(level), getLevelHeight(level));
+            renderState.drawQuad();
+        }
+        texture.bind(TextureUnit::TEXTURE0);
+        texture.setBaseMipmapLevel(0);
+        texture.setMaxMipmapLevel(readbackLevel);
+
+        // The copy lands in a pack buffer, mapping it is deferred until its fence has passed
+        if (packFences[nextBuffer]) {
+            glDeleteSync(packFences[nextBuffer]);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[nextBuffer]);
+        glReadPixels(0, 0, getLevelWidth(readbackLevel), getLevelHeight(readbackLevel), GL_RED, GL_FLOAT, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        packFences[nextBuffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        packMatrices[nextBuffer] = projViewMatrix;
+        nextBuffer = (nextBuffer + 1) % READBACK_BUFFERS;
+
+        nvtxRangePop();
+    }
+
+    void DepthPyramid::update() {
+        // Look for the newest finished copy, older ones are dropped along with it
+        for (unsigned int age = 1; age <= READBACK_BUFFERS; age++) {
+            const unsigned int i = (nextBuffer + READBACK_BUFFERS - age) % READBACK_BUFFERS;
+            if (!packFences[i])
+                continue;
+
+            GLenum status = glClientWaitSync(packFences[i], 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                continue;
+
+            const unsigned int copyWidth = getLevelWidth(readbackLevel);
+            const unsigned int copyHeight = getLevelHeight(readbackLevel);
+
+            copyLevels.resize(1);
+            copyWidths.assign(1, copyWidth);
+            copyHeights.assign(1, copyHeight);
+            copyLevels[0].resize(copyWidth * copyHeight);
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[i]);
+            const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, copyLevels[0].size() * sizeof(float), GL_MAP_READ_BIT);
+            if (data) {
+                memcpy(copyLevels[0].data(), data, copyLevels[0].size() * sizeof(float));
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            copyMatrix = packMatrices[i];
+
+            for (unsigned int j = 0; j < READBACK_BUFFERS; j++) {
+                const unsigned int older = (i + READBACK_BUFFERS - j) % READBACK_BUFFERS;
+                if (j + age <= READBACK_BUFFERS && packFences[older]) {
+                    glDeleteSync(packFences[older]);
+                    packFences[older] = nullptr;
+                }
+            }
+
+            if (!data) {
+                copyLevels.clear();
+                return;
+            }
+            reduceCopy();
+            return;
+        }
+    }
+
+    void DepthPyramid::reduceCopy() {
+        while (copyWidths.back() > 1 || copyHeights.back() > 1) {
+            const unsigned int sourceWidth = copyWidths.back();
+            const unsigned int sourceHeight = copyHeights.back();
+            const unsigned int levelWidth = std::max(sourceWidth / 2, 1u);
+            const unsigned int levelHeight = std::max(sourceHeight / 2, 1u);
+
+            copyLevels.emplace_back();
+            reduceLevel(copyLevels[copyLevels.size() - 2], sourceWidth, sourceHeight, copyLevels.back(), levelWidth, levelHeight);
+            copyWidths.push_back(levelWidth);
+            copyHeights.push_back(levelHeight);
+        }
+    }
+
+    bool DepthPyramid::isOccluded(const AABB& box) const {
+        if (copyLevels.empty())
+            return false;
+
+        float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+        float minDepth = INFINITY;
+        for (int i = 0; i < 8; i++) {
+            const float x = (i & 1) ? box.max.x : box.min.x;
+            const float y = (i & 2) ? box.max.y : box.min.y;
+            const float z = (i & 4) ? box.max.z : box.min.z;
+
+            // Column-major, the copied frame's matrices place the box where its depth was stored
+            const Matrix4f& m = copyMatrix;
+            const float clipX = m[0] * x + m[4] * y + m[8] * z + m[12];
+            const float clipY = m[1] * x + m[5] * y + m[9] * z + m[13];
+            const float clipZ = m[2] * x + m[6] * y + m[10] * z + m[14];
+            const float clipW = m[3] * x + m[7] * y + m[11] * z + m[15];
+
+            // Nothing is known about a box reaching behind the camera of that frame
+            if (clipW <= 0)
+                return false;
+
+            minX = std::min(minX, clipX / clipW);
+            maxX = std::max(maxX, clipX / clipW);
+            minY = std::min(minY, clipY / clipW);
+            maxY = std::max(maxY, clipY / clipW);
+            minDepth = std::min(minDepth, clipZ / clipW * 0.5f + 0.5f);
+        }
+
+        // A box that was outside the copied view has no depth to be tested against
+        if (maxX < -1 || minX > 1 || maxY < -1 || minY > 1)
+            return false;
+
+        const unsigned int shift = readbackLevel + 1;
+        const unsigned int x0 = toTexel(minX, width, shift, copyWidths[0]);
+        const unsigned int x1 = toTexel(maxX, width, shift, copyWidths[0]);
+        const unsigned int y0 = toTexel(minY, height, shift, copyHeights[0]);
+        const unsigned int y1 = toTexel(maxY, height, shift, copyHeights[0]);
+
+        // Pick the finest level where at most 4x4 texels cover the box
+        unsigned int level = 0;
+        while (level + 1 < copyLevels.size() && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3)) {
+            level++;
+        }
+
+        const std::vector<float>& depths = copyLevels[level];
+        const unsigned int levelWidth = copyWidths[level];
+        const unsigned int levelHeight = copyHeights[level];
+
+        float maxDepth = 0;
+        for (unsigned int y = std::min(y0 >> level, levelHeight - 1); y <= std::min(y1 >> level, levelHeight - 1); y++) {
+            for (unsigned int x = std::min(x0 >> level, levelWidth - 1); x <= std::min(x1 >> level, levelWidth - 1); x++) {
+                maxDepth = std::max(maxDepth, depths[y * levelWidth + x]);
+            }
+        }
+        return minDepth > maxDepth + DEPTH_TOLERANCE;
+    }
+}
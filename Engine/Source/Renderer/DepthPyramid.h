@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Renderer/RenderState.h"
+
+#include "Framebuffer.h"
+#include "Texture.h"
+#include "Util/Bounds.h"
+
+#include <GDT/Matrix4f.h>
+#include <GDT/Shader.h>
+
+#include <glad/glad.h>
+
+#include <vector>
+
+using GDT::Matrix4f;
+using GDT::ShaderProgram;
+
+namespace Flux {
+    /**
+     * Hierarchical depth buffer in which every texel holds the farthest depth
+     * of the 2x2 texels above it, starting at half the resolution of the depth
+     * buffer. The GPU reduces down to a coarse level, which is copied to the
+     * CPU without waiting on the GPU and reduced further there. Bounds are
+     * tested against the copy using the matrices of the frame it was taken
+     * from, so the test stays valid while the camera moves.
+     */
+    class DepthPyramid {
+    public:
+        /** Creates the levels for a depth buffer of the given size, dropping any earlier copy */
+        void create(unsigned int width, unsigned int height);
+        void destroy();
+
+        /** Reduces the depth texture into the pyramid and starts copying the coarse level to the CPU */
+        void build(RenderState& renderState, const Texture2D& depthTex, const Matrix4f& projViewMatrix);
+
+        /** Takes over the newest copy the GPU has finished, never waits for one that is still in flight */
+        void update();
+
+        /** Returns true if the box lies entirely behind the depth of the copied frame */
+        bool isOccluded(const AABB& box) const;
+
+        const Texture2D& getTexture() const {
+            return texture;
+        }
+
+        /** Width of the level copied to the CPU, finer levels only exist on the GPU */
+        static const unsigned int MAX_READBACK_WIDTH = 128;
+        static const unsigned int READBACK_BUFFERS = 3;
+
+    private:
+        unsigned int getLevelWidth(unsigned int level) const;
+        unsigned int getLevelHeight(unsigned int level) const;
+        void reduceCopy();
+
+        ShaderProgram shader;
+        PipelineState requiredSet;
+
+        unsigned int width = 0;
+        unsigned int height = 0;
+        unsigned int readbackLevel = 0;
+
+        Texture2D texture;
+        std::vector<Framebuffer> levels;
+
+        // Copies of the coarse level in flight, the oldest buffer is reused once all are taken
+        GLuint packBuffers[READBACK_BUFFERS];
+        GLsync packFences[READBACK_BUFFERS] = {};
+        Matrix4f packMatrices[READBACK_BUFFERS];
+        unsigned int nextBuffer = 0;
+
+        // Coarse level copied from the GPU followed by its own reductions down to a single texel
+        std::vector<std::vector<float>> copyLevels;
+        std::vector<unsigned int> copyWidths;
+        std::vector<unsigned int> copyHeights;
+        Matrix4f copyMatrix;
+    };
+}
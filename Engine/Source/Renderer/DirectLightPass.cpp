@@ -8,10 +8,21 @@
 #include "Util/Math.h"
 #include "GGX.h"
 
+#include "Transform.h"
+#include "Camera.h"
+#include "PointLight.h"
 #include "DirectionalLight.h"
 #include "AreaLight.h"
 
 #include <GDT/Matrix4f.h>
+#include <GDT/Vector4f.h>
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+using GDT::Vector4f;
 
 namespace Flux {
     namespace
@@ -48,6 +59,102 @@ namespace Flux {
 
             return matTex;
         }
+
+        /** Creates a low polygon sphere enclosing the unit sphere, so its faces never cut into a light radius */
+        GLuint createSphere(unsigned int rings, unsigned int segments, GLsizei& indexCount)
+        {
+            const float PI = 3.14159265f;
+            const float scale = 1 / (std::cos(PI / segments) * std::cos(PI / (2 * rings)));
+
+            std::vector<float> vertices;
+            for (unsigned int ring = 0; ring <= rings; ring++) {
+                float theta = PI * ring / rings;
+                for (unsigned int segment = 0; segment <= segments; segment++) {
+                    float phi = 2 * PI * segment / segments;
+                    vertices.push_back(std::sin(theta) * std::cos(phi) * scale);
+                    vertices.push_back(std::cos(theta) * scale);
+                    vertices.push_back(std::sin(theta) * std::sin(phi) * scale);
+                }
+            }
+
+            std::vector<unsigned short> indices;
+            for (unsigned int ring = 0; ring < rings; ring++) {
+                for (unsigned int segment = 0; segment < segments; segment++) {
+                    unsigned short i0 = (unsigned short) (ring * (segments + 1) + segment);
+                    unsigned short i1 = (unsigned short) (i0 + segments + 1);
+                    indices.insert(indices.end(), { i0, i1, (unsigned short) (i0 + 1), (unsigned short) (i0 + 1), i1, (unsigned short) (i1 + 1) });
+                }
+            }
+            indexCount = (GLsizei) indices.size();
+
+            GLuint vao, vbo, ibo;
+            glGenVertexArrays(1, &vao);
+            glGenBuffers(1, &vbo);
+            glGenBuffers(1, &ibo);
+
+            RenderState::bindVertexArray(vao);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+            RenderState::bindVertexArray(0);
+
+            return vao;
+        }
+
+        /** Computes the window rectangle covered by a view space sphere, returns false if it is entirely off screen */
+        bool getScissorRect(const Matrix4f& projMatrix, const Vector3f& center, float radius, float zNear, const Size& windowSize, int rect[4])
+        {
+            // A sphere crossing the near plane can cover any part of the screen
+            if (-center.z - radius < zNear) {
+                rect[0] = 0;
+                rect[1] = 0;
+                rect[2] = windowSize.width;
+                rect[3] = windowSize.height;
+                return true;
+            }
+
+            float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+            for (int i = 0; i < 8; i++) {
+                Vector4f corner(center.x + (i & 1 ? radius : -radius), center.y + (i & 2 ? radius : -radius), center.z + (i & 4 ? radius : -radius), 1);
+                Vector4f clip = projMatrix * corner;
+                minX = std::min(minX, clip.x / clip.w);
+                maxX = std::max(maxX, clip.x / clip.w);
+                minY = std::min(minY, clip.y / clip.w);
+                maxY = std::max(maxY, clip.y / clip.w);
+            }
+            if (maxX < -1 || minX > 1 || maxY < -1 || minY > 1)
+                return false;
+
+            int x0 = (int) std::floor((std::max(minX, -1.0f) * 0.5f + 0.5f) * windowSize.width);
+            int y0 = (int) std::floor((std::max(minY, -1.0f) * 0.5f + 0.5f) * windowSize.height);
+            int x1 = (int) std::ceil((std::min(maxX, 1.0f) * 0.5f + 0.5f) * windowSize.width);
+            int y1 = (int) std::ceil((std::min(maxY, 1.0f) * 0.5f + 0.5f) * windowSize.height);
+            rect[0] = x0;
+            rect[1] = y0;
+            rect[2] = x1 - x0;
+            rect[3] = y1 - y0;
+            return true;
+        }
+
+        void setVector(float dst[3], const Vector3f& v)
+        {
+            dst[0] = v.x;
+            dst[1] = v.y;
+            dst[2] = v.z;
+        }
+
+        /** Places the vertices of the light with its world matrix, so parented lights move along with their parents */
+        std::vector<Vector3f> getWorldVertices(const Matrix4f& worldMatrix, const AreaLight& areaLight)
+        {
+            std::vector<Vector3f> vertices;
+            for (const Vector3f& vertex : areaLight.vertices) {
+                vertices.push_back(worldMatrix.transform(vertex, 1));
+            }
+            return vertices;
+        }
     }
 
     DirectLightPass::DirectLightPass()
@@ -58,8 +165,64 @@ namespace Flux {
     {
         shader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/DeferredDirect.frag");
 
+        RenderState::useProgram(shader);
+        UniformBuffer::bindCurrentProgramBlock("CameraBlock", CAMERA_BLOCK);
+        UniformBuffer::bindCurrentProgramBlock("LightBlock", LIGHT_BLOCK);
+
+        // Every sampler needs a unit of its own, even when no light uses it
+        shader.uniform1i("albedoMap", TextureUnit::ALBEDO);
+        shader.uniform1i("normalMap", TextureUnit::NORMAL);
+        shader.uniform1i("depthMap", TextureUnit::DEPTH);
+        shader.uniform1i("emissionMap", TextureUnit::EMISSION);
+        shader.uniform1i("ampTex", TextureUnit::TEXTURE2);
+        shader.uniform1i("matTex", TextureUnit::TEXTURE4);
+        shader.uniform1i("lights", TextureUnit::LIGHTS);
+        shader.uniform1i("lightClusters", TextureUnit::LIGHT_CLUSTERS);
+        shader.uniform1i("lightIndices", TextureUnit::LIGHT_INDICES);
+        shader.uniform1i("shadowAtlas", TextureUnit::SHADOW);
+        shader.uniform1i("shadowTiles", TextureUnit::SHADOW_TILES);
+
+        clusters.create();
+
+        lightBuffer.create();
+        lightBuffer.setData(sizeof(LightUniforms), nullptr, GL_DYNAMIC_DRAW);
+
+        volumeShader.loadFromFile("res/Shaders/LightVolume.vert", "res/Shaders/DeferredVolume.frag");
+
+        RenderState::useProgram(volumeShader);
+        UniformBuffer::bindCurrentProgramBlock("CameraBlock", CAMERA_BLOCK);
+        volumeShader.uniform1i("albedoMap", TextureUnit::ALBEDO);
+        volumeShader.uniform1i("normalMap", TextureUnit::NORMAL);
+        volumeShader.uniform1i("depthMap", TextureUnit::DEPTH);
+        volumeShader.uniform1i("ampTex", TextureUnit::TEXTURE2);
+        volumeShader.uniform1i("matTex", TextureUnit::TEXTURE4);
+        volumeShader.uniform1i("shadowAtlas", TextureUnit::SHADOW);
+        volumeShader.uniform1i("shadowTiles", TextureUnit::SHADOW_TILES);
+
+        sphereVao = createSphere(8, 12, sphereIndexCount);
+
+        // The volume passes below change these, so the fullscreen pass resets them
         requiredSet.addCapability(STENCIL_TEST, true);
         requiredSet.addCapability(DEPTH_TEST, false);
+        requiredSet.addCapability(BLENDING, false);
+        requiredSet.addCapability(FACE_CULLING, false);
+        requiredSet.addCapability(SCISSOR_TEST, false);
+        requiredSet.setStencilFunc(GL_EQUAL, 1, 0xFF);
+        requiredSet.setDepthFunc(GL_LESS);
+        requiredSet.setCullFace(GL_BACK);
+
+        // Only the back faces of a volume are drawn, shading the pixels whose geometry lies in front of them.
+        // The stencil mask of the G-buffer keeps the volumes off the background.
+        volumeState.addCapability(STENCIL_TEST, true);
+        volumeState.addCapability(DEPTH_TEST, true);
+        volumeState.addCapability(BLENDING, true);
+        volumeState.addCapability(FACE_CULLING, true);
+        volumeState.addCapability(SCISSOR_TEST, true);
+        volumeState.setStencilFunc(GL_EQUAL, 1, 0xFF);
+        volumeState.setDepthFunc(GL_GEQUAL);
+        volumeState.setDepthMask(false);
+        volumeState.setCullFace(GL_FRONT);
+        volumeState.setBlendFunc(GL_ONE, GL_ONE, GL_ZERO, GL_ONE);
     }
 
     void DirectLightPass::SetGBuffer(const GBuffer* gBuffer)
@@ -67,20 +230,19 @@ namespace Flux {
         this->gBuffer = gBuffer;
     }
 
+    void DirectLightPass::SetShadowAtlas(const ShadowAtlas* shadowAtlas)
+    {
+        this->shadowAtlas = shadowAtlas;
+    }
+
     void DirectLightPass::Resize(const Size& windowSize)
     {
-        lightTex.create();
-        lightTex.bind(TextureUnit::TEXTURE0);
-        lightTex.setData(windowSize.width, windowSize.height, GL_RGBA16F, GL_RGBA, GL_FLOAT, nullptr);
-        lightTex.setWrapping(CLAMP, CLAMP);
-        lightTex.setSampling(LINEAR, LINEAR);
-        lightTex.release();
-
-        buffer.create();
-        buffer.bind();
-        buffer.addColorTexture(0, lightTex);
-        buffer.validate();
-        buffer.release();
+        this->windowSize = windowSize;
+    }
+
+    void DirectLightPass::setup(RenderGraph& graph)
+    {
+        graph.createPassTarget(RenderTargetDesc(windowSize.width, windowSize.height, GL_RGBA16F, LINEAR, 1, gBuffer->depthTex.getHandle()), &lightTarget);
     }
 
     void DirectLightPass::render(RenderState& renderState, const Scene& scene)
@@ -89,102 +251,91 @@ namespace Flux {
 
         nvtxRangePushA(getPassName().c_str());
 
-        const Framebuffer* sourceFramebuffer = RenderState::currentFramebuffer;
+        if (!lightVolumes) {
+            Camera& camera = scene.getMainCamera()->getComponent<Camera>();
+            clusters.update(scene, renderState.projMatrix, renderState.viewMatrix, camera.getZNear(), camera.getZFar(), lightCutoff);
+        }
 
-        buffer.bind();
+        lightTarget->getFramebuffer().bind();
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        renderState.setClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
-        renderState.enable(BLENDING);
-        glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ZERO);
-        glStencilFunc(GL_EQUAL, 1, 0xFF);
-
-        Entity* camera = scene.getMainCamera();
-        Transform& ct = camera->getComponent<Transform>();
-
-        shader.uniform3f("camPos", ct.position);
 
         gBuffer->albedoTex.bind(TextureUnit::ALBEDO);
-        shader.uniform1i("albedoMap", TextureUnit::ALBEDO);
         gBuffer->normalTex.bind(TextureUnit::NORMAL);
-        shader.uniform1i("normalMap", TextureUnit::NORMAL);
-        gBuffer->positionTex.bind(TextureUnit::POSITION);
-        shader.uniform1i("positionMap", TextureUnit::POSITION);
+        // Positions are reconstructed from depth, which the pass reads but never writes
+        gBuffer->depthTex.bind(TextureUnit::DEPTH);
         gBuffer->emissionTex.bind(TextureUnit::EMISSION);
-        shader.uniform1i("emissionMap", TextureUnit::EMISSION);
-        
-        for (Entity* light : scene.lights) {
-            Transform& transform = light->getComponent<Transform>();
-
-            if (light->hasComponent<DirectionalLight>()) {
-                DirectionalLight& directionalLight = light->getComponent<DirectionalLight>();
-
-                Vector3f direction = Math::directionFromRotation(transform.rotation, Vector3f(0, 0, -1));
-
-                shader.uniform3f("dirLight.direction", direction);
-                shader.uniform3f("dirLight.color", directionalLight.color);
-                shader.uniform1i("isDirLight", true);
-                shader.uniform1i("isPointLight", false);
-                shader.uniform1i("isAreaLight", false);
-                directionalLight.shadowMap.bind(TextureUnit::SHADOW);
-                shader.uniform1i("dirLight.shadowMap", TextureUnit::SHADOW);
-                shader.uniformMatrix4f("dirLight.shadowMatrix", directionalLight.shadowSpace);
-            }
-            else if (light->hasComponent<PointLight>()) {
-                PointLight& pointLight = light->getComponent<PointLight>();
-
-                shader.uniform3f("pointLight.position", transform.position);
-                shader.uniform3f("pointLight.color", pointLight.color);
-                shader.uniform1i("isPointLight", true);
-                shader.uniform1i("isDirLight", false);
-                shader.uniform1i("isAreaLight", false);
-                pointLight.shadowMap.bind(TextureUnit::TEXTURE7);
-                shader.uniform1i("pointLight.shadowMap", TextureUnit::TEXTURE7);
-            }
-            else if (light->hasComponent<AreaLight>()) {
-                AreaLight& areaLight = light->getComponent<AreaLight>();
 
-                ampTex.bind(TextureUnit::TEXTURE3);
-                matTex.bind(TextureUnit::TEXTURE4);
-                shader.uniform1i("areaLight.ampTex", TextureUnit::TEXTURE3);
-                shader.uniform1i("areaLight.matTex", TextureUnit::TEXTURE4);
+        // The shadows of all lights are sampled from their tiles in the atlas
+        shadowAtlas->getTexture().bind(TextureUnit::SHADOW);
+        shadowAtlas->bindTiles(TextureUnit::SHADOW_TILES);
 
-                Matrix4f modelMatrix;
-                modelMatrix.setIdentity();
+        // Point lights are looked up per pixel through the cluster of its depth and screen tile
+        shader.uniform1i("clusteredLights", !lightVolumes);
+        if (!lightVolumes) {
+            clusters.bind(TextureUnit::LIGHTS, TextureUnit::LIGHT_CLUSTERS, TextureUnit::LIGHT_INDICES);
+            shader.uniform1f("sliceScale", clusters.getSliceScale());
+            shader.uniform1f("sliceBias", clusters.getSliceBias());
+        }
 
-                transform.rotation.z += 0.5f;
-                modelMatrix.translate(transform.position);
-                modelMatrix.rotate(transform.rotation);
-                modelMatrix.scale(transform.scale);
+        // Directional and area lights cover the whole screen and are evaluated for every pixel
+        LightUniforms uniforms = {};
+        scene.view<Transform, DirectionalLight>().each([&](uint32_t, Transform& transform, DirectionalLight& directionalLight) {
+            if ((unsigned int) uniforms.dirLightCount == MAX_DIRECTIONAL_LIGHTS)
+                return;
+
+            DirectionalLightUniforms& light = uniforms.dirLights[uniforms.dirLightCount];
+            Vector3f direction = Math::directionFromRotation(transform.rotation, Vector3f(0, 0, -1));
+            setVector(light.direction, direction);
+            setVector(light.color, directionalLight.color);
+
+            // Cascades dropped from the atlas leave the rest of the view unshadowed
+            unsigned int cascadeCount = 0;
+            while (cascadeCount < directionalLight.cascadeCount && directionalLight.cascades[cascadeCount].tile.size != 0) {
+                memcpy(light.shadowMatrices[cascadeCount], directionalLight.cascades[cascadeCount].shadowSpace.toArray(), sizeof(light.shadowMatrices[cascadeCount]));
+                light.cascadeSplits[cascadeCount] = directionalLight.cascades[cascadeCount].splitDepth;
+                cascadeCount++;
+            }
+            light.cascadeCount = cascadeCount;
+            uniforms.dirLightCount++;
+        });
 
-                std::vector<Vector3f> vertices;
-                for (Vector3f vertex : areaLight.vertices) {
-                    vertices.push_back(modelMatrix.transform(vertex, 1));
-                }
+        scene.view<Transform, AreaLight>().each([&](uint32_t entity, Transform&, AreaLight& areaLight) {
+            if (lightVolumes || (unsigned int) uniforms.areaLightCount == MAX_AREA_LIGHTS)
+                return;
 
-                shader.uniform3f("areaLight.color", areaLight.color);
-                shader.uniform3fv("areaLight.vertices", vertices.size(), vertices.data());
-                shader.uniform1i("isPointLight", false);
-                shader.uniform1i("isDirLight", false);
-                shader.uniform1i("isAreaLight", true);
-            }
-            else {
-                continue;
+            std::vector<Vector3f> vertices = getWorldVertices(scene.getWorldMatrix(entity), areaLight);
+
+            AreaLightUniforms& light = uniforms.areaLights[uniforms.areaLightCount];
+            setVector(light.color, areaLight.color * areaLight.energy);
+            for (size_t i = 0; i < vertices.size() && i < 4; i++) {
+                setVector(light.vertices[i], vertices[i]);
             }
+            uniforms.areaLightCount++;
+        });
 
-            renderState.drawQuad();
+        lightBuffer.setSubData(0, sizeof(LightUniforms), &uniforms);
+        lightBuffer.bindBase(LIGHT_BLOCK);
+
+        if (uniforms.areaLightCount > 0) {
+            ampTex.bind(TextureUnit::TEXTURE2);
+            matTex.bind(TextureUnit::TEXTURE4);
         }
 
-        renderState.disable(BLENDING);
+        renderState.drawQuad();
 
-        buffer.release();
+        if (lightVolumes) {
+            renderLightVolumes(renderState, scene);
+            RenderState::require(requiredSet);
+        }
 
-        sourceFramebuffer->bind();
+        target->bind();
 
         // Add the direct light to the original buffer
-        std::vector<Texture2D> sources{ lightTex, *source };
+        std::vector<Texture2D> sources{ lightTarget->getTexture(), *source };
         std::vector<float> weights{ 1, 1 };
         addPass.SetTextures(sources);
         addPass.SetWeights(weights);
@@ -192,4 +343,65 @@ namespace Flux {
 
         nvtxRangePop();
     }
+
+    void DirectLightPass::renderLightVolumes(const RenderState& renderState, const Scene& scene)
+    {
+        nvtxRangePushA("Light Volumes");
+
+        RenderState::require(volumeState);
+        RenderState::useProgram(volumeShader);
+        RenderState::bindVertexArray(sphereVao);
+
+        volumeShader.uniform2f("windowSize", (float) windowSize.width, (float) windowSize.height);
+        const float zNear = scene.getMainCamera()->getComponent<Camera>().getZNear();
+
+        volumeShader.uniform1i("lightType", 0);
+        scene.view<Transform, PointLight>().each([&](uint32_t entity, Transform&, PointLight& pointLight) {
+            const Matrix4f& worldMatrix = scene.getWorldMatrix(entity);
+            Vector3f position(worldMatrix[12], worldMatrix[13], worldMatrix[14]);
+            float radius = pointLight.getRadius(lightCutoff);
+
+            volumeShader.uniform3f("position", position);
+            volumeShader.uniform1f("radius", radius);
+            volumeShader.uniform3f("color", pointLight.getIntensity());
+            volumeShader.uniform1i("shadowSlot", pointLight.shadowSlot);
+            drawVolume(renderState, position, radius, zNear);
+        });
+
+        volumeShader.uniform1i("lightType", 1);
+        ampTex.bind(TextureUnit::TEXTURE2);
+        matTex.bind(TextureUnit::TEXTURE4);
+        scene.view<Transform, AreaLight>().each([&](uint32_t entity, Transform&, AreaLight& areaLight) {
+            std::vector<Vector3f> vertices = getWorldVertices(scene.getWorldMatrix(entity), areaLight);
+
+            Vector3f center(0, 0, 0);
+            for (const Vector3f& vertex : vertices) {
+                center += vertex;
+            }
+            center /= (float) vertices.size();
+
+            volumeShader.uniform3f("color", areaLight.color * areaLight.energy);
+            volumeShader.uniform3fv("vertices", (int) vertices.size(), vertices.data());
+            drawVolume(renderState, center, areaLight.getRadius(vertices, lightCutoff), zNear);
+        });
+
+        nvtxRangePop();
+    }
+
+    void DirectLightPass::drawVolume(const RenderState& renderState, const Vector3f& center, float radius, float zNear)
+    {
+        // Skip lights off screen and restrict the rest to the window area their sphere projects to
+        int rect[4];
+        if (!getScissorRect(renderState.projMatrix, renderState.viewMatrix.transform(center, 1), radius, zNear, windowSize, rect))
+            return;
+        RenderState::setScissor(rect[0], rect[1], rect[2], rect[3]);
+
+        Matrix4f modelMatrix;
+        modelMatrix.setIdentity();
+        modelMatrix.translate(center);
+        modelMatrix.scale(radius);
+        volumeShader.uniformMatrix4f("modelMatrix", modelMatrix);
+
+        glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_SHORT, 0);
+    }
 }
@@ -4,35 +4,113 @@
 
 #include "AddPass.h"
 #include "Renderer/GBuffer.h"
+#include "Renderer/LightClusters.h"
+#include "Renderer/ShadowAtlas.h"
+#include "Renderer/RenderGraph.h"
 #include "Framebuffer.h"
+#include "PointLight.h"
+#include "DirectionalLight.h"
+
+#include <glad/glad.h>
 
 #include <memory>
+#include <vector>
 
 namespace Flux
 {
     class Texture2D;
 
+    /** Directional light laid out according to the std140 DirectionalLight struct of DeferredDirect.frag */
+    struct DirectionalLightUniforms {
+        float direction[3];
+        float padding0;
+        float color[3];
+        float padding1;
+        float shadowMatrices[DirectionalLight::MAX_CASCADES][16];
+        float cascadeSplits[4];
+        GLint cascadeCount;
+        float padding2[3];
+    };
+
+    /** Area light laid out according to the std140 AreaLight struct of DeferredDirect.frag, vec3 array elements take a vec4 each */
+    struct AreaLightUniforms {
+        float color[4];
+        float vertices[4][4];
+    };
+
     class DirectLightPass : public RenderPhase
     {
     public:
         DirectLightPass();
 
         void SetGBuffer(const GBuffer* gBuffer);
+        void SetShadowAtlas(const ShadowAtlas* shadowAtlas);
 
         void Resize(const Size& windowSize) override;
 
+        void setup(RenderGraph& graph) override;
+
         void render(RenderState& renderState, const Scene& scene) override;
 
+        /**
+         * Shades point and area lights by drawing a bounding sphere per light
+         * with a scissor rectangle around it, instead of looking them up
+         * through the light clusters in one fullscreen pass.
+         */
+        void setLightVolumes(bool enabled) {
+            lightVolumes = enabled;
+        }
+
+        /** Intensity below which a light is considered to no longer contribute, determines the light radii */
+        void setLightCutoff(float cutoff) {
+            lightCutoff = cutoff;
+        }
+
+        /** Point light assignment of the last rendered frame */
+        const LightClusters& getClusters() const {
+            return clusters;
+        }
+
+        /** Maximum number of lights of each kind, must match DeferredDirect.frag */
+        static const unsigned int MAX_DIRECTIONAL_LIGHTS = 2;
+        static const unsigned int MAX_AREA_LIGHTS = 4;
+
+        /** Lights evaluated for every pixel, laid out according to the std140 LightBlock */
+        struct LightUniforms {
+            DirectionalLightUniforms dirLights[MAX_DIRECTIONAL_LIGHTS];
+            AreaLightUniforms areaLights[MAX_AREA_LIGHTS];
+            GLint dirLightCount;
+            GLint areaLightCount;
+            GLint padding[2];
+        };
+
     private:
+        void renderLightVolumes(const RenderState& renderState, const Scene& scene);
+        void drawVolume(const RenderState& renderState, const Vector3f& center, float radius, float zNear);
+
         ShaderProgram shader;
+        ShaderProgram volumeShader;
 
         const GBuffer* gBuffer;
+        const ShadowAtlas* shadowAtlas;
 
         const Texture2D ampTex;
         const Texture2D matTex;
 
-        Framebuffer buffer;
-        Texture2D lightTex;
+        // Direct light before it is added to the source, depth and stencil tested against the scene
+        RenderTarget* lightTarget = nullptr;
+
+        LightClusters clusters;
+        UniformBuffer lightBuffer;
+
+        bool lightVolumes = false;
+        float lightCutoff = PointLight::CUTOFF_INTENSITY;
+
+        PipelineState volumeState;
+        // Unit sphere drawn around every light in volume mode
+        GLuint sphereVao = 0;
+        GLsizei sphereIndexCount = 0;
+        Size windowSize = Size(0, 0);
 
         AddPass addPass;
     };
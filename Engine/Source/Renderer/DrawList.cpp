@@ -0,0 +1,51 @@
+#include "Renderer/DrawList.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Flux
+{
+    uint64_t DrawList::makeKey(uint32_t shader, uint32_t material, uint32_t mesh, uint32_t lod, float depth)
+    {
+        // The bit pattern of a positive float increases with its value, so its top bits sort by depth
+        uint32_t depthBits = 0;
+        if (depth > 0) {
+            memcpy(&depthBits, &depth, sizeof(depth));
+        }
+
+        return ((uint64_t) (shader & 0xFF) << 56)
+            | ((uint64_t) (material & 0xFFFF) << 40)
+            | ((uint64_t) (mesh & 0xFFFF) << 24)
+            | ((uint64_t) (lod & 0x7) << 21)
+            | (uint64_t) (depthBits >> 11);
+    }
+
+    uint64_t DrawList::makeDepthKey(uint32_t material, uint32_t mesh, float depth)
+    {
+        uint32_t depthBits = 0;
+        if (depth > 0) {
+            memcpy(&depthBits, &depth, sizeof(depth));
+        }
+
+        return ((uint64_t) depthBits << 32)
+            | ((uint64_t) (material & 0xFFFF) << 16)
+            | (uint64_t) (mesh & 0xFFFF);
+    }
+
+    void DrawList::clear()
+    {
+        commands.clear();
+    }
+
+    void DrawList::add(const DrawCommand& command)
+    {
+        commands.push_back(command);
+    }
+
+    void DrawList::sort()
+    {
+        std::sort(commands.begin(), commands.end(), [](const DrawCommand& a, const DrawCommand& b) {
+            return a.key < b.key;
+        });
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Flux
+{
+    class Mesh;
+
+    /** A single mesh draw, submitted in the order of its sort key */
+    struct DrawCommand
+    {
+        uint64_t key;
+        uint32_t entity;
+        uint32_t materialID;
+        const Mesh* mesh;
+        // Level of detail to draw, zero is the full mesh
+        uint32_t lod;
+    };
+
+    /** Consecutive draws of one mesh and material, submitted as a single instanced draw */
+    struct DrawBatch
+    {
+        const Mesh* mesh;
+        uint32_t materialID;
+        uint32_t instanceCount;
+        // Offset of the instance matrices in the draw uniform buffer
+        size_t offset;
+        // Offset of the cubemap face masks in the face uniform buffer, when drawing layered
+        size_t faceOffset;
+        // Entity of the first instance
+        uint32_t entity;
+        uint32_t lod;
+    };
+
+    /**
+     * Collects the draws of a single view and orders them so that draws
+     * sharing a shader, material, mesh and level of detail end up next to each other.
+     * Within a state bucket draws are ordered front to back.
+     */
+    class DrawList
+    {
+    public:
+        /**
+         * Packs the draw state into a sort key.
+         * Bits 56-63 hold the shader, 40-55 the material, 24-39 the mesh, 21-23 the level of detail and 0-20 the view depth.
+         */
+        static uint64_t makeKey(uint32_t shader, uint32_t material, uint32_t mesh, uint32_t lod, float depth);
+
+        /**
+         * Packs a sort key that orders draws strictly front to back, for passes that only write depth.
+         * Bits 32-63 hold the view depth, 16-31 the material and 0-15 the mesh.
+         */
+        static uint64_t makeDepthKey(uint32_t material, uint32_t mesh, float depth);
+
+        void clear();
+        void add(const DrawCommand& command);
+        void sort();
+
+        const std::vector<DrawCommand>& getCommands() const
+        {
+            return commands;
+        }
+
+        bool empty() const
+        {
+            return commands.empty();
+        }
+
+    private:
+        std::vector<DrawCommand> commands;
+    };
+}
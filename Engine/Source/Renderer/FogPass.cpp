@@ -9,7 +9,10 @@
 namespace Flux {
     FogPass::FogPass() : RenderPhase("Fog")
     {
-        shader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/Fog.frag");
+        shader.addShader(GDT::VERTEX, "res/Shaders/Quad.vert");
+        shader.addShader(GDT::FRAGMENT, "res/Shaders/Fog.frag");
+        shader.addShader(GDT::FRAGMENT, getStageSource());
+        shader.build();
 
         requiredSet.addCapability(STENCIL_TEST, false);
         requiredSet.addCapability(DEPTH_TEST, false);
@@ -30,23 +33,28 @@ namespace Flux {
 
     }
 
+    void FogPass::setStageUniforms(ShaderProgram& shader, const Scene& scene)
+    {
+        depthMap->bind(TextureUnit::TEXTURE2);
+        shader.uniform1i("depthMap", TextureUnit::TEXTURE2);
+
+        Camera& camera = scene.getMainCamera()->getComponent<Camera>();
+        shader.uniform1f("zNear", camera.getZNear());
+        shader.uniform1f("zFar", camera.getZFar());
+        shader.uniform3f("fogColor", fogColor);
+    }
+
     void FogPass::render(RenderState& renderState, const Scene& scene)
     {
         renderState.require(requiredSet);
 
         nvtxRangePushA(getPassName().c_str());
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
         source->bind(TextureUnit::TEXTURE0);
         shader.uniform1i("tex", TextureUnit::TEXTURE0);
-        depthMap->bind(TextureUnit::TEXTURE1);
-        shader.uniform1i("depthMap", TextureUnit::TEXTURE1);
-
-        Camera& camera = scene.getMainCamera()->getComponent<Camera>();
-        shader.uniform1f("zNear", camera.getZNear());
-        shader.uniform1f("zFar", camera.getZFar());
-        shader.uniform3f("fogColor", fogColor);
+        setStageUniforms(shader, scene);
 
         renderState.drawQuad();
 
@@ -21,6 +21,10 @@ namespace Flux
 
         void render(RenderState& renderState, const Scene& scene) override;
 
+        const char* getStageSource() const override { return "res/Shaders/Stages/Fog.frag"; }
+        const char* getStageFunction() const override { return "applyFog"; }
+        void setStageUniforms(ShaderProgram& shader, const Scene& scene) override;
+
     private:
         ShaderProgram shader;
 
@@ -0,0 +1,145 @@
+#include "Renderer/FusedPass.h"
+
+#include "Renderer/RenderState.h"
+
+#include "TextureUnit.h"
+#include "Texture.h"
+#include "Util/File.h"
+#include "Util/Log.h"
+
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+namespace Flux {
+    namespace
+    {
+        String getFusedName(const std::vector<RenderPhase*>& stages)
+        {
+            std::string name = "Fused";
+            for (size_t i = 0; i < stages.size(); i++) {
+                name += (i == 0 ? " " : " + ") + stages[i]->getPassName().str();
+            }
+            return String(name);
+        }
+
+        std::string generateMain(const std::vector<RenderPhase*>& stages)
+        {
+            std::string source =
+                "#version 330 core\n"
+                "\n"
+                "uniform sampler2D source;\n"
+                "\n"
+                "in vec2 pass_texCoords;\n"
+                "\n"
+                "out vec4 fragColor;\n"
+                "\n";
+
+            for (RenderPhase* stage : stages) {
+                source += "vec3 " + std::string(stage->getStageFunction()) + "(vec3 color, vec2 texCoords);\n";
+            }
+
+            source += "\nvoid main() {\n    vec3 color = texture(source, pass_texCoords).rgb;\n";
+            for (RenderPhase* stage : stages) {
+                source += "    color = " + std::string(stage->getStageFunction()) + "(color, pass_texCoords);\n";
+            }
+            source += "    fragColor = vec4(color, 1);\n}\n";
+
+            return source;
+        }
+
+        /** The same stages always generate the same source, so a rebuilt pipeline reuses the file of an earlier one */
+        std::string getMainPath(const std::vector<RenderPhase*>& stages)
+        {
+            std::string path = "res/Shaders/Fused";
+            for (RenderPhase* stage : stages) {
+                path += "_" + std::string(stage->getStageFunction());
+            }
+            return path + ".frag";
+        }
+
+        /** Writes the source unless the file already holds it, which also allows read-only installs that ship the file */
+        bool writeMain(const std::string& path, const std::string& source)
+        {
+            std::ifstream file(path);
+            if (file.is_open()) {
+                std::stringstream contents;
+                contents << file.rdbuf();
+                if (contents.str() == source)
+                    return true;
+            }
+            return File::saveFile(path.c_str(), source);
+        }
+    }
+
+    FusedPass::FusedPass(const std::vector<RenderPhase*>& stages) : RenderPhase(getFusedName(stages)), stages(stages)
+    {
+        requiredSet.addCapability(STENCIL_TEST, false);
+        requiredSet.addCapability(DEPTH_TEST, false);
+
+        // Shaders are only loaded from files, so the generated main is written next to the stage sources
+        const std::string path = getMainPath(stages);
+        if (!writeMain(path, generateMain(stages)))
+            return;
+
+        try {
+            shader.addShader(GDT::VERTEX, "res/Shaders/Quad.vert");
+            shader.addShader(GDT::FRAGMENT, path);
+            for (RenderPhase* stage : stages) {
+                shader.addShader(GDT::FRAGMENT, stage->getStageSource());
+            }
+            shader.build();
+        }
+        catch (const GDT::ShaderLoadingException& e) {
+            Log::error("Failed to load " + getPassName().str() + ": " + e.what());
+            return;
+        }
+
+        if (!shader.isLinked()) {
+            Log::error("Failed to link " + getPassName().str() + ": " + shader.getError());
+        }
+    }
+
+    bool FusedPass::isValid()
+    {
+        return shader.isLinked();
+    }
+
+    bool FusedPass::canFuse(const std::vector<RenderPhase*>& stages, RenderPhase* pass)
+    {
+        if (!pass->getStageSource())
+            return false;
+
+        for (RenderPhase* stage : stages) {
+            if (std::strcmp(stage->getStageSource(), pass->getStageSource()) == 0)
+                return false;
+        }
+        return true;
+    }
+
+    void FusedPass::Resize(const Size& windowSize)
+    {
+
+    }
+
+    void FusedPass::render(RenderState& renderState, const Scene& scene)
+    {
+        renderState.require(requiredSet);
+
+        nvtxRangePushA(getPassName().c_str());
+
+        RenderState::useProgram(shader);
+
+        source->bind(TextureUnit::TEXTURE0);
+        shader.uniform1i("source", TextureUnit::TEXTURE0);
+
+        for (RenderPhase* stage : stages) {
+            stage->setStageUniforms(shader, scene);
+        }
+
+        renderState.drawQuad();
+
+        nvtxRangePop();
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "RenderPhase.h"
+
+#include <vector>
+
+namespace Flux {
+    /**
+     * Runs a sequence of per pixel passes as a single full screen draw. The
+     * shader is generated when the pass is created: a main function calling
+     * the stage function of every pass in order, linked together with the
+     * stage sources of the passes. The main function is written to a file
+     * named after the stages, so rebuilding the same sequence reuses it.
+     */
+    class FusedPass : public RenderPhase
+    {
+    public:
+        /** The stages are not owned and have to stay alive as long as this pass */
+        FusedPass(const std::vector<RenderPhase*>& stages);
+
+        /** Whether the generated shader was written and linked, otherwise the stages have to run as separate passes */
+        bool isValid();
+
+        /** Whether the pass can be fused with a sequence of stages, every stage source may only be linked once */
+        static bool canFuse(const std::vector<RenderPhase*>& stages, RenderPhase* pass);
+
+        void Resize(const Size& windowSize) override;
+
+        void render(RenderState& renderState, const Scene& scene) override;
+
+    private:
+        ShaderProgram shader;
+
+        std::vector<RenderPhase*> stages;
+    };
+}
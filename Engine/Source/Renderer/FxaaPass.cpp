@@ -26,7 +26,7 @@ namespace Flux {
 
         nvtxRangePushA(getPassName().c_str());
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
         source->bind(TextureUnit::TEXTURE);
         shader.uniform1i("tex", TextureUnit::TEXTURE);
@@ -7,12 +7,16 @@
 #include <memory>
 
 namespace Flux {
+    /**
+     * Surface attributes of the visible pixels, 12 bytes per pixel besides depth:
+     * albedo and roughness, an octahedral normal with metalness, and emission.
+     * World positions are reconstructed from the depth buffer.
+     */
     struct GBuffer {
     public:
         void create(const unsigned int width, const unsigned int height) {
             albedoTex = createAlbedoTex(width, height);
             normalTex = createNormalTex(width, height);
-            positionTex = createPositionTex(width, height);
             emissionTex = createEmissionTex(width, height);
             depthTex = createDepthTex(width, height);
 
@@ -20,8 +24,7 @@ namespace Flux {
             buffer.bind();
             buffer.addColorTexture(0, albedoTex);
             buffer.addColorTexture(1, normalTex);
-            buffer.addColorTexture(2, positionTex);
-            buffer.addColorTexture(3, emissionTex);
+            buffer.addColorTexture(2, emissionTex);
             buffer.addDepthStencilTexture(depthTex);
             buffer.validate();
             buffer.release();
@@ -33,7 +36,6 @@ namespace Flux {
 
         Texture2D albedoTex;
         Texture2D normalTex;
-        Texture2D positionTex;
         Texture2D emissionTex;
         Texture2D depthTex;
 
@@ -56,29 +58,18 @@ namespace Flux {
             Texture2D normalTex;
             normalTex.create();
             normalTex.bind(TextureUnit::TEXTURE0);
-            normalTex.setData(width, height, GL_RGBA16, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            normalTex.setData(width, height, GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, nullptr);
             normalTex.setWrapping(CLAMP, CLAMP);
             normalTex.setSampling(NEAREST, NEAREST);
             return normalTex;
         }
 
-        Texture2D createPositionTex(const uint width, const uint height)
-        {
-            Texture2D positionTex;
-            positionTex.create();
-            positionTex.bind(TextureUnit::TEXTURE0);
-            positionTex.setData(width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT, nullptr);
-            positionTex.setWrapping(CLAMP, CLAMP);
-            positionTex.setSampling(NEAREST, NEAREST);
-            return positionTex;
-        }
-
         Texture2D createEmissionTex(const uint width, const uint height)
         {
             Texture2D emissionTex;
             emissionTex.create();
             emissionTex.bind(TextureUnit::TEXTURE0);
-            emissionTex.setData(width, height, GL_RGBA16F, GL_RGBA, GL_FLOAT, nullptr);
+            emissionTex.setData(width, height, GL_R11F_G11F_B10F, GL_RGB, GL_FLOAT, nullptr);
             emissionTex.setWrapping(CLAMP, CLAMP);
             emissionTex.setSampling(NEAREST, NEAREST);
             return emissionTex;
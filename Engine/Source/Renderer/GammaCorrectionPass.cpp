@@ -9,7 +9,10 @@
 namespace Flux {
     GammaCorrectionPass::GammaCorrectionPass() : RenderPhase("Gamma Correction")
     {
-        shader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/GammaCorrection.frag");
+        shader.addShader(GDT::VERTEX, "res/Shaders/Quad.vert");
+        shader.addShader(GDT::FRAGMENT, "res/Shaders/GammaCorrection.frag");
+        shader.addShader(GDT::FRAGMENT, getStageSource());
+        shader.build();
 
         requiredSet.addCapability(STENCIL_TEST, false);
         requiredSet.addCapability(DEPTH_TEST, false);
@@ -26,7 +29,7 @@ namespace Flux {
 
         nvtxRangePushA(getPassName().c_str());
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
         source->bind(TextureUnit::TEXTURE);
         shader.uniform1i("tex", TextureUnit::TEXTURE);
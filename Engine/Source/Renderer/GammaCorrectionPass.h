@@ -17,6 +17,9 @@ namespace Flux
 
         void render(RenderState& renderState, const Scene& scene) override;
 
+        const char* getStageSource() const override { return "res/Shaders/Stages/GammaCorrection.frag"; }
+        const char* getStageFunction() const override { return "correctGamma"; }
+
     private:
         ShaderProgram shader;
     };
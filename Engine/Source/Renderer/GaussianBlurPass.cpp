@@ -17,28 +17,16 @@ namespace Flux {
 
     void GaussianBlurPass::Resize(const Size& windowSize) {
         this->windowSize = windowSize;
+    }
 
-        int blurWidth = windowSize.width;
-        int blurHeight = windowSize.height;
-        blurBuffers.resize(6);
-        for (unsigned int i = 0; i < blurBuffers.size(); i++) {
+    void GaussianBlurPass::setup(RenderGraph& graph) {
+        unsigned int blurWidth = windowSize.width;
+        unsigned int blurHeight = windowSize.height;
+        for (unsigned int i = 0; i < 6; i++) {
             if (i % 2 == 0) {
                 blurWidth = blurWidth >> 1; blurHeight = blurHeight >> 1;
             }
-
-            Texture2D blurTexture;
-            blurTexture.create();
-            blurTexture.bind(TextureUnit::TEXTURE0);
-            blurTexture.setData(blurWidth, blurHeight, GL_RGBA16F, GL_RGBA, GL_FLOAT, nullptr);
-            blurTexture.setWrapping(CLAMP, CLAMP);
-            blurTexture.setSampling(LINEAR, LINEAR);
-            blurTexture.release();
-
-            blurBuffers[i].create();
-            blurBuffers[i].bind();
-            blurBuffers[i].addColorTexture(0, blurTexture);
-            blurBuffers[i].validate();
-            blurBuffers[i].release();
+            graph.createPassTarget(RenderTargetDesc(blurWidth, blurHeight, GL_RGBA16F), &blurTargets[i]);
         }
     }
 
@@ -48,50 +36,41 @@ namespace Flux {
 
         nvtxRangePushA(getPassName().c_str());
         
-        const Framebuffer* sourceFramebuffer = RenderState::currentFramebuffer;
-
-        shader.bind();
-
-        source->bind(TextureUnit::TEXTURE);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        RenderState::useProgram(shader);
 
         shader.uniform1i("tex", TextureUnit::TEXTURE);
 
-        shader.uniform2f("direction", 1, 0);
-        for (unsigned int i = 0; i < blurBuffers.size(); i += 2) {
-            const Texture2D& texture = blurBuffers[i].getTexture();
+        // Every level halves the blurred result of the previous one, so the source needs no mipmaps
+        const Texture2D* input = source;
+        for (unsigned int i = 0; i < 6; i += 2) {
+            const Texture2D& texture = blurTargets[i]->getTexture();
             int width = texture.getWidth();
             int height = texture.getHeight();
-            glViewport(0, 0, width, height);
+            renderState.setViewport(0, 0, width, height);
             shader.uniform2i("windowSize", width, height);
-            blurBuffers[i].bind();
-            shader.uniform1i("mipmap", i + 1);
 
+            input->bind(TextureUnit::TEXTURE);
+            shader.uniform2f("direction", 1, 0);
+            blurTargets[i]->getFramebuffer().bind();
             renderState.drawQuad();
-        }
-        shader.uniform2f("direction", 0, 1);
-        for (unsigned int i = 1; i < blurBuffers.size(); i += 2) {
-            const Texture2D& texture = blurBuffers[i-1].getTexture();
-            texture.bind(TextureUnit::TEXTURE);
-            int width = texture.getWidth();
-            int height = texture.getHeight();
-            glViewport(0, 0, width, height);
-            shader.uniform2i("windowSize", width, height);
-            blurBuffers[i].bind();
-            shader.uniform1i("mipmap", 0);
 
+            texture.bind(TextureUnit::TEXTURE);
+            shader.uniform2f("direction", 0, 1);
+            blurTargets[i + 1]->getFramebuffer().bind();
             renderState.drawQuad();
+
+            input = &blurTargets[i + 1]->getTexture();
         }
         nvtxRangePop();
 
-        sourceFramebuffer->bind();
+        target->bind();
 
-        glViewport(0, 0, windowSize.width, windowSize.height);
+        renderState.setViewport(0, 0, windowSize.width, windowSize.height);
 
         std::vector<Texture2D> v = {
-            blurBuffers[1].getTexture(),
-            blurBuffers[3].getTexture(),
-            blurBuffers[5].getTexture(),
+            blurTargets[1]->getTexture(),
+            blurTargets[3]->getTexture(),
+            blurTargets[5]->getTexture(),
         };
         std::vector<float> weights{ 0.33f, 0.33f, 0.34f };
         averagePass.SetTextures(v);
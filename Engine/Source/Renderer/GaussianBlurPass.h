@@ -2,6 +2,7 @@
 
 #include "RenderPhase.h"
 #include "AddPass.h"
+#include "Renderer/RenderGraph.h"
 
 #include "Util/Size.h"
 
@@ -9,7 +10,6 @@
 
 namespace Flux {
     class Texture2D;
-    class Framebuffer;
 
     class GaussianBlurPass : public RenderPhase
     {
@@ -18,13 +18,16 @@ namespace Flux {
 
         void Resize(const Size& windowSize) override;
 
+        void setup(RenderGraph& graph) override;
+
         void render(RenderState& renderState, const Scene& scene) override;
 
     private:
         ShaderProgram shader;
 
         Size windowSize;
-        std::vector<Framebuffer> blurBuffers;
+        // Horizontal and vertical blur of three levels, each half the size of the previous one
+        RenderTarget* blurTargets[6];
 
         AddPass averagePass;
     };
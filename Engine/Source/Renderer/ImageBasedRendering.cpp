@@ -20,9 +20,9 @@ namespace Flux
         framebuffer.bind();
         framebuffer.addDrawBuffer(GL_COLOR_ATTACHMENT0);
 
-        glClearColor(1, 0, 0, 1);
+        RenderState::setClearColor(1, 0, 0, 1);
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
         create();
         bind(TextureUnit::TEXTURE0);
@@ -51,7 +51,7 @@ namespace Flux
         // Should be resolution of environment map for perfect accuracy, but this is good enough
         shader.uniform1i("textureSize", resolution * 4);
 
-        glViewport(0, 0, resolution, resolution);
+        RenderState::setViewport(0, 0, resolution, resolution);
 
         for (int i = 0; i < 6; i++)
         {
@@ -59,11 +59,12 @@ namespace Flux
             framebuffer.setCubemap(getHandle(), i, 0);
             framebuffer.validate();
 
-            glBindVertexArray(RenderState::quadVao);
+            RenderState::bindVertexArray(RenderState::quadVao);
             glDrawArrays(GL_TRIANGLES, 0, 6);
         }
         framebuffer.release();
         framebuffer.destroy();
+        RenderState::releaseProgram();
     }
 
     void PrefilterEnvmap::generate(const uint resolution)
@@ -76,9 +77,9 @@ namespace Flux
         framebuffer.bind();
         framebuffer.addDrawBuffer(GL_COLOR_ATTACHMENT0);
 
-        glClearColor(1, 0, 0, 1);
+        RenderState::setClearColor(1, 0, 0, 1);
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
         create();
         bind(TextureUnit::PREFILTER);
@@ -111,7 +112,7 @@ namespace Flux
         for (int level = 0; level <= MIP_MAP_LEVELS; level++)
         {
             unsigned int mipmapSize = resolution >> level;
-            glViewport(0, 0, mipmapSize, mipmapSize);
+            RenderState::setViewport(0, 0, mipmapSize, mipmapSize);
             float Roughness = (float)level / (MIP_MAP_LEVELS);
             std::cout << "Roughness: " << Roughness << std::endl;
             shader.uniform1f("Roughness", Roughness);
@@ -128,6 +129,7 @@ namespace Flux
 
         framebuffer.release();
         framebuffer.destroy();
+        RenderState::releaseProgram();
     }
 
     ScaleBiasTexture::ScaleBiasTexture()
@@ -154,11 +156,11 @@ namespace Flux
         framebuffer.bind();
         framebuffer.addDrawBuffer(GL_COLOR_ATTACHMENT0);
 
-        glClearColor(1, 0, 0, 1);
+        RenderState::setClearColor(1, 0, 0, 1);
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
-        glViewport(0, 0, getWidth(), getHeight());
+        RenderState::setViewport(0, 0, getWidth(), getHeight());
 
         framebuffer.setTexture(GL_COLOR_ATTACHMENT0, *this);
         framebuffer.validate();
@@ -168,6 +170,7 @@ namespace Flux
         glDrawArrays(GL_TRIANGLES, 0, 6);
 
         framebuffer.release();
+        RenderState::releaseProgram();
     }
 
     void IblSceneInfo::PrecomputeEnvironmentData(const Texture2D& environmentTex) {
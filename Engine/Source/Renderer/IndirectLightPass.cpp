@@ -28,6 +28,7 @@ namespace Flux {
 
         requiredSet.addCapability(STENCIL_TEST, true);
         requiredSet.addCapability(DEPTH_TEST, false);
+        requiredSet.setStencilFunc(GL_EQUAL, 1, 0xFF);
     }
 
     void IndirectLightPass::SetGBuffer(const GBuffer* gBuffer)
@@ -47,22 +48,22 @@ namespace Flux {
         renderState.setClearColor(0, 0, 0, 1);
 
         glClear(GL_COLOR_BUFFER_BIT);
-        glStencilFunc(GL_EQUAL, 1, 0xFF);
         if (!sky) {
             return;
         }
         nvtxRangePushA(getPassName().c_str());
-        shader.bind();
+        RenderState::useProgram(shader);
 
         Transform& ct = scene.getMainCamera()->getComponent<Transform>();
         shader.uniform3f("camPos", ct.position);
+        shader.uniformMatrix4f("invProjViewMatrix", inverse(renderState.projMatrix * renderState.viewMatrix));
 
         gBuffer->albedoTex.bind(TextureUnit::ALBEDO);
         shader.uniform1i("albedoMap", TextureUnit::ALBEDO);
         gBuffer->normalTex.bind(TextureUnit::NORMAL);
         shader.uniform1i("normalMap", TextureUnit::NORMAL);
-        gBuffer->positionTex.bind(TextureUnit::POSITION);
-        shader.uniform1i("positionMap", TextureUnit::POSITION);
+        gBuffer->depthTex.bind(TextureUnit::DEPTH);
+        shader.uniform1i("depthMap", TextureUnit::DEPTH);
 
         iblSceneInfo.irradianceMap->bind(TextureUnit::IRRADIANCE);
         shader.uniform1i("irradianceMap", TextureUnit::IRRADIANCE);
@@ -22,6 +22,9 @@ namespace Flux
 
         void render(RenderState& renderState, const Scene& scene) override;
 
+        /** Lights the G-buffer into a cleared target */
+        bool readsSource() const override { return false; }
+
     private:
         ShaderProgram shader;
 
@@ -0,0 +1,206 @@
+#include "Renderer/LightClusters.h"
+
+#include "Scene.h"
+#include "Transform.h"
+#include "PointLight.h"
+
+#include "nvToolsExt.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Flux {
+    namespace
+    {
+        float distanceSquared(const AABB& box, const Vector3f& p)
+        {
+            float dx = std::max(std::max(box.min.x - p.x, 0.0f), p.x - box.max.x);
+            float dy = std::max(std::max(box.min.y - p.y, 0.0f), p.y - box.max.y);
+            float dz = std::max(std::max(box.min.z - p.z, 0.0f), p.z - box.max.z);
+            return dx * dx + dy * dy + dz * dz;
+        }
+
+        int toTile(float ndc, unsigned int tiles)
+        {
+            int tile = (int) std::floor((ndc * 0.5f + 0.5f) * tiles);
+            return std::min(std::max(tile, 0), (int) tiles - 1);
+        }
+    }
+
+    void LightClusters::create() {
+        lightBuffer.create(GL_RGBA32F);
+        clusterBuffer.create(GL_RG32UI);
+        indexBuffer.create(GL_R32UI);
+    }
+
+    void LightClusters::destroy() {
+        lightBuffer.destroy();
+        clusterBuffer.destroy();
+        indexBuffer.destroy();
+    }
+
+    float LightClusters::sliceDepth(unsigned int slice) const {
+        return boundsNear * std::pow(boundsFar / boundsNear, (float) slice / SLICES);
+    }
+
+    int LightClusters::getSlice(float depth) const {
+        int slice = (int) std::floor(std::log(depth) * sliceScale - sliceBias);
+        return std::min(std::max(slice, 0), (int) SLICES - 1);
+    }
+
+    float LightClusters::toNdc(float coordinate, float depth, float scale, float offset) const {
+        return perspective ? coordinate * scale / depth + offset : coordinate * scale + offset;
+    }
+
+    void LightClusters::buildClusterBounds(const Matrix4f& projMatrix, float zNear, float zFar) {
+        if (!clusterBounds.empty() && projMatrix == boundsProjection && zNear == boundsNear && zFar == boundsFar)
+            return;
+
+        boundsProjection = projMatrix;
+        boundsNear = zNear;
+        boundsFar = zFar;
+        perspective = projMatrix[11] != 0;
+
+        sliceScale = SLICES / std::log(zFar / zNear);
+        sliceBias = SLICES * std::log(zNear) / std::log(zFar / zNear);
+
+        // Invert the projection of the tile corners, offsets follow from the column-major layout
+        const float scaleX = projMatrix[0];
+        const float scaleY = projMatrix[5];
+        const float offsetX = perspective ? -projMatrix[8] : projMatrix[12];
+        const float offsetY = perspective ? -projMatrix[9] : projMatrix[13];
+
+        clusterBounds.resize(CLUSTER_COUNT);
+        for (unsigned int z = 0; z < SLICES; z++) {
+            const float depths[2] = { sliceDepth(z), sliceDepth(z + 1) };
+
+            for (unsigned int y = 0; y < TILES_Y; y++) {
+                const float ndcY[2] = { (float) y / TILES_Y * 2 - 1, (float) (y + 1) / TILES_Y * 2 - 1 };
+
+                for (unsigned int x = 0; x < TILES_X; x++) {
+                    const float ndcX[2] = { (float) x / TILES_X * 2 - 1, (float) (x + 1) / TILES_X * 2 - 1 };
+
+                    AABB bounds(Vector3f(INFINITY, INFINITY, -depths[1]), Vector3f(-INFINITY, -INFINITY, -depths[0]));
+                    for (float depth : depths) {
+                        float factor = perspective ? depth : 1;
+                        for (int i = 0; i < 2; i++) {
+                            float vx = (ndcX[i] - offsetX) * factor / scaleX;
+                            float vy = (ndcY[i] - offsetY) * factor / scaleY;
+                            bounds.min.x = std::min(bounds.min.x, vx);
+                            bounds.max.x = std::max(bounds.max.x, vx);
+                            bounds.min.y = std::min(bounds.min.y, vy);
+                            bounds.max.y = std::max(bounds.max.y, vy);
+                        }
+                    }
+                    clusterBounds[(z * TILES_Y + y) * TILES_X + x] = bounds;
+                }
+            }
+        }
+    }
+
+    void LightClusters::update(const Scene& scene, const Matrix4f& projMatrix, const Matrix4f& viewMatrix, float zNear, float zFar, float cutoff) {
+        nvtxRangePushA("Light Clusters");
+
+        buildClusterBounds(projMatrix, zNear, zFar);
+
+        lights.clear();
+        scene.view<Transform, PointLight>().each([&](uint32_t entity, Transform&, PointLight& pointLight) {
+            const Matrix4f& worldMatrix = scene.getWorldMatrix(entity);
+
+            ClusterLight light;
+            light.position[0] = worldMatrix[12];
+            light.position[1] = worldMatrix[13];
+            light.position[2] = worldMatrix[14];
+            const Vector3f intensity = pointLight.getIntensity();
+            light.radius = pointLight.getRadius(cutoff);
+            light.color[0] = intensity.x;
+            light.color[1] = intensity.y;
+            light.color[2] = intensity.z;
+            light.shadowSlot = (float) pointLight.shadowSlot;
+
+            lights.push_back(light);
+        });
+
+        const float scaleX = projMatrix[0];
+        const float scaleY = projMatrix[5];
+        const float offsetX = perspective ? -projMatrix[8] : projMatrix[12];
+        const float offsetY = perspective ? -projMatrix[9] : projMatrix[13];
+
+        assignments.clear();
+        counts.assign(CLUSTER_COUNT, 0);
+
+        for (uint32_t i = 0; i < lights.size(); i++) {
+            const ClusterLight& light = lights[i];
+            const Vector3f center = viewMatrix.transform(Vector3f(light.position[0], light.position[1], light.position[2]), 1);
+            const float radius = light.radius;
+
+            // Clip the depth range of the light against the frustum
+            const float depth = -center.z;
+            const float minDepth = std::max(depth - radius, zNear);
+            const float maxDepth = std::min(depth + radius, zFar);
+            if (minDepth > maxDepth)
+                continue;
+
+            // The box around the light projects to its extremes at the near and far end of its depth range
+            float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+            for (float d : { minDepth, maxDepth }) {
+                for (float sign : { -1.0f, 1.0f }) {
+                    float x = toNdc(center.x + sign * radius, d, scaleX, offsetX);
+                    float y = toNdc(center.y + sign * radius, d, scaleY, offsetY);
+                    minX = std::min(minX, x);
+                    maxX = std::max(maxX, x);
+                    minY = std::min(minY, y);
+                    maxY = std::max(maxY, y);
+                }
+            }
+            if (maxX < -1 || minX > 1 || maxY < -1 || minY > 1)
+                continue;
+
+            const int x0 = toTile(minX, TILES_X), x1 = toTile(maxX, TILES_X);
+            const int y0 = toTile(minY, TILES_Y), y1 = toTile(maxY, TILES_Y);
+            const int z0 = getSlice(minDepth), z1 = getSlice(maxDepth);
+
+            for (int z = z0; z <= z1; z++) {
+                for (int y = y0; y <= y1; y++) {
+                    for (int x = x0; x <= x1; x++) {
+                        uint32_t cluster = (z * TILES_Y + y) * TILES_X + x;
+
+                        if (distanceSquared(clusterBounds[cluster], center) > radius * radius)
+                            continue;
+
+                        assignments.push_back(cluster);
+                        assignments.push_back(i);
+                        counts[cluster]++;
+                    }
+                }
+            }
+        }
+
+        // Compact the assignments into one contiguous range of indices per cluster
+        clusters.resize(CLUSTER_COUNT * 2);
+        uint32_t offset = 0;
+        for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+            clusters[cluster * 2] = offset;
+            clusters[cluster * 2 + 1] = 0;
+            offset += counts[cluster];
+        }
+
+        indices.resize(offset);
+        for (size_t i = 0; i < assignments.size(); i += 2) {
+            uint32_t* range = &clusters[assignments[i] * 2];
+            indices[range[0] + range[1]++] = assignments[i + 1];
+        }
+
+        lightBuffer.setData(lights.size() * sizeof(ClusterLight), lights.data());
+        clusterBuffer.setData(clusters.size() * sizeof(uint32_t), clusters.data());
+        indexBuffer.setData(indices.size() * sizeof(uint32_t), indices.data());
+
+        nvtxRangePop();
+    }
+
+    void LightClusters::bind(unsigned int lightUnit, unsigned int clusterUnit, unsigned int indexUnit) const {
+        lightBuffer.bind(lightUnit);
+        clusterBuffer.bind(clusterUnit);
+        indexBuffer.bind(indexUnit);
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Renderer/TextureBuffer.h"
+#include "Util/Bounds.h"
+
+#include <GDT/Matrix4f.h>
+
+#include <vector>
+#include <cstdint>
+
+using GDT::Matrix4f;
+
+namespace Flux {
+    class Scene;
+
+    /** Point light parameters as stored in the light texture buffer, two RGBA32F texels per light */
+    struct ClusterLight {
+        float position[3];
+        float radius;
+        float color[3];
+        // Index of the light's tiles in the shadow atlas, or -1 if the light casts no shadow
+        float shadowSlot;
+    };
+
+    /**
+     * Assigns the point lights of a scene to the clusters of a froxel grid
+     * spanning the view frustum. Clusters divide the screen into tiles and
+     * the depth range into exponentially growing slices, so a lighting pass
+     * only has to evaluate the lights overlapping the cluster of a pixel.
+     *
+     * The assignment runs on the CPU, the results are uploaded into three
+     * texture buffers: the lights, an offset and count per cluster, and the
+     * light indices referenced by those ranges.
+     */
+    class LightClusters {
+    public:
+        /** Dimensions of the cluster grid, must match the lighting shader */
+        static const unsigned int TILES_X = 16;
+        static const unsigned int TILES_Y = 9;
+        static const unsigned int SLICES = 24;
+        static const unsigned int CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+
+        void create();
+        void destroy();
+
+        /** Builds the light lists of all clusters for the given camera, lights reach until their intensity drops below the cutoff */
+        void update(const Scene& scene, const Matrix4f& projMatrix, const Matrix4f& viewMatrix, float zNear, float zFar, float cutoff);
+
+        void bind(unsigned int lightUnit, unsigned int clusterUnit, unsigned int indexUnit) const;
+
+        uint32_t getLightCount() const {
+            return (uint32_t) lights.size();
+        }
+
+        /** Total number of light references over all clusters */
+        uint32_t getIndexCount() const {
+            return (uint32_t) indices.size();
+        }
+
+        /** Scale and bias turning the log of a view depth into a slice index */
+        float getSliceScale() const {
+            return sliceScale;
+        }
+
+        float getSliceBias() const {
+            return sliceBias;
+        }
+
+    private:
+        void buildClusterBounds(const Matrix4f& projMatrix, float zNear, float zFar);
+        float sliceDepth(unsigned int slice) const;
+        int getSlice(float depth) const;
+        /** Normalized device coordinate of the view space coordinate at the given depth */
+        float toNdc(float coordinate, float depth, float scale, float offset) const;
+
+        TextureBuffer lightBuffer;
+        TextureBuffer clusterBuffer;
+        TextureBuffer indexBuffer;
+
+        std::vector<ClusterLight> lights;
+
+        // View space bounds of every cluster, rebuilt when the projection changes
+        std::vector<AABB> clusterBounds;
+        Matrix4f boundsProjection;
+        float boundsNear = 0;
+        float boundsFar = 0;
+        bool perspective = true;
+
+        float sliceScale = 0;
+        float sliceBias = 0;
+
+        // Offset into the indices and number of lights of every cluster
+        std::vector<uint32_t> clusters;
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> indices;
+        // Pairs of cluster and light index gathered before the lists are compacted
+        std::vector<uint32_t> assignments;
+    };
+}
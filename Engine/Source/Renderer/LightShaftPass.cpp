@@ -25,24 +25,17 @@ namespace Flux
 
         requiredSet.addCapability(STENCIL_TEST, true);
         requiredSet.addCapability(DEPTH_TEST, false);
+        requiredSet.setStencilFunc(GL_EQUAL, 0, 0xFF);
     }
 
     void LightShaftPass::Resize(const Size& windowSize)
     {
         this->windowSize = windowSize;
+    }
 
-        lightTex.create();
-        lightTex.bind(TextureUnit::TEXTURE0);
-        lightTex.setData(windowSize.width / 2, windowSize.height / 2, GL_RGBA16F, GL_RGBA, GL_FLOAT, nullptr);
-        lightTex.setWrapping(CLAMP, CLAMP);
-        lightTex.setSampling(LINEAR, LINEAR);
-        lightTex.release();
-
-        buffer.create();
-        buffer.bind();
-        buffer.addColorTexture(0, lightTex);
-        buffer.validate();
-        buffer.release();
+    void LightShaftPass::setup(RenderGraph& graph)
+    {
+        graph.createPassTarget(RenderTargetDesc(windowSize.width / 2, windowSize.height / 2, GL_RGBA16F), &lightTarget);
     }
 
     void LightShaftPass::setExposure(float exposure)
@@ -65,14 +58,11 @@ namespace Flux
 
         nvtxRangePushA(getPassName().c_str());
 
-        const Framebuffer* sourceFramebuffer = RenderState::currentFramebuffer;
-
         /** Render the non-occluded parts to the buffer, it will be used as input to the light shaft calculation */
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        renderState.setClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
-        glStencilFunc(GL_EQUAL, 0, 0xFF);
 
-        texShader.bind();
+        RenderState::useProgram(texShader);
 
         source->bind(TextureUnit::TEXTURE0);
         texShader.uniform1i("tex", TextureUnit::TEXTURE0);
@@ -82,14 +72,13 @@ namespace Flux
         renderState.disable(STENCIL_TEST);
 
         /** Light Shaft Pass */
-        buffer.bind();
+        lightTarget->getFramebuffer().bind();
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
-        glViewport(0, 0, windowSize.width / 2, windowSize.height / 2);
+        renderState.setViewport(0, 0, windowSize.width / 2, windowSize.height / 2);
 
         for (Entity* entity : scene.lights) {
             if (entity->hasComponent<DirectionalLight>()) {
@@ -104,7 +93,7 @@ namespace Flux
             }
         }
 
-        sourceFramebuffer->getTexture().bind(TextureUnit::TEXTURE0);
+        target->getTexture().bind(TextureUnit::TEXTURE0);
         shader.uniform1i("sourceTex", TextureUnit::TEXTURE0);
 
         shader.uniform1f("exposure", exposure);
@@ -114,11 +103,11 @@ namespace Flux
         renderState.drawQuad();
 
         /** Add the light shafts to the original input texture */
-        sourceFramebuffer->bind();
+        target->bind();
 
-        glViewport(0, 0, windowSize.width, windowSize.height);
+        renderState.setViewport(0, 0, windowSize.width, windowSize.height);
 
-        std::vector<Texture2D> sources{ *source, lightTex };
+        std::vector<Texture2D> sources{ *source, lightTarget->getTexture() };
         std::vector<float> weights{ 1, 1 };
         addPass.SetTextures(sources);
         addPass.SetWeights(weights);
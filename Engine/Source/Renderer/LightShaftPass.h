@@ -4,12 +4,12 @@
 
 #include "AddPass.h"
 #include "Util/Size.h"
+#include "Renderer/RenderGraph.h"
 
 #include <memory>
 
 namespace Flux
 {
-    class Framebuffer;
     class Texture2D;
 
     class LightShaftPass : public RenderPhase
@@ -19,6 +19,8 @@ namespace Flux
 
         virtual void Resize(const Size& windowSize) override;
 
+        virtual void setup(RenderGraph& graph) override;
+
         virtual void render(RenderState& renderState, const Scene& scene) override;
 
         void setExposure(float exposure);
@@ -31,8 +33,8 @@ namespace Flux
 
         Size windowSize;
 
-        Framebuffer buffer;
-        Texture2D lightTex;
+        // Light shafts at half resolution
+        RenderTarget* lightTarget = nullptr;
 
         float exposure;
         float density;
@@ -0,0 +1,101 @@
+#include "Renderer/MeshPool.h"
+
+#include "Mesh.h"
+#include "Renderer/RenderState.h"
+
+#include <algorithm>
+
+namespace Flux {
+    void MeshPool::add(Mesh& mesh) {
+        auto it = ranges.find(mesh.handle);
+        if (it != ranges.end()) {
+            mesh.baseVertex = it->second.baseVertex;
+            mesh.firstIndex = it->second.firstIndex;
+            return;
+        }
+
+        // All meshes in the pool share the position format of the first one
+        if (meshCount == 0) {
+            quantized = mesh.quantized;
+        }
+        PackedMesh packed = VertexFormat::pack(mesh, quantized);
+
+        Range range = { (GLint) vertexCount, (GLuint) indices.size() };
+        ranges[mesh.handle] = range;
+
+        mesh.baseVertex = range.baseVertex;
+        mesh.firstIndex = range.firstIndex;
+        mesh.positionScale = packed.positionScale;
+        mesh.positionOffset = packed.positionOffset;
+
+        positions.insert(positions.end(), packed.positions.begin(), packed.positions.end());
+        attributes.insert(attributes.end(), packed.attributes.begin(), packed.attributes.end());
+        indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+        indices.insert(indices.end(), mesh.lodIndices.begin(), mesh.lodIndices.end());
+
+        vertexCount += mesh.vertices.size();
+        maxMeshVertices = std::max(maxMeshVertices, mesh.vertices.size());
+        meshCount++;
+    }
+
+    void MeshPool::upload() {
+        if (vertexCount == 0)
+            return;
+
+        glGenBuffers(3, buffers);
+
+        // Indices are relative to the base vertex, so only the largest mesh decides the index size
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        if (maxMeshVertices <= 0x10000) {
+            std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            indexType = GL_UNSIGNED_SHORT;
+            glBufferData(GL_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+        } else {
+            indexType = GL_UNSIGNED_INT;
+            glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+        glBufferData(GL_ARRAY_BUFFER, positions.size(), positions.data(), GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[2]);
+        glBufferData(GL_ARRAY_BUFFER, attributes.size() * sizeof(PackedAttributes), attributes.data(), GL_STATIC_DRAW);
+
+        glGenVertexArrays(1, &vao);
+        RenderState::bindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+        VertexFormat::setPositionAttribute(quantized);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[2]);
+        VertexFormat::setPackedAttributes();
+
+        glGenVertexArrays(1, &positionVao);
+        RenderState::bindVertexArray(positionVao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+        VertexFormat::setPositionAttribute(quantized);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        RenderState::bindVertexArray(0);
+
+        // The geometry lives on the GPU now
+        std::vector<unsigned char>().swap(positions);
+        std::vector<PackedAttributes>().swap(attributes);
+        std::vector<uint32_t>().swap(indices);
+    }
+
+    void MeshPool::destroy() {
+        if (vao == 0)
+            return;
+
+        // Deleting a bound vertex array reverts the binding to zero
+        if (RenderState::getVertexArray() == vao || RenderState::getVertexArray() == positionVao)
+            RenderState::bindVertexArray(0);
+
+        glDeleteBuffers(3, buffers);
+        glDeleteVertexArrays(1, &vao);
+        glDeleteVertexArrays(1, &positionVao);
+        vao = 0;
+        positionVao = 0;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Renderer/VertexFormat.h"
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace Flux {
+    class Mesh;
+
+    /**
+     * Packs the geometry of many meshes into shared vertex and index buffers
+     * behind a single vertex array. Drawing a different mesh then only changes
+     * the base vertex and index offset of the draw instead of the bound vertex array.
+     */
+    class MeshPool {
+    public:
+        MeshPool() :
+            vao(0),
+            positionVao(0),
+            indexType(GL_UNSIGNED_INT),
+            quantized(false),
+            meshCount(0)
+        {
+
+        }
+
+        /** Appends the geometry of the mesh, meshes sharing a vertex array are stored once */
+        void add(Mesh& mesh);
+
+        /** Uploads the geometry of all added meshes and releases the staging copies */
+        void upload();
+
+        void destroy();
+
+        GLuint getHandle() const {
+            return vao;
+        }
+
+        /** Vertex array sourcing only the positions, for depth only passes */
+        GLuint getPositionHandle() const {
+            return positionVao;
+        }
+
+        GLenum getIndexType() const {
+            return indexType;
+        }
+
+        unsigned int getMeshCount() const {
+            return meshCount;
+        }
+
+    private:
+        struct Range {
+            GLint baseVertex;
+            GLuint firstIndex;
+        };
+
+        // Location of the geometry of every added vertex array
+        std::unordered_map<GLuint, Range> ranges;
+
+        std::vector<unsigned char> positions;
+        std::vector<PackedAttributes> attributes;
+        std::vector<uint32_t> indices;
+        size_t vertexCount = 0;
+        size_t maxMeshVertices = 0;
+
+        GLuint vao;
+        GLuint positionVao;
+        GLuint buffers[3];
+        GLenum indexType;
+        bool quantized;
+        unsigned int meshCount;
+    };
+}
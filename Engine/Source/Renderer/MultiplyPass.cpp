@@ -32,7 +32,7 @@ namespace Flux {
     {
         nvtxRangePushA(getPassName().c_str());
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
         const unsigned int sourceCount = textures.size();
 
@@ -0,0 +1,322 @@
+#include "Renderer/OcclusionRasterizer.h"
+
+#include "nvToolsExt.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace Flux {
+    namespace
+    {
+        // Vertices closer to the eye plane than this are left out along with their triangles
+        const float MIN_CLIP_W = 1e-4f;
+
+        float horizontalMax(__m128 v)
+        {
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+            return _mm_cvtss_f32(v);
+        }
+
+        double millisecondsSince(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    OcclusionRasterizer::~OcclusionRasterizer() {
+        destroy();
+    }
+
+    void OcclusionRasterizer::create(unsigned int width, unsigned int height, unsigned int workerCount) {
+        destroy();
+
+        // Pixels are written four at a time and tiles span whole bands, partial ones would run into the next row
+        this->width = (width + TILE_WIDTH - 1) / TILE_WIDTH * TILE_WIDTH;
+        this->height = (height + BAND_HEIGHT - 1) / BAND_HEIGHT * BAND_HEIGHT;
+        bandCount = this->height / BAND_HEIGHT;
+
+        depth.assign(this->width * this->height, 1.0f);
+        tileDepth.assign((this->width / TILE_WIDTH) * bandCount, 1.0f);
+        bins.resize(bandCount);
+
+        for (unsigned int i = 0; i < workerCount; i++) {
+            workers.emplace_back(&OcclusionRasterizer::workerLoop, this);
+        }
+    }
+
+    void OcclusionRasterizer::destroy() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        startCondition.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        quit = false;
+    }
+
+    void OcclusionRasterizer::clear(const Matrix4f& projViewMatrix) {
+        this->projViewMatrix = projViewMatrix;
+
+        triangles.clear();
+        for (std::vector<uint32_t>& bin : bins) {
+            bin.clear();
+        }
+        stats = OcclusionStats();
+    }
+
+    void OcclusionRasterizer::addOccluder(const std::vector<Vector3f>& vertices, const std::vector<unsigned int>& indices, const Matrix4f& worldMatrix) {
+        const Matrix4f matrix = projViewMatrix * worldMatrix;
+        const Matrix4f& m = matrix;
+
+        screenVertices.resize(vertices.size());
+        clipped.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const Vector3f& v = vertices[i];
+            const float clipX = m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12];
+            const float clipY = m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13];
+            const float clipZ = m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14];
+            const float clipW = m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15];
+
+            clipped[i] = clipW < MIN_CLIP_W;
+            if (clipped[i])
+                continue;
+
+            screenVertices[i] = Vector3f(
+                (clipX / clipW * 0.5f + 0.5f) * width,
+                (clipY / clipW * 0.5f + 0.5f) * height,
+                clipZ / clipW * 0.5f + 0.5f);
+        }
+
+        // Dropping a triangle only loses occlusion, so clipping against the eye plane is not needed
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            if (clipped[indices[i]] || clipped[indices[i + 1]] || clipped[indices[i + 2]])
+                continue;
+            setupTriangle(screenVertices[indices[i]], screenVertices[indices[i + 1]], screenVertices[indices[i + 2]]);
+        }
+    }
+
+    void OcclusionRasterizer::setupTriangle(const Vector3f& a, const Vector3f& b, const Vector3f& c) {
+        // Back faces of closed occluders lie behind their front faces
+        const float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+        if (area <= 0)
+            return;
+
+        // Pixels whose centers fall inside the bounds of the triangle
+        Triangle triangle;
+        triangle.minX = std::max((int) std::ceil(std::min(a.x, std::min(b.x, c.x)) - 0.5f), 0);
+        triangle.maxX = std::min((int) std::floor(std::max(a.x, std::max(b.x, c.x)) - 0.5f), (int) width - 1);
+        triangle.minY = std::max((int) std::ceil(std::min(a.y, std::min(b.y, c.y)) - 0.5f), 0);
+        triangle.maxY = std::min((int) std::floor(std::max(a.y, std::max(b.y, c.y)) - 0.5f), (int) height - 1);
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+            return;
+
+        // Edge i lies opposite of vertex i and is positive on the inside of the triangle
+        const Vector3f* vertices[3] = { &a, &b, &c };
+        for (int i = 0; i < 3; i++) {
+            const Vector3f& v0 = *vertices[(i + 1) % 3];
+            const Vector3f& v1 = *vertices[(i + 2) % 3];
+            triangle.edges[i][0] = v0.y - v1.y;
+            triangle.edges[i][1] = v1.x - v0.x;
+            triangle.edges[i][2] = v0.x * v1.y - v0.y * v1.x;
+        }
+
+        // Depth is linear in screen space, the edges divided by the area are its barycentric weights
+        for (int i = 0; i < 3; i++) {
+            triangle.plane[i] = (triangle.edges[0][i] * a.z + triangle.edges[1][i] * b.z + triangle.edges[2][i] * c.z) / area;
+        }
+
+        const uint32_t index = (uint32_t) triangles.size();
+        triangles.push_back(triangle);
+        for (unsigned int band = triangle.minY / BAND_HEIGHT; band <= triangle.maxY / BAND_HEIGHT; band++) {
+            bins[band].push_back(index);
+        }
+    }
+
+    void OcclusionRasterizer::rasterize() {
+        nvtxRangePushA("Occlusion Rasterizer");
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            nextBand = 0;
+            pendingBands = bandCount;
+            generation++;
+        }
+        startCondition.notify_all();
+
+        // The calling thread takes bands as well instead of waiting idle
+        processBands();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            doneCondition.wait(lock, [this] { return pendingBands == 0; });
+        }
+
+        stats.triangles = (uint32_t) triangles.size();
+        stats.rasterizeTime = millisecondsSince(start);
+        nvtxRangePop();
+    }
+
+    void OcclusionRasterizer::processBands() {
+        unsigned int band;
+        while ((band = nextBand++) < bandCount) {
+            rasterizeBand(band);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pendingBands == 0) {
+                doneCondition.notify_all();
+            }
+        }
+    }
+
+    void OcclusionRasterizer::workerLoop() {
+        unsigned int seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                startCondition.wait(lock, [&] { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen = generation;
+            }
+            processBands();
+        }
+    }
+
+    void OcclusionRasterizer::rasterizeBand(unsigned int band) {
+        const int bandMinY = band * BAND_HEIGHT;
+        const int bandMaxY = bandMinY + BAND_HEIGHT - 1;
+
+        std::fill(depth.begin() + bandMinY * width, depth.begin() + (bandMaxY + 1) * width, 1.0f);
+
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 centers = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+        for (uint32_t index : bins[band]) {
+            const Triangle& triangle = triangles[index];
+
+            const int minY = std::max(triangle.minY, bandMinY);
+            const int maxY = std::min(triangle.maxY, bandMaxY);
+            // Rows are processed in aligned groups of four pixels, the edges reject the ones outside
+            const int minX = triangle.minX & ~3;
+
+            const __m128 edgeX[3] = { _mm_set1_ps(triangle.edges[0][0]), _mm_set1_ps(triangle.edges[1][0]), _mm_set1_ps(triangle.edges[2][0]) };
+            const __m128 edgeStep[3] = { _mm_set1_ps(triangle.edges[0][0] * 4), _mm_set1_ps(triangle.edges[1][0] * 4), _mm_set1_ps(triangle.edges[2][0] * 4) };
+            const __m128 depthX = _mm_set1_ps(triangle.plane[0]);
+            const __m128 depthStep = _mm_set1_ps(triangle.plane[0] * 4);
+
+            for (int y = minY; y <= maxY; y++) {
+                const float centerY = y + 0.5f;
+                const __m128 x = _mm_add_ps(_mm_set1_ps((float) minX), centers);
+
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(edgeX[0], x), _mm_set1_ps(triangle.edges[0][1] * centerY + triangle.edges[0][2]));
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(edgeX[1], x), _mm_set1_ps(triangle.edges[1][1] * centerY + triangle.edges[1][2]));
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(edgeX[2], x), _mm_set1_ps(triangle.edges[2][1] * centerY + triangle.edges[2][2]));
+                __m128 z = _mm_add_ps(_mm_mul_ps(depthX, x), _mm_set1_ps(triangle.plane[1] * centerY + triangle.plane[2]));
+
+                float* row = &depth[y * width];
+                for (int px = minX; px <= triangle.maxX; px += 4) {
+                    const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+                    if (_mm_movemask_ps(inside)) {
+                        const __m128 current = _mm_loadu_ps(row + px);
+                        const __m128 nearest = _mm_min_ps(current, z);
+                        _mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+                    }
+
+                    e0 = _mm_add_ps(e0, edgeStep[0]);
+                    e1 = _mm_add_ps(e1, edgeStep[1]);
+                    e2 = _mm_add_ps(e2, edgeStep[2]);
+                    z = _mm_add_ps(z, depthStep);
+                }
+            }
+        }
+
+        // Keep the farthest depth of every tile, so most tests never look at single pixels
+        const unsigned int tilesX = width / TILE_WIDTH;
+        for (unsigned int tile = 0; tile < tilesX; tile++) {
+            __m128 farthest = zero;
+            for (int y = bandMinY; y <= bandMaxY; y++) {
+                const float* row = &depth[y * width + tile * TILE_WIDTH];
+                farthest = _mm_max_ps(farthest, _mm_max_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4)));
+            }
+            tileDepth[band * tilesX + tile] = horizontalMax(farthest);
+        }
+    }
+
+    bool OcclusionRasterizer::isOccluded(const AABB& box) const {
+        float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+        float minDepth = INFINITY;
+        for (int i = 0; i < 8; i++) {
+            const float x = (i & 1) ? box.max.x : box.min.x;
+            const float y = (i & 2) ? box.max.y : box.min.y;
+            const float z = (i & 4) ? box.max.z : box.min.z;
+
+            const Matrix4f& m = projViewMatrix;
+            const float clipX = m[0] * x + m[4] * y + m[8] * z + m[12];
+            const float clipY = m[1] * x + m[5] * y + m[9] * z + m[13];
+            const float clipZ = m[2] * x + m[6] * y + m[10] * z + m[14];
+            const float clipW = m[3] * x + m[7] * y + m[11] * z + m[15];
+
+            // A box reaching behind the camera may cover any pixel
+            if (clipW < MIN_CLIP_W)
+                return false;
+
+            minX = std::min(minX, clipX / clipW);
+            maxX = std::max(maxX, clipX / clipW);
+            minY = std::min(minY, clipY / clipW);
+            maxY = std::max(maxY, clipY / clipW);
+            minDepth = std::min(minDepth, clipZ / clipW * 0.5f + 0.5f);
+        }
+
+        if (maxX < -1 || minX > 1 || maxY < -1 || minY > 1)
+            return false;
+
+        // Every pixel the box touches, not only the ones whose center it covers
+        const int x0 = std::max((int) std::floor((minX * 0.5f + 0.5f) * width), 0);
+        const int x1 = std::min((int) std::floor((maxX * 0.5f + 0.5f) * width), (int) width - 1);
+        const int y0 = std::max((int) std::floor((minY * 0.5f + 0.5f) * height), 0);
+        const int y1 = std::min((int) std::floor((maxY * 0.5f + 0.5f) * height), (int) height - 1);
+
+        const int tilesX = width / TILE_WIDTH;
+        for (int tileY = y0 / (int) BAND_HEIGHT; tileY <= y1 / (int) BAND_HEIGHT; tileY++) {
+            for (int tileX = x0 / (int) TILE_WIDTH; tileX <= x1 / (int) TILE_WIDTH; tileX++) {
+                if (tileDepth[tileY * tilesX + tileX] < minDepth)
+                    continue;
+
+                // Something in the tile lies behind the box, look at the pixels it shares with the box
+                const int rowEnd = std::min(y1, (tileY + 1) * (int) BAND_HEIGHT - 1);
+                const int columnEnd = std::min(x1, (tileX + 1) * (int) TILE_WIDTH - 1);
+                for (int y = std::max(y0, tileY * (int) BAND_HEIGHT); y <= rowEnd; y++) {
+                    for (int x = std::max(x0, tileX * (int) TILE_WIDTH); x <= columnEnd; x++) {
+                        if (depth[y * width + x] >= minDepth)
+                            return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    void OcclusionRasterizer::cull(std::vector<uint32_t>& entities, const std::vector<AABB>& bounds) {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        size_t visibleCount = 0;
+        for (uint32_t entity : entities) {
+            if (!isOccluded(bounds[entity])) {
+                entities[visibleCount++] = entity;
+            }
+        }
+        stats.tests += (uint32_t) entities.size();
+        stats.occluded += (uint32_t) (entities.size() - visibleCount);
+        entities.resize(visibleCount);
+
+        stats.testTime += millisecondsSince(start);
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Util/Bounds.h"
+
+#include <GDT/Matrix4f.h>
+#include <GDT/Vector3f.h>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+using GDT::Matrix4f;
+using GDT::Vector3f;
+
+namespace Flux {
+    /** Work and timing of the last rasterized frame and the tests made against it */
+    struct OcclusionStats {
+        uint32_t triangles;
+        uint32_t tests;
+        uint32_t occluded;
+        // Milliseconds spent rasterizing the occluders and testing bounds
+        double rasterizeTime;
+        double testTime;
+    };
+
+    /**
+     * Low resolution depth buffer filled on the CPU with a few large occluder
+     * meshes, against which bounds are tested before they are submitted.
+     * Unlike the depth pyramid the result belongs to the current frame, it
+     * needs no readback and no second pass. Triangles are set up on the calling
+     * thread and binned into bands of rows, which worker threads rasterize four
+     * pixels at a time with SSE2.
+     */
+    class OcclusionRasterizer {
+    public:
+        OcclusionRasterizer() { }
+        ~OcclusionRasterizer();
+
+        /** Creates the depth buffer, the size is rounded up to whole tiles of TILE_WIDTH by BAND_HEIGHT pixels */
+        void create(unsigned int width, unsigned int height, unsigned int workerCount);
+        void destroy();
+
+        /** Starts a frame seen through the given matrix, dropping the occluders of the previous one */
+        void clear(const Matrix4f& projViewMatrix);
+
+        /** Queues the triangles of a mesh given in object space */
+        void addOccluder(const std::vector<Vector3f>& vertices, const std::vector<unsigned int>& indices, const Matrix4f& worldMatrix);
+
+        /** Rasterizes all queued occluders, returns once every band is done */
+        void rasterize();
+
+        /** Returns true if every pixel the box covers holds an occluder in front of it */
+        bool isOccluded(const AABB& box) const;
+
+        /** Removes the entities whose bounds are occluded, the others keep their order */
+        void cull(std::vector<uint32_t>& entities, const std::vector<AABB>& bounds);
+
+        const std::vector<float>& getDepth() const {
+            return depth;
+        }
+
+        const OcclusionStats& getStats() const {
+            return stats;
+        }
+
+        unsigned int getWidth() const {
+            return width;
+        }
+
+        unsigned int getHeight() const {
+            return height;
+        }
+
+        static const unsigned int BAND_HEIGHT = 8;
+        static const unsigned int TILE_WIDTH = 8;
+        static const unsigned int DEFAULT_WIDTH = 256;
+        static const unsigned int DEFAULT_HEIGHT = 128;
+
+    private:
+        /** Edge functions and depth plane of a front facing triangle in pixel coordinates */
+        struct Triangle {
+            float edges[3][3];
+            float plane[3];
+            int minX, maxX, minY, maxY;
+        };
+
+        void setupTriangle(const Vector3f& a, const Vector3f& b, const Vector3f& c);
+        void rasterizeBand(unsigned int band);
+        void processBands();
+        void workerLoop();
+
+        unsigned int width = 0;
+        unsigned int height = 0;
+        unsigned int bandCount = 0;
+
+        Matrix4f projViewMatrix;
+        std::vector<float> depth;
+        // Farthest depth of every tile of TILE_WIDTH by BAND_HEIGHT pixels
+        std::vector<float> tileDepth;
+
+        // Screen space positions of the queued occluders, z holds the depth in [0, 1]
+        std::vector<Vector3f> screenVertices;
+        std::vector<unsigned char> clipped;
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> bins;
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable startCondition;
+        std::condition_variable doneCondition;
+        unsigned int generation = 0;
+        unsigned int pendingBands = 0;
+        std::atomic<unsigned int> nextBand{ 0 };
+        bool quit = false;
+
+        OcclusionStats stats = {};
+    };
+}
@@ -0,0 +1,120 @@
+#include "Renderer/RenderGraph.h"
+
+#include "RenderPhase.h"
+
+#include <algorithm>
+
+namespace Flux {
+    void RenderGraph::clear() {
+        resources.clear();
+        nodes.clear();
+        outputs.clear();
+        culledCount = 0;
+    }
+
+    RenderResource RenderGraph::import(const Framebuffer* framebuffer) {
+        resources.push_back({ RenderTargetDesc(), framebuffer, nullptr, nullptr, -1, -1 });
+        return (RenderResource) resources.size() - 1;
+    }
+
+    RenderResource RenderGraph::createTarget(const RenderTargetDesc& desc) {
+        resources.push_back({ desc, nullptr, nullptr, nullptr, -1, -1 });
+        return (RenderResource) resources.size() - 1;
+    }
+
+    void RenderGraph::addPass(RenderPhase* pass, RenderResource source, RenderResource target) {
+        nodes.push_back({ pass, source, target, {}, pass->readsSource(), false });
+        pass->setup(*this);
+    }
+
+    void RenderGraph::createPassTarget(const RenderTargetDesc& desc, RenderTarget** binding) {
+        *binding = nullptr;
+        resources.push_back({ desc, nullptr, nullptr, binding, -1, -1 });
+        nodes.back().passTargets.push_back((RenderResource) resources.size() - 1);
+    }
+
+    void RenderGraph::setOutput(RenderResource resource) {
+        outputs.push_back(resource);
+    }
+
+    void RenderGraph::compile(RenderTargetPool& pool) {
+        // Walk back from the outputs, a pass is only needed if a later needed pass reads what it writes
+        std::vector<bool> needed(resources.size(), false);
+        for (RenderResource output : outputs) {
+            needed[output] = true;
+        }
+
+        culledCount = 0;
+        for (int i = (int) nodes.size() - 1; i >= 0; i--) {
+            Node& node = nodes[i];
+            node.culled = !needed[node.target];
+            if (node.culled) {
+                culledCount++;
+                continue;
+            }
+            if (node.readsSource) {
+                needed[node.source] = true;
+            }
+        }
+
+        auto use = [this](RenderResource resource, int index) {
+            Resource& r = resources[resource];
+            r.firstUse = r.firstUse < 0 ? index : std::min(r.firstUse, index);
+            r.lastUse = std::max(r.lastUse, index);
+        };
+        for (int i = 0; i < (int) nodes.size(); i++) {
+            const Node& node = nodes[i];
+            if (node.culled)
+                continue;
+            if (node.readsSource) {
+                use(node.source, i);
+            }
+            use(node.target, i);
+            for (RenderResource passTarget : node.passTargets) {
+                use(passTarget, i);
+            }
+        }
+        // Outputs are read after the graph ran, so their target is never handed on
+        for (RenderResource output : outputs) {
+            resources[output].lastUse = (int) nodes.size();
+        }
+
+        pool.reset();
+        for (int i = 0; i < (int) nodes.size(); i++) {
+            for (Resource& resource : resources) {
+                if (resource.imported || resource.firstUse != i)
+                    continue;
+                resource.target = pool.acquire(resource.desc);
+                if (resource.binding) {
+                    *resource.binding = resource.target;
+                }
+            }
+            for (Resource& resource : resources) {
+                if (resource.target && resource.lastUse == i) {
+                    pool.release(resource.target);
+                }
+            }
+        }
+        // Targets of an earlier size or pipeline that were not handed out again
+        pool.trim();
+    }
+
+    void RenderGraph::execute(RenderState& renderState, const Scene& scene) {
+        for (const Node& node : nodes) {
+            if (node.culled)
+                continue;
+
+            const Framebuffer& target = getFramebuffer(node.target);
+            node.pass->SetSource(node.readsSource ? &getFramebuffer(node.source).getTexture() : nullptr);
+            node.pass->SetTarget(&target);
+
+            target.bind();
+            node.pass->render(renderState, scene);
+        }
+    }
+
+    const Framebuffer& RenderGraph::getFramebuffer(RenderResource resource) const {
+        const Resource& r = resources[resource];
+        return r.imported ? *r.imported : r.target->getFramebuffer();
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Renderer/RenderTargetPool.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace Flux {
+    class RenderPhase;
+    class RenderState;
+    class Scene;
+
+    typedef uint32_t RenderResource;
+
+    /**
+     * Ordered passes with the targets they read and write. Compiling the graph
+     * culls the passes whose results never reach an output and takes the
+     * targets from a pool, where a target whose last reader has run is handed
+     * to the next target created with the same description. Consecutive passes
+     * writing full screen targets thereby alternate between two textures.
+     */
+    class RenderGraph {
+    public:
+        void clear();
+
+        /** Adds a framebuffer rendered outside of the graph, it is never culled or shared */
+        RenderResource import(const Framebuffer* framebuffer);
+
+        /** Adds a target taken from the pool when the graph is compiled */
+        RenderResource createTarget(const RenderTargetDesc& desc);
+
+        /**
+         * Adds a pass rendering into the target, the pass declares its own targets during setup.
+         * The source is only kept alive if the pass reads it.
+         */
+        void addPass(RenderPhase* pass, RenderResource source, RenderResource target);
+
+        /** Adds a target only used by the pass being set up, the binding points at the target once the graph is compiled */
+        void createPassTarget(const RenderTargetDesc& desc, RenderTarget** binding);
+
+        /** Marks the resource as a result of the graph, which keeps the passes writing it */
+        void setOutput(RenderResource resource);
+
+        void compile(RenderTargetPool& pool);
+
+        void execute(RenderState& renderState, const Scene& scene);
+
+        const Framebuffer& getFramebuffer(RenderResource resource) const;
+
+        /** Number of passes left out by the last compile */
+        size_t getCulledCount() const {
+            return culledCount;
+        }
+
+    private:
+        struct Resource {
+            RenderTargetDesc desc;
+            const Framebuffer* imported;
+            RenderTarget* target;
+            RenderTarget** binding;
+            // Index of the first and last pass using the resource
+            int firstUse;
+            int lastUse;
+        };
+
+        struct Node {
+            RenderPhase* pass;
+            RenderResource source;
+            RenderResource target;
+            std::vector<RenderResource> passTargets;
+            bool readsSource;
+            bool culled;
+        };
+
+        std::vector<Resource> resources;
+        std::vector<Node> nodes;
+        std::vector<RenderResource> outputs;
+
+        size_t culledCount = 0;
+    };
+}
@@ -6,31 +6,75 @@
 #include "Camera.h"
 #include "Texture.h"
 
+#include <cstring>
+#include <algorithm>
+
 namespace Flux {
     GLuint RenderState::quadVao = 0;
 
     std::vector<uint> RenderState::textureUnits(Texture::MAX_TEXTURE_UNITS);
     uint RenderState::activeTextureUnit = 0;
 
-    const Framebuffer* RenderState::currentFramebuffer = 0;
+    const ShaderProgram* RenderState::currentProgram = nullptr;
+    GLuint RenderState::currentVao = 0;
+    GLuint RenderState::drawFramebuffer = 0;
+    GLuint RenderState::readFramebuffer = 0;
+    std::unordered_map<GLuint, std::vector<GLenum>> RenderState::drawBuffers;
+
+    StateStats RenderState::stats = {};
+
+    // Initial values as defined by the GL specification
+    std::unordered_map<Capability, bool> RenderState::capabilityMap = {
+        { BLENDING, false },
+        { FACE_CULLING, false },
+        { DEPTH_TEST, false },
+        { STENCIL_TEST, false },
+        { POLYGON_OFFSET, false },
+        { SCISSOR_TEST, false },
+        { CLIP_DISTANCE0, false },
+        { CLIP_DISTANCE1, false },
+        { CLIP_DISTANCE2, false },
+        { CLIP_DISTANCE3, false }
+    };
+    GLenum RenderState::depthFunc = GL_LESS;
+    bool RenderState::depthMask = true;
+    bool RenderState::colorMask = true;
+    GLenum RenderState::stencilFunc = GL_ALWAYS;
+    GLint RenderState::stencilRef = 0;
+    GLuint RenderState::stencilFuncMask = ~0u;
+    GLenum RenderState::stencilOp[3] = { GL_KEEP, GL_KEEP, GL_KEEP };
+    GLuint RenderState::stencilMask = ~0u;
+    GLenum RenderState::blendFunc[4] = { GL_ONE, GL_ZERO, GL_ONE, GL_ZERO };
+    float RenderState::polygonOffset[2] = { 0, 0 };
+    GLenum RenderState::cullFace = GL_BACK;
+    // The initial viewport and scissor box depend on the window, so the first call is always issued
+    int RenderState::viewport[4] = { -1, -1, -1, -1 };
+    int RenderState::scissor[4] = { -1, -1, -1, -1 };
+    float RenderState::clearColor[4] = { 0, 0, 0, 0 };
+    float RenderState::clearDepth = 1;
 
     RenderState::RenderState() :
-        clearColor(1, 0, 1),
         projMatrix(),
         viewMatrix(),
         modelMatrix()
     {
         glGenVertexArrays(1, &quadVao);
 
-        capabilityMap[BLENDING] = false;
-        capabilityMap[FACE_CULLING] = false;
-        capabilityMap[DEPTH_TEST] = false;
-        capabilityMap[STENCIL_TEST] = false;
-        capabilityMap[POLYGON_OFFSET] = false;
+        cameraBuffer.create();
+        cameraBuffer.setData(sizeof(CameraUniforms), nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    bool RenderState::filter(StateCall call, bool redundant) {
+        if (redundant)
+            stats.filtered[call]++;
+        else
+            stats.issued[call]++;
+
+        return redundant;
     }
 
     void RenderState::enable(Capability capability) {
-        if (capabilityMap[capability])
+        if (filter(CAPABILITY_CALL, capabilityMap[capability]))
             return;
 
         glEnable(capability);
@@ -38,52 +82,277 @@ namespace Flux {
     }
 
     void RenderState::disable(Capability capability) {
-        if (!capabilityMap[capability])
+        if (filter(CAPABILITY_CALL, !capabilityMap[capability]))
             return;
 
         glDisable(capability);
         capabilityMap[capability] = false;
     }
 
-    void RenderState::require(CapabilitySet capabilitySet) {
-        for (auto& pair : capabilitySet.getSet()) {
+    void RenderState::require(const PipelineState& state) {
+        for (auto& pair : state.capabilities) {
             if (pair.second)
                 enable(pair.first);
             else
                 disable(pair.first);
         }
+
+        if (state.has(DEPTH_FUNC))
+            setDepthFunc(state.depthFunc);
+        if (state.has(DEPTH_MASK))
+            setDepthMask(state.depthMask);
+        if (state.has(COLOR_MASK))
+            setColorMask(state.colorMask);
+        if (state.has(STENCIL_FUNC))
+            setStencilFunc(state.stencilFunc, state.stencilRef, state.stencilFuncMask);
+        if (state.has(STENCIL_OP))
+            setStencilOp(state.stencilOp[0], state.stencilOp[1], state.stencilOp[2]);
+        if (state.has(STENCIL_MASK))
+            setStencilMask(state.stencilMask);
+        if (state.has(BLEND_FUNC))
+            setBlendFunc(state.blendFunc[0], state.blendFunc[1], state.blendFunc[2], state.blendFunc[3]);
+        if (state.has(POLYGON_OFFSET_VALUES))
+            setPolygonOffset(state.polygonOffset[0], state.polygonOffset[1]);
+        if (state.has(CULL_FACE))
+            setCullFace(state.cullFace);
+    }
+
+    void RenderState::setDepthFunc(GLenum func) {
+        if (filter(DEPTH_CALL, depthFunc == func))
+            return;
+
+        glDepthFunc(func);
+        depthFunc = func;
+    }
+
+    void RenderState::setDepthMask(bool enabled) {
+        if (filter(DEPTH_CALL, depthMask == enabled))
+            return;
+
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+        depthMask = enabled;
+    }
+
+    void RenderState::setColorMask(bool enabled) {
+        if (filter(COLOR_MASK_CALL, colorMask == enabled))
+            return;
+
+        glColorMask(enabled, enabled, enabled, enabled);
+        colorMask = enabled;
+    }
+
+    void RenderState::setStencilFunc(GLenum func, GLint ref, GLuint mask) {
+        if (filter(STENCIL_CALL, stencilFunc == func && stencilRef == ref && stencilFuncMask == mask))
+            return;
+
+        glStencilFunc(func, ref, mask);
+        stencilFunc = func;
+        stencilRef = ref;
+        stencilFuncMask = mask;
+    }
+
+    void RenderState::setStencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass) {
+        if (filter(STENCIL_CALL, stencilOp[0] == stencilFail && stencilOp[1] == depthFail && stencilOp[2] == depthPass))
+            return;
+
+        glStencilOp(stencilFail, depthFail, depthPass);
+        stencilOp[0] = stencilFail;
+        stencilOp[1] = depthFail;
+        stencilOp[2] = depthPass;
+    }
+
+    void RenderState::setStencilMask(GLuint mask) {
+        if (filter(STENCIL_CALL, stencilMask == mask))
+            return;
+
+        glStencilMask(mask);
+        stencilMask = mask;
+    }
+
+    void RenderState::setBlendFunc(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha) {
+        if (filter(BLEND_CALL, blendFunc[0] == srcRGB && blendFunc[1] == dstRGB && blendFunc[2] == srcAlpha && blendFunc[3] == dstAlpha))
+            return;
+
+        glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+        blendFunc[0] = srcRGB;
+        blendFunc[1] = dstRGB;
+        blendFunc[2] = srcAlpha;
+        blendFunc[3] = dstAlpha;
+    }
+
+    void RenderState::setPolygonOffset(float factor, float units) {
+        if (filter(POLYGON_OFFSET_CALL, polygonOffset[0] == factor && polygonOffset[1] == units))
+            return;
+
+        glPolygonOffset(factor, units);
+        polygonOffset[0] = factor;
+        polygonOffset[1] = units;
+    }
+
+    void RenderState::setCullFace(GLenum face) {
+        if (filter(CULL_FACE_CALL, cullFace == face))
+            return;
+
+        glCullFace(face);
+        cullFace = face;
+    }
+
+    void RenderState::setScissor(int x, int y, int width, int height) {
+        if (filter(SCISSOR_CALL, scissor[0] == x && scissor[1] == y && scissor[2] == width && scissor[3] == height))
+            return;
+
+        glScissor(x, y, width, height);
+        scissor[0] = x;
+        scissor[1] = y;
+        scissor[2] = width;
+        scissor[3] = height;
+    }
+
+    void RenderState::setViewport(int x, int y, int width, int height) {
+        if (filter(VIEWPORT_CALL, viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height))
+            return;
+
+        glViewport(x, y, width, height);
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = width;
+        viewport[3] = height;
     }
 
     void RenderState::setClearColor(float r, float g, float b, float a) {
+        if (filter(CLEAR_VALUE_CALL, clearColor[0] == r && clearColor[1] == g && clearColor[2] == b && clearColor[3] == a))
+            return;
+
         glClearColor(r, g, b, a);
+        clearColor[0] = r;
+        clearColor[1] = g;
+        clearColor[2] = b;
+        clearColor[3] = a;
+    }
+
+    void RenderState::setClearDepth(float depth) {
+        if (filter(CLEAR_VALUE_CALL, clearDepth == depth))
+            return;
+
+        glClearDepth(depth);
+        clearDepth = depth;
     }
 
     void RenderState::drawQuad() const {
-        glBindVertexArray(quadVao);
+        bindVertexArray(quadVao);
         glDrawArrays(GL_TRIANGLES, 0, 6);
     }
 
-    void RenderState::setCamera(ShaderProgram& shader, Entity& camera) {
+    void RenderState::setCamera(Entity& camera) {
         Transform& ct = camera.getComponent<Transform>();
         Camera& cam = camera.getComponent<Camera>();
 
-        setCamera(shader, ct, cam);
+        setCamera(ct, cam);
     }
 
-    void RenderState::setCamera(ShaderProgram& shader, Transform& t, Camera& cam) {
+    void RenderState::setCamera(Transform& t, Camera& cam) {
         // Set the projection matrix from the camera parameters
-        cam.loadProjectionMatrix(projMatrix);
+        Matrix4f camProjMatrix;
+        cam.loadProjectionMatrix(camProjMatrix);
 
         // Set the view matrix to the camera view
-        viewMatrix.setIdentity();
-        viewMatrix.rotate(-t.rotation);
-        viewMatrix.translate(-t.position);
+        Matrix4f camViewMatrix;
+        camViewMatrix.setIdentity();
+        camViewMatrix.rotate(-t.rotation);
+        camViewMatrix.translate(-t.position);
+
+        setCamera(camProjMatrix, camViewMatrix, t.position, cam.getZNear(), cam.getZFar());
+    }
+
+    void RenderState::setCamera(const Matrix4f& projMatrix, const Matrix4f& viewMatrix, const Vector3f& position, float zNear, float zFar) {
+        this->projMatrix = projMatrix;
+        this->viewMatrix = viewMatrix;
 
-        shader.uniform3f("camPos", t.position);
-        shader.uniformMatrix4f("projMatrix", projMatrix);
-        shader.uniformMatrix4f("viewMatrix", viewMatrix);
-        shader.uniform1f("zNear", cam.getZNear());
-        shader.uniform1f("zFar", cam.getZFar());
+        CameraUniforms uniforms;
+        memcpy(uniforms.projMatrix, projMatrix.toArray(), sizeof(uniforms.projMatrix));
+        memcpy(uniforms.viewMatrix, viewMatrix.toArray(), sizeof(uniforms.viewMatrix));
+        const Matrix4f projViewMatrix = projMatrix * viewMatrix;
+        memcpy(uniforms.projViewMatrix, projViewMatrix.toArray(), sizeof(uniforms.projViewMatrix));
+        memcpy(uniforms.invProjViewMatrix, inverse(projViewMatrix).toArray(), sizeof(uniforms.invProjViewMatrix));
+        uniforms.camPos[0] = position.x;
+        uniforms.camPos[1] = position.y;
+        uniforms.camPos[2] = position.z;
+        uniforms.zNear = zNear;
+        uniforms.zFar = zFar;
+
+        cameraBuffer.setSubData(0, sizeof(CameraUniforms), &uniforms);
+        cameraBuffer.bindBase(CAMERA_BLOCK);
+    }
+
+    void RenderState::useProgram(ShaderProgram& shader)
+    {
+        if (filter(PROGRAM_CALL, currentProgram == &shader))
+            return;
+
+        shader.bind();
+        currentProgram = &shader;
+    }
+
+    void RenderState::releaseProgram()
+    {
+        glUseProgram(0);
+        currentProgram = nullptr;
+    }
+
+    void RenderState::bindVertexArray(GLuint vao)
+    {
+        if (filter(VERTEX_ARRAY_CALL, currentVao == vao))
+            return;
+
+        glBindVertexArray(vao);
+        currentVao = vao;
+    }
+
+    GLuint RenderState::getVertexArray()
+    {
+        return currentVao;
+    }
+
+    void RenderState::bindFramebuffer(GLenum target, GLuint framebuffer)
+    {
+        bool draw = target != GL_READ_FRAMEBUFFER;
+        bool read = target != GL_DRAW_FRAMEBUFFER;
+
+        if (filter(FRAMEBUFFER_CALL, (!draw || drawFramebuffer == framebuffer) && (!read || readFramebuffer == framebuffer)))
+            return;
+
+        glBindFramebuffer(target, framebuffer);
+        if (draw)
+            drawFramebuffer = framebuffer;
+        if (read)
+            readFramebuffer = framebuffer;
+    }
+
+    GLuint RenderState::getDrawFramebuffer()
+    {
+        return drawFramebuffer;
+    }
+
+    void RenderState::releaseFramebuffer(GLuint framebuffer)
+    {
+        if (drawFramebuffer == framebuffer || readFramebuffer == framebuffer)
+            bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        drawBuffers.erase(framebuffer);
+    }
+
+    void RenderState::setDrawBuffers(GLsizei count, const GLenum* buffers)
+    {
+        std::vector<GLenum>& current = drawBuffers[drawFramebuffer];
+
+        if (filter(DRAW_BUFFER_CALL, current.size() == (size_t) count && std::equal(current.begin(), current.end(), buffers)))
+            return;
+
+        if (count == 1)
+            glDrawBuffer(buffers[0]);
+        else
+            glDrawBuffers(count, buffers);
+        current.assign(buffers, buffers + count);
     }
 
     GLuint RenderState::getActiveTexture()
@@ -93,6 +362,9 @@ namespace Flux {
 
     void RenderState::setActiveTexture(unsigned int textureUnit)
     {
+        if (filter(TEXTURE_CALL, activeTextureUnit == textureUnit))
+            return;
+
         activeTextureUnit = textureUnit;
 
         glActiveTexture(GL_TEXTURE0 + textureUnit);
@@ -100,8 +372,22 @@ namespace Flux {
 
     void RenderState::bindTexture(GLenum target, GLuint texture)
     {
+        // Unbinding is always issued, because the unit may hold a texture on a different target
+        if (filter(TEXTURE_CALL, texture != 0 && textureUnits[activeTextureUnit] == texture))
+            return;
+
         glBindTexture(target, texture);
 
         textureUnits[activeTextureUnit] = texture;
     }
+
+    const StateStats& RenderState::getStats()
+    {
+        return stats;
+    }
+
+    void RenderState::resetStats()
+    {
+        stats = StateStats();
+    }
 }
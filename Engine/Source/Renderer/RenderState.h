@@ -4,9 +4,12 @@
 #include <GDT/Matrix4f.h>
 #include <GDT/Shader.h>
 
+#include "Renderer/UniformBuffer.h"
+
 #include <glad/glad.h>
 
 #include <vector>
+#include <cstdint>
 #include <unordered_map>
 
 using GDT::Vector3f;
@@ -14,7 +17,6 @@ using GDT::Matrix4f;
 using GDT::ShaderProgram;
 
 namespace Flux {
-    class Framebuffer;
     class Shader;
     class Entity;
     class Transform;
@@ -25,10 +27,73 @@ namespace Flux {
         FACE_CULLING = GL_CULL_FACE,
         DEPTH_TEST = GL_DEPTH_TEST,
         STENCIL_TEST = GL_STENCIL_TEST,
-        POLYGON_OFFSET = GL_POLYGON_OFFSET_FILL
+        POLYGON_OFFSET = GL_POLYGON_OFFSET_FILL,
+        SCISSOR_TEST = GL_SCISSOR_TEST,
+        CLIP_DISTANCE0 = GL_CLIP_DISTANCE0,
+        CLIP_DISTANCE1 = GL_CLIP_DISTANCE1,
+        CLIP_DISTANCE2 = GL_CLIP_DISTANCE2,
+        CLIP_DISTANCE3 = GL_CLIP_DISTANCE3
+    };
+
+    /** Pipeline state a pass can require, each field is only applied when it was set */
+    enum PipelineField {
+        DEPTH_FUNC = 1 << 0,
+        DEPTH_MASK = 1 << 1,
+        COLOR_MASK = 1 << 2,
+        STENCIL_FUNC = 1 << 3,
+        STENCIL_OP = 1 << 4,
+        STENCIL_MASK = 1 << 5,
+        BLEND_FUNC = 1 << 6,
+        POLYGON_OFFSET_VALUES = 1 << 7,
+        CULL_FACE = 1 << 8
+    };
+
+    /** Kinds of state calls counted by the render state */
+    enum StateCall {
+        CAPABILITY_CALL,
+        DEPTH_CALL,
+        COLOR_MASK_CALL,
+        STENCIL_CALL,
+        BLEND_CALL,
+        POLYGON_OFFSET_CALL,
+        CULL_FACE_CALL,
+        VIEWPORT_CALL,
+        SCISSOR_CALL,
+        CLEAR_VALUE_CALL,
+        PROGRAM_CALL,
+        VERTEX_ARRAY_CALL,
+        FRAMEBUFFER_CALL,
+        DRAW_BUFFER_CALL,
+        TEXTURE_CALL,
+        STATE_CALL_COUNT
+    };
+
+    /** Number of state calls passed on to GL and filtered out as redundant during a frame */
+    struct StateStats {
+        uint32_t issued[STATE_CALL_COUNT];
+        uint32_t filtered[STATE_CALL_COUNT];
+
+        uint32_t getIssued() const {
+            uint32_t total = 0;
+            for (uint32_t count : issued)
+                total += count;
+            return total;
+        }
+
+        uint32_t getFiltered() const {
+            uint32_t total = 0;
+            for (uint32_t count : filtered)
+                total += count;
+            return total;
+        }
     };
 
-    struct CapabilitySet
+    /**
+     * Description of the fixed function state a pass requires. Capabilities
+     * and fields that are not set are left as they are, the rest is applied
+     * by RenderState::require as a diff against the current state.
+     */
+    struct PipelineState
     {
     public:
         void addCapability(Capability capability, bool enabled)
@@ -36,27 +101,124 @@ namespace Flux {
             capabilities.push_back(std::pair<Capability, bool>(capability, enabled));
         }
 
-        std::vector<std::pair<Capability, bool>> getSet()
+        void setDepthFunc(GLenum func)
         {
-            return capabilities;
+            depthFunc = func;
+            fields |= DEPTH_FUNC;
+        }
+
+        void setDepthMask(bool enabled)
+        {
+            depthMask = enabled;
+            fields |= DEPTH_MASK;
+        }
+
+        void setColorMask(bool enabled)
+        {
+            colorMask = enabled;
+            fields |= COLOR_MASK;
+        }
+
+        void setStencilFunc(GLenum func, GLint ref, GLuint mask)
+        {
+            stencilFunc = func;
+            stencilRef = ref;
+            stencilFuncMask = mask;
+            fields |= STENCIL_FUNC;
+        }
+
+        void setStencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass)
+        {
+            stencilOp[0] = stencilFail;
+            stencilOp[1] = depthFail;
+            stencilOp[2] = depthPass;
+            fields |= STENCIL_OP;
+        }
+
+        void setStencilMask(GLuint mask)
+        {
+            stencilMask = mask;
+            fields |= STENCIL_MASK;
+        }
+
+        void setBlendFunc(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha)
+        {
+            blendFunc[0] = srcRGB;
+            blendFunc[1] = dstRGB;
+            blendFunc[2] = srcAlpha;
+            blendFunc[3] = dstAlpha;
+            fields |= BLEND_FUNC;
+        }
+
+        void setPolygonOffset(float factor, float units)
+        {
+            polygonOffset[0] = factor;
+            polygonOffset[1] = units;
+            fields |= POLYGON_OFFSET_VALUES;
+        }
+
+        void setCullFace(GLenum face)
+        {
+            cullFace = face;
+            fields |= CULL_FACE;
+        }
+
+        bool has(PipelineField field) const
+        {
+            return (fields & field) != 0;
         }
 
-    private:
         std::vector<std::pair<Capability, bool>> capabilities;
+
+        unsigned int fields = 0;
+
+        GLenum depthFunc = GL_LESS;
+        bool depthMask = true;
+        bool colorMask = true;
+        GLenum stencilFunc = GL_ALWAYS;
+        GLint stencilRef = 0;
+        GLuint stencilFuncMask = 0xFF;
+        GLenum stencilOp[3] = { GL_KEEP, GL_KEEP, GL_KEEP };
+        GLuint stencilMask = 0xFF;
+        GLenum blendFunc[4] = { GL_ONE, GL_ZERO, GL_ONE, GL_ZERO };
+        float polygonOffset[2] = { 0, 0 };
+        GLenum cullFace = GL_BACK;
     };
 
+    /**
+     * Shadows the GL pipeline state and filters out calls that would not
+     * change it. All state changes of the renderer and its passes should go
+     * through here, a raw GL call leaves the cache out of date.
+     */
     class RenderState {
     public:
         RenderState();
 
-        void enable(Capability capability);
-        void disable(Capability capability);
-        void require(CapabilitySet capabilitySet);
-        void setClearColor(float r, float g, float b, float a);
+        static void enable(Capability capability);
+        static void disable(Capability capability);
+        /** Applies the fields of the pipeline state that differ from the current state */
+        static void require(const PipelineState& state);
+
+        static void setDepthFunc(GLenum func);
+        static void setDepthMask(bool enabled);
+        static void setColorMask(bool enabled);
+        static void setStencilFunc(GLenum func, GLint ref, GLuint mask);
+        static void setStencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass);
+        static void setStencilMask(GLuint mask);
+        static void setBlendFunc(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+        static void setPolygonOffset(float factor, float units);
+        static void setCullFace(GLenum face);
+        static void setViewport(int x, int y, int width, int height);
+        static void setScissor(int x, int y, int width, int height);
+        static void setClearColor(float r, float g, float b, float a);
+        static void setClearDepth(float depth);
         
         void drawQuad() const;
-        void setCamera(ShaderProgram& shader, Entity& camera);
-        void setCamera(ShaderProgram& shader, Transform& t, Camera& cam);
+        /** Uploads the camera parameters to the camera block shared by all shader programs */
+        void setCamera(Entity& camera);
+        void setCamera(Transform& t, Camera& cam);
+        /** Sets matrices that were not derived from a camera component, such as fitted shadow views */
+        void setCamera(const Matrix4f& projMatrix, const Matrix4f& viewMatrix, const Vector3f& position, float zNear, float zFar);
 
         Matrix4f projMatrix;
         Matrix4f viewMatrix;
@@ -64,19 +226,62 @@ namespace Flux {
 
         static GLuint quadVao;
 
-        static const Framebuffer* currentFramebuffer;
+        /** Binds the shader program unless it is already in use */
+        static void useProgram(ShaderProgram& shader);
+        /** Unbinds the current program, must be called before a bound program is destroyed */
+        static void releaseProgram();
+        static void bindVertexArray(GLuint vao);
+        static GLuint getVertexArray();
+        /** Binds the framebuffer handle to GL_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER */
+        static void bindFramebuffer(GLenum target, GLuint framebuffer);
+        static GLuint getDrawFramebuffer();
+        /** Drops the cached state of a framebuffer that is about to be deleted */
+        static void releaseFramebuffer(GLuint framebuffer);
+        /** Sets the draw buffers of the bound draw framebuffer */
+        static void setDrawBuffers(GLsizei count, const GLenum* buffers);
 
         static GLuint getActiveTexture();
         static void setActiveTexture(unsigned int textureUnit);
         static void bindTexture(GLenum target, GLuint texture);
 
         static std::vector<unsigned int> textureUnits;
+
+        /** Call counters since the last call to resetStats */
+        static const StateStats& getStats();
+        static void resetStats();
         
     private:
-        Vector3f clearColor;
+        static bool filter(StateCall call, bool redundant);
+
+        UniformBuffer cameraBuffer;
+
+        // Shadowed pipeline state, there is only a single GL context
+        static std::unordered_map<Capability, bool> capabilityMap;
+        static GLenum depthFunc;
+        static bool depthMask;
+        static bool colorMask;
+        static GLenum stencilFunc;
+        static GLint stencilRef;
+        static GLuint stencilFuncMask;
+        static GLenum stencilOp[3];
+        static GLuint stencilMask;
+        static GLenum blendFunc[4];
+        static float polygonOffset[2];
+        static GLenum cullFace;
+        static int viewport[4];
+        static int scissor[4];
+        static float clearColor[4];
+        static float clearDepth;
 
         static unsigned int activeTextureUnit;
 
-        std::unordered_map<Capability, bool> capabilityMap;
+        static const ShaderProgram* currentProgram;
+        static GLuint currentVao;
+        static GLuint drawFramebuffer;
+        static GLuint readFramebuffer;
+        // Draw buffers last set on every framebuffer, indexed by handle
+        static std::unordered_map<GLuint, std::vector<GLenum>> drawBuffers;
+
+        static StateStats stats;
     };
 }
@@ -0,0 +1,93 @@
+#include "Renderer/RenderTargetPool.h"
+
+#include "TextureUnit.h"
+
+#include <algorithm>
+
+namespace Flux {
+    void RenderTargetPool::reset() {
+        for (const std::unique_ptr<RenderTarget>& target : targets) {
+            target->acquired = false;
+            target->used = false;
+        }
+    }
+
+    RenderTarget* RenderTargetPool::acquire(const RenderTargetDesc& desc) {
+        for (const std::unique_ptr<RenderTarget>& target : targets) {
+            if (!target->acquired && target->desc == desc) {
+                target->acquired = true;
+                target->used = true;
+                return target.get();
+            }
+        }
+
+        targets.push_back(std::make_unique<RenderTarget>());
+        RenderTarget& target = *targets.back();
+        target.desc = desc;
+        target.acquired = true;
+        target.used = true;
+        create(target);
+
+        return &target;
+    }
+
+    void RenderTargetPool::release(RenderTarget* target) {
+        target->acquired = false;
+    }
+
+    void RenderTargetPool::trim() {
+        for (const std::unique_ptr<RenderTarget>& target : targets) {
+            if (!target->used) {
+                destroy(*target);
+            }
+        }
+        targets.erase(std::remove_if(targets.begin(), targets.end(), [](const std::unique_ptr<RenderTarget>& target) {
+            return !target->used;
+        }), targets.end());
+    }
+
+    void RenderTargetPool::destroy() {
+        for (const std::unique_ptr<RenderTarget>& target : targets) {
+            destroy(*target);
+        }
+        targets.clear();
+    }
+
+    void RenderTargetPool::create(RenderTarget& target) {
+        const RenderTargetDesc& desc = target.desc;
+        const GLenum type = desc.internalFormat == GL_RGBA8 ? GL_UNSIGNED_BYTE : GL_FLOAT;
+
+        Texture2D& texture = target.texture;
+        texture.create();
+        texture.bind(TextureUnit::TEXTURE0);
+        texture.setData(desc.width, desc.height, desc.internalFormat, GL_RGBA, type, nullptr);
+        for (unsigned int level = 1; level < desc.levels; level++) {
+            glTexImage2D(GL_TEXTURE_2D, level, desc.internalFormat, std::max(desc.width >> level, 1u), std::max(desc.height >> level, 1u), 0, GL_RGBA, type, nullptr);
+        }
+        texture.setWrapping(CLAMP, CLAMP);
+        texture.setSampling(desc.sampling, desc.sampling, desc.levels > 1 ? NEAREST : NONE);
+        texture.setMaxMipmapLevel(desc.levels - 1);
+        texture.release();
+
+        target.levels.resize(desc.levels);
+        for (unsigned int level = 0; level < desc.levels; level++) {
+            Framebuffer& framebuffer = target.levels[level];
+            framebuffer.create();
+            framebuffer.bind();
+            framebuffer.addColorTexture(0, texture, level);
+            if (level == 0 && desc.depthStencil != 0) {
+                glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, desc.depthStencil, 0);
+            }
+            framebuffer.validate();
+            framebuffer.release();
+        }
+    }
+
+    void RenderTargetPool::destroy(RenderTarget& target) {
+        for (Framebuffer& framebuffer : target.levels) {
+            framebuffer.destroy();
+        }
+        target.levels.clear();
+        target.texture.destroy();
+    }
+}
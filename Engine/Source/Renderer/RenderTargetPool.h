@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Framebuffer.h"
+#include "Texture.h"
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <memory>
+
+namespace Flux {
+    /** Size and format of a transient render target, targets with equal descriptions are interchangeable */
+    struct RenderTargetDesc {
+        RenderTargetDesc() : RenderTargetDesc(1, 1, GL_RGBA16F) { }
+
+        RenderTargetDesc(unsigned int width, unsigned int height, GLint internalFormat, Sampling sampling = LINEAR, unsigned int levels = 1, GLuint depthStencil = 0)
+            : width(width), height(height), internalFormat(internalFormat), sampling(sampling), levels(levels), depthStencil(depthStencil) { }
+
+        bool operator==(const RenderTargetDesc& desc) const {
+            return width == desc.width && height == desc.height && internalFormat == desc.internalFormat
+                && sampling == desc.sampling && levels == desc.levels && depthStencil == desc.depthStencil;
+        }
+
+        unsigned int width;
+        unsigned int height;
+        GLint internalFormat;
+        Sampling sampling;
+        unsigned int levels;
+        // Handle of a depth stencil texture attached to the first level, 0 for none
+        GLuint depthStencil;
+    };
+
+    /** Texture owned by the pool with a framebuffer rendering into each of its mip levels */
+    class RenderTarget {
+    public:
+        const RenderTargetDesc& getDesc() const {
+            return desc;
+        }
+
+        Texture2D& getTexture() {
+            return texture;
+        }
+
+        const Texture2D& getTexture() const {
+            return texture;
+        }
+
+        const Framebuffer& getFramebuffer(unsigned int level = 0) const {
+            return levels[level];
+        }
+
+    private:
+        friend class RenderTargetPool;
+
+        RenderTargetDesc desc;
+        Texture2D texture;
+        std::vector<Framebuffer> levels;
+
+        bool acquired = false;
+        // Whether the target was acquired since the pool was last reset
+        bool used = false;
+    };
+
+    /**
+     * Keeps the render targets of the passes, so that a target released by one
+     * pass can be handed to a later pass asking for the same description.
+     */
+    class RenderTargetPool {
+    public:
+        /** Releases every target, targets not acquired again before the next trim are destroyed */
+        void reset();
+
+        /** Returns a released target with the given description, or creates one if there is none */
+        RenderTarget* acquire(const RenderTargetDesc& desc);
+
+        void release(RenderTarget* target);
+
+        /** Destroys the targets that were not acquired since the last reset */
+        void trim();
+
+        void destroy();
+
+        size_t getTargetCount() const {
+            return targets.size();
+        }
+
+    private:
+        void create(RenderTarget& target);
+        void destroy(RenderTarget& target);
+
+        std::vector<std::unique_ptr<RenderTarget>> targets;
+    };
+}
@@ -21,14 +21,15 @@ namespace Flux {
     const unsigned int NOISE_SIZE = 4;
 
     namespace {
+        /** Occlusion and view depth, the history also keeps the encoded normal for rejecting stale samples */
         Texture2D createRenderTexture(const Size& windowSize)
         {
             Texture2D renderTexture;
             renderTexture.create();
             renderTexture.bind(TextureUnit::TEXTURE0);
-            renderTexture.setData(windowSize.width / 2, windowSize.height / 2, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            renderTexture.setData(windowSize.width / 2, windowSize.height / 2, GL_RGBA16F, GL_RGBA, GL_FLOAT, nullptr);
             renderTexture.setWrapping(CLAMP, CLAMP);
-            renderTexture.setSampling(LINEAR, LINEAR);
+            renderTexture.setSampling(NEAREST, NEAREST);
             renderTexture.release();
             return renderTexture;
         }
@@ -105,17 +106,19 @@ namespace Flux {
     SSAOPass::SSAOPass() : RenderPhase("SSAO"), windowSize(1, 1)
     {
         ssaoShader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/SSAO.frag");
-        blurShader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/SSAOBlur.frag");
+        temporalShader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/SSAOTemporal.frag");
+        upsampleShader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/SSAOUpsample.frag");
 
         generate();
 
         requiredSet.addCapability(STENCIL_TEST, true);
         requiredSet.addCapability(DEPTH_TEST, false);
+        requiredSet.setStencilFunc(GL_EQUAL, 1, 0xFF);
     }
 
     void SSAOPass::generate()
     {
-        kernel = GenerateKernelGGX(32);
+        kernel = GenerateKernelGGX(KERNEL_SIZE);
 
         // Generate a noise texture
         noise.reserve(NOISE_SIZE*NOISE_SIZE);
@@ -142,12 +145,25 @@ namespace Flux {
     {
         this->windowSize = windowSize;
 
+        // The history is kept between frames, so the pass owns its targets instead of taking them from the graph
+        if (buffer.getColorTexture(0).isCreated()) {
+            for (int i = 0; i < 3; i++) {
+                Texture2D texture = buffer.getColorTexture(i);
+                texture.destroy();
+            }
+            buffer.destroy();
+            buffer = Framebuffer();
+        }
+
         buffer.create();
         buffer.bind();
         buffer.addColorTexture(0, createRenderTexture(windowSize));
         buffer.addColorTexture(1, createRenderTexture(windowSize));
+        buffer.addColorTexture(2, createRenderTexture(windowSize));
         buffer.validate();
         buffer.release();
+
+        historyValid = false;
     }
 
     void SSAOPass::render(RenderState& renderState, const Scene& scene)
@@ -156,8 +172,7 @@ namespace Flux {
 
         nvtxRangePushA(getPassName().c_str());
 
-        const Framebuffer* sourceFramebuffer = RenderState::currentFramebuffer;
-        ssaoShader.bind();
+        RenderState::useProgram(ssaoShader);
 
         ///
         Entity* camera = scene.getMainCamera();
@@ -174,54 +189,85 @@ namespace Flux {
         viewMatrix.rotate(-ct.rotation);
         viewMatrix.translate(-ct.position);
 
+        const Matrix4f projViewMatrix = projMatrix * viewMatrix;
+        const Matrix4f invProjViewMatrix = inverse(projViewMatrix);
+
         ssaoShader.uniform3f("camPos", ct.position);
         ssaoShader.uniformMatrix4f("projMatrix", projMatrix);
         ssaoShader.uniformMatrix4f("viewMatrix", viewMatrix);
+        ssaoShader.uniformMatrix4f("invProjViewMatrix", invProjViewMatrix);
         ///
 
         gBuffer->normalTex.bind(TextureUnit::NORMAL);
         ssaoShader.uniform1i("normalMap", TextureUnit::NORMAL);
-        gBuffer->positionTex.bind(TextureUnit::POSITION);
-        ssaoShader.uniform1i("positionMap", TextureUnit::POSITION);
         gBuffer->depthTex.bind(TextureUnit::DEPTH);
         ssaoShader.uniform1i("depthMap", TextureUnit::DEPTH);
 
+        // Every frame takes an interleaved subset of the kernel and turns the noise a bit further
+        const unsigned int stride = KERNEL_SIZE / sampleCount;
         noiseTexture.bind(TextureUnit::NOISE);
         ssaoShader.uniform1i("noiseMap", TextureUnit::NOISE);
         ssaoShader.uniform3fv("kernel", (int)kernel.size(), kernel.data());
-        ssaoShader.uniform1i("kernelSize", (int)kernel.size());
+        ssaoShader.uniform1i("sampleCount", (int)sampleCount);
+        ssaoShader.uniform1i("sampleOffset", (int)(frameIndex % stride));
+        ssaoShader.uniform1i("sampleStride", (int)stride);
+        ssaoShader.uniform1f("noiseRotation", frameIndex * 2.39996323f);
 
         ssaoShader.uniform2i("windowSize", windowSize.width / 2, windowSize.height / 2);
 
         buffer.bind();
         buffer.setDrawBuffer(0);
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        renderState.setClearColor(1.0f, 1.0f, 1.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
-        glStencilFunc(GL_EQUAL, 1, 0xFF);
-        glViewport(0, 0, windowSize.width / 2, windowSize.height / 2);
+        renderState.setViewport(0, 0, windowSize.width / 2, windowSize.height / 2);
         renderState.drawQuad();
 
-        // Blur
-        nvtxRangePushA("SSAO Blur");
-        blurShader.bind();
-        blurShader.uniform2i("windowSize", windowSize.width, windowSize.height);
-
-        buffer.getTexture().bind(TextureUnit::TEXTURE);
-        blurShader.uniform1i("tex", TextureUnit::TEXTURE);
-
-        buffer.setDrawBuffer(1);
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        // Accumulate
+        nvtxRangePushA("SSAO Temporal");
+        const unsigned int history = 1 + historyIndex;
+        historyIndex = 1 - historyIndex;
+        const unsigned int historyTarget = 1 + historyIndex;
+
+        RenderState::useProgram(temporalShader);
+        temporalShader.uniformMatrix4f("invProjViewMatrix", invProjViewMatrix);
+        temporalShader.uniformMatrix4f("prevViewMatrix", prevViewMatrix);
+        temporalShader.uniformMatrix4f("prevProjViewMatrix", prevProjViewMatrix);
+        temporalShader.uniform1i("historyValid", historyValid);
+        temporalShader.uniform1f("feedback", feedback);
+
+        buffer.getColorTexture(0).bind(TextureUnit::TEXTURE0);
+        temporalShader.uniform1i("aoMap", TextureUnit::TEXTURE0);
+        buffer.getColorTexture(history).bind(TextureUnit::TEXTURE1);
+        temporalShader.uniform1i("historyMap", TextureUnit::TEXTURE1);
+        temporalShader.uniform1i("normalMap", TextureUnit::NORMAL);
+        temporalShader.uniform1i("depthMap", TextureUnit::DEPTH);
+
+        buffer.setDrawBuffer(historyTarget);
         glClear(GL_COLOR_BUFFER_BIT);
         renderState.drawQuad();
         nvtxRangePop();
 
-        // Multiply
-        sourceFramebuffer->bind();
-        glViewport(0, 0, windowSize.width, windowSize.height);
+        prevViewMatrix = viewMatrix;
+        prevProjViewMatrix = projViewMatrix;
+        historyValid = true;
+        frameIndex++;
+
+        // Upsample and multiply
+        nvtxRangePushA("SSAO Upsample");
+        target->bind();
+        renderState.setViewport(0, 0, windowSize.width, windowSize.height);
+
+        RenderState::useProgram(upsampleShader);
+        upsampleShader.uniformMatrix4f("invProjMatrix", inverse(projMatrix));
 
-        std::vector<Texture2D> sources{ *source, buffer.getTexture() };
-        multiplyPass.SetTextures(sources);
-        multiplyPass.render(renderState, scene);
+        source->bind(TextureUnit::TEXTURE0);
+        upsampleShader.uniform1i("sourceTex", TextureUnit::TEXTURE0);
+        buffer.getColorTexture(historyTarget).bind(TextureUnit::TEXTURE1);
+        upsampleShader.uniform1i("aoMap", TextureUnit::TEXTURE1);
+        upsampleShader.uniform1i("depthMap", TextureUnit::DEPTH);
+
+        renderState.drawQuad();
+        nvtxRangePop();
 
         nvtxRangePop();
     }
@@ -1,10 +1,11 @@
 #pragma once
 
 #include "RenderPhase.h"
-#include "MultiplyPass.h"
 
 #include "Renderer/GBuffer.h"
 
+#include <GDT/Matrix4f.h>
+
 #include <memory>
 
 namespace Flux
@@ -12,6 +13,12 @@ namespace Flux
     class Texture2D;
     class Size;
 
+    /**
+     * Ambient occlusion at half resolution, accumulated over frames. Every frame
+     * evaluates a rotating subset of the kernel, which is blended with the
+     * reprojected result of earlier frames wherever depth and normal show the
+     * same surface. A depth-aware upsample applies it to the full resolution image.
+     */
     class SSAOPass : public RenderPhase
     {
     public:
@@ -25,17 +32,39 @@ namespace Flux
 
         void render(RenderState& renderState, const Scene& scene) override;
 
+        /** Number of kernel samples evaluated per frame, must divide the kernel size */
+        void setSampleCount(unsigned int count) {
+            sampleCount = count;
+        }
+
+        /** Weight of the accumulated history against the samples of the current frame */
+        void setFeedback(float feedback) {
+            this->feedback = feedback;
+        }
+
+        static const unsigned int KERNEL_SIZE = 32;
+
     private:
         ShaderProgram ssaoShader;
-        ShaderProgram blurShader;
-
-        MultiplyPass multiplyPass;
+        ShaderProgram temporalShader;
+        ShaderProgram upsampleShader;
 
         Size windowSize;
 
         const GBuffer* gBuffer;
 
+        // Occlusion of the current frame followed by two history targets used in turns
         Framebuffer buffer;
+        unsigned int historyIndex = 0;
+        bool historyValid = false;
+
+        unsigned int frameIndex = 0;
+        unsigned int sampleCount = 8;
+        float feedback = 0.9f;
+
+        // Camera of the frame the history was rendered with
+        Matrix4f prevViewMatrix;
+        Matrix4f prevProjViewMatrix;
 
         std::vector<Vector3f> kernel;
         std::vector<Vector3f> noise;
@@ -0,0 +1,241 @@
+#include "Renderer/ShadowAtlas.h"
+
+#include "Scene.h"
+#include "Camera.h"
+#include "PointLight.h"
+#include "DirectionalLight.h"
+#include "TextureFactory.h"
+#include "Util/Math.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Flux {
+    namespace
+    {
+        /** Rounds the size up to a power of two, but keeps the previous size while the request stays close to it */
+        unsigned int quantize(float size, unsigned int previous, unsigned int maxSize)
+        {
+            // Without the margin a light at the boundary of two sizes would repack the atlas every frame
+            if (previous != 0 && size > previous * 0.6f && size < previous * 1.5f)
+                return std::min(previous, maxSize);
+
+            unsigned int tileSize = ShadowAtlas::MIN_TILE_SIZE;
+            while (tileSize < size && tileSize < maxSize) {
+                tileSize *= 2;
+            }
+            return tileSize;
+        }
+
+        /** Gathers the even bits of a Morton code into one coordinate */
+        unsigned int compactBits(unsigned int code)
+        {
+            code &= 0x55555555;
+            code = (code | (code >> 1)) & 0x33333333;
+            code = (code | (code >> 2)) & 0x0F0F0F0F;
+            code = (code | (code >> 4)) & 0x00FF00FF;
+            code = (code | (code >> 8)) & 0x0000FFFF;
+            return code;
+        }
+    }
+
+    void ShadowAtlas::create(size_t budget, bool staticLayer) {
+        GLint maxTextureSize;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+
+        // The atlas is one or two squares wide, the static layer doubles the memory of every texel
+        const size_t texels = budget / (sizeof(float) * (staticLayer ? 2 : 1));
+        height = MIN_TILE_SIZE;
+        while ((size_t) height * height * 4 <= texels && height * 2 <= (unsigned int) maxTextureSize) {
+            height *= 2;
+        }
+        width = ((size_t) height * height * 2 <= texels && height * 2 <= (unsigned int) maxTextureSize) ? height * 2 : height;
+
+        buffer.create();
+        buffer.bind();
+        buffer.disableColor();
+        texture = createShadowMap(width, height);
+        buffer.addDepthTexture(texture);
+        buffer.release();
+
+        hasStaticLayer = staticLayer;
+        if (hasStaticLayer) {
+            staticBuffer.create();
+            staticBuffer.bind();
+            staticBuffer.disableColor();
+            staticTexture = createShadowMap(width, height);
+            staticBuffer.addDepthTexture(staticTexture);
+            staticBuffer.release();
+        }
+
+        tileBuffer.create(GL_RGBA32F);
+        packing.clear();
+    }
+
+    void ShadowAtlas::destroy() {
+        buffer.destroy();
+        texture.destroy();
+        if (hasStaticLayer) {
+            staticBuffer.destroy();
+            staticTexture.destroy();
+        }
+        tileBuffer.destroy();
+        packing.clear();
+    }
+
+    bool ShadowAtlas::update(const Scene& scene, const Camera& camera, const Vector3f& cameraPosition, unsigned int screenHeight) {
+        requests.clear();
+
+        // Pixels covered by a unit length at unit distance from the camera
+        const float pixelScale = camera.isPerspective()
+            ? screenHeight / (2 * std::tan(Math::toRadians(camera.getFovy()) / 2))
+            : screenHeight / (camera.getTop() - camera.getBottom());
+
+        scene.view<PointLight>().each([&](uint32_t entity, PointLight& pointLight) {
+            if (!pointLight.castShadows) {
+                pointLight.shadowSlot = -1;
+                return;
+            }
+
+            const Matrix4f& worldMatrix = scene.getWorldMatrix(entity);
+            const Vector3f offset(worldMatrix[12] - cameraPosition.x, worldMatrix[13] - cameraPosition.y, worldMatrix[14] - cameraPosition.z);
+            const float distance = camera.isPerspective() ? std::max(offset.length(), 1.0f) : 1;
+
+            // A face spans half the diameter of the light on screen
+            const float size = pointLight.getRadius() * pixelScale / distance * pointLight.shadowImportance;
+            const unsigned int tileSize = quantize(size, pointLight.shadowTiles[0].requestedSize, std::min(MAX_POINT_TILE_SIZE, height));
+
+            requests.push_back({ pointLight.shadowTiles, 6, pointLight.shadowImportance, tileSize, &pointLight.shadowSlot });
+        });
+
+        scene.view<DirectionalLight>().each([&](uint32_t, DirectionalLight& dirLight) {
+            for (unsigned int i = 0; i < dirLight.cascadeCount; i++) {
+                ShadowCascade& cascade = dirLight.cascades[i];
+
+                const float size = cascade.resolution * dirLight.shadowImportance;
+                const unsigned int tileSize = quantize(size, cascade.tile.requestedSize, std::min(MAX_TILE_SIZE, height));
+
+                requests.push_back({ &cascade.tile, 1, dirLight.shadowImportance, tileSize, nullptr });
+            }
+        });
+
+        for (Request& request : requests) {
+            for (unsigned int i = 0; i < request.tileCount; i++) {
+                request.tiles[i].requestedSize = request.size;
+            }
+        }
+
+        fitBudget();
+
+        if (!pack())
+            return false;
+
+        uploadTiles();
+        return true;
+    }
+
+    void ShadowAtlas::fitBudget() {
+        const size_t capacity = (size_t) width * height;
+
+        size_t area = 0;
+        for (const Request& request : requests) {
+            area += (size_t) request.tileCount * request.size * request.size;
+        }
+
+        while (area > capacity) {
+            unsigned int largest = 0;
+            for (const Request& request : requests) {
+                largest = std::max(largest, request.size);
+            }
+
+            if (largest > MIN_TILE_SIZE) {
+                for (Request& request : requests) {
+                    if (request.size != largest)
+                        continue;
+                    area -= (size_t) request.tileCount * (largest * largest - largest * largest / 4);
+                    request.size /= 2;
+                }
+                continue;
+            }
+
+            // Every tile is at the minimum size, give up the shadows of the least important light
+            Request* leastImportant = nullptr;
+            for (Request& request : requests) {
+                if (request.size != 0 && (!leastImportant || request.importance < leastImportant->importance)) {
+                    leastImportant = &request;
+                }
+            }
+            area -= (size_t) leastImportant->tileCount * leastImportant->size * leastImportant->size;
+            leastImportant->size = 0;
+        }
+    }
+
+    bool ShadowAtlas::pack() {
+        nextPacking.clear();
+        for (const Request& request : requests) {
+            for (unsigned int i = 0; i < request.tileCount; i++) {
+                nextPacking.emplace_back(&request.tiles[i], request.size);
+            }
+        }
+
+        if (nextPacking == packing)
+            return false;
+        packing = nextPacking;
+
+        // Placing the largest tiles first along a Z-order curve leaves no gaps between power of two tiles
+        std::stable_sort(nextPacking.begin(), nextPacking.end(), [](const std::pair<ShadowTile*, unsigned int>& a, const std::pair<ShadowTile*, unsigned int>& b) {
+            return a.second > b.second;
+        });
+
+        const unsigned int cellsPerSquare = (height / MIN_TILE_SIZE) * (height / MIN_TILE_SIZE);
+        unsigned int cursor = 0;
+        for (const std::pair<ShadowTile*, unsigned int>& entry : nextPacking) {
+            ShadowTile& tile = *entry.first;
+            tile.size = entry.second;
+            if (tile.size == 0)
+                continue;
+
+            const unsigned int square = cursor / cellsPerSquare;
+            const unsigned int cell = cursor % cellsPerSquare;
+            tile.x = square * height + compactBits(cell) * MIN_TILE_SIZE;
+            tile.y = compactBits(cell >> 1) * MIN_TILE_SIZE;
+
+            cursor += (tile.size / MIN_TILE_SIZE) * (tile.size / MIN_TILE_SIZE);
+        }
+        return true;
+    }
+
+    void ShadowAtlas::uploadTiles() {
+        tileData.clear();
+
+        int slot = 0;
+        for (const Request& request : requests) {
+            if (!request.shadowSlot)
+                continue;
+
+            // Lights dropped from the atlas are lit without shadows
+            *request.shadowSlot = request.size != 0 ? slot++ : -1;
+            if (request.size == 0)
+                continue;
+
+            for (unsigned int i = 0; i < request.tileCount; i++) {
+                const ShadowTile& tile = request.tiles[i];
+                tileData.insert(tileData.end(), {
+                    (float) tile.x / width, (float) tile.y / height,
+                    (float) tile.size / width, (float) tile.size / height
+                });
+            }
+        }
+
+        tileBuffer.setData(tileData.size() * sizeof(float), tileData.data());
+    }
+
+    void ShadowAtlas::getTileTransform(const ShadowTile& tile, float transform[4]) const {
+        transform[0] = (float) tile.size / width;
+        transform[1] = (float) tile.size / height;
+        transform[2] = (2.0f * tile.x + tile.size) / width - 1;
+        transform[3] = (2.0f * tile.y + tile.size) / height - 1;
+    }
+}
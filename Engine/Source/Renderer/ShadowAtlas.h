@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Renderer/ShadowCache.h"
+#include "Renderer/TextureBuffer.h"
+
+#include "Framebuffer.h"
+#include "Texture.h"
+
+#include <GDT/Vector3f.h>
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+using GDT::Vector3f;
+
+namespace Flux {
+    class Scene;
+    class Camera;
+
+    /**
+     * Single depth texture holding the shadow views of all lights. Every view
+     * gets a square tile sized by how large its light appears on screen and how
+     * important the light was marked, the cascades of directional lights keep
+     * their configured resolution. When all tiles do not fit the atlas the
+     * largest ones are halved first, and the least important views are dropped
+     * once every tile is at the minimum size.
+     *
+     * Tiles are only moved when the set of lights or one of their sizes
+     * changes, so cached shadow views stay valid while nothing changes.
+     */
+    class ShadowAtlas {
+    public:
+        /** Creates the largest atlas whose depth fits the memory budget in bytes, shared with the static layer if there is one */
+        void create(size_t budget, bool staticLayer);
+        void destroy();
+
+        /** Sizes the tiles of all shadowed lights for the given view, returns true if the tiles were repacked */
+        bool update(const Scene& scene, const Camera& camera, const Vector3f& cameraPosition, unsigned int screenHeight);
+
+        /** Transforms clip space of a view into the region of its tile, as a scale and offset of x and y */
+        void getTileTransform(const ShadowTile& tile, float transform[4]) const;
+
+        const Texture2D& getTexture() const {
+            return texture;
+        }
+
+        const Framebuffer& getBuffer() const {
+            return buffer;
+        }
+
+        /** Depth of the static casters only, or nullptr if they are not cached separately */
+        const Framebuffer* getStaticBuffer() const {
+            return hasStaticLayer ? &staticBuffer : nullptr;
+        }
+
+        unsigned int getWidth() const {
+            return width;
+        }
+
+        unsigned int getHeight() const {
+            return height;
+        }
+
+        /** Binds the tiles of all point light faces, six per shadow slot, as offset and size in texture coordinates */
+        void bindTiles(unsigned int textureUnit) const {
+            tileBuffer.bind(textureUnit);
+        }
+
+        static const unsigned int MIN_TILE_SIZE = 64;
+        static const unsigned int MAX_POINT_TILE_SIZE = 1024;
+        static const unsigned int MAX_TILE_SIZE = 4096;
+
+    private:
+        /** Tiles of one light that always share the same size */
+        struct Request {
+            ShadowTile* tiles;
+            unsigned int tileCount;
+            float importance;
+            unsigned int size;
+            // Slot of a point light in the tile buffer, nullptr for cascades
+            int* shadowSlot;
+        };
+
+        void fitBudget();
+        bool pack();
+        void uploadTiles();
+
+        Texture2D texture;
+        Framebuffer buffer;
+
+        bool hasStaticLayer = false;
+        Texture2D staticTexture;
+        Framebuffer staticBuffer;
+
+        unsigned int width = 0;
+        unsigned int height = 0;
+
+        std::vector<Request> requests;
+        // Tiles and sizes of the last packing, compared to detect changes
+        std::vector<std::pair<ShadowTile*, unsigned int>> packing;
+        std::vector<std::pair<ShadowTile*, unsigned int>> nextPacking;
+
+        TextureBuffer tileBuffer;
+        std::vector<float> tileData;
+    };
+}
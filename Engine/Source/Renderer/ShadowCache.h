@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace Flux {
+    /** Hashes the light transform and the casters of a shadow view into a single value */
+    class ShadowSignature {
+    public:
+        void add(const void* data, size_t size) {
+            const unsigned char* bytes = (const unsigned char*) data;
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        }
+
+        template <class T>
+        void add(const T& value) {
+            add(&value, sizeof(T));
+        }
+
+        uint64_t get() const {
+            return hash;
+        }
+
+    private:
+        // 64 bit FNV-1a offset basis
+        uint64_t hash = 14695981039346656037ull;
+    };
+
+    /**
+     * Signatures of the casters that were last rendered into a shadow view.
+     * A view only has to be rendered again when the light or one of the
+     * casters it sees has changed since then. Static casters can be kept in
+     * a separate depth layer, so that moving casters only redraw themselves.
+     */
+    struct ShadowCache {
+        void invalidate() {
+            staticSignature = 0;
+            dynamicSignature = 0;
+        }
+
+        uint64_t staticSignature = 0;
+        uint64_t dynamicSignature = 0;
+    };
+
+    /** Square region of the shadow atlas holding one shadow view, a size of zero means the view got no space */
+    struct ShadowTile {
+        unsigned int x = 0;
+        unsigned int y = 0;
+        unsigned int size = 0;
+        // Resolution the view asked for before the atlas budget was applied
+        unsigned int requestedSize = 0;
+    };
+}
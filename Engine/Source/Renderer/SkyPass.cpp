@@ -19,6 +19,7 @@ namespace Flux {
 
         requiredSet.addCapability(STENCIL_TEST, true);
         requiredSet.addCapability(DEPTH_TEST, false);
+        requiredSet.setStencilFunc(GL_EQUAL, 0, 0xFF);
     }
 
     void SkyPass::Resize(const Size& windowSize)
@@ -30,8 +31,6 @@ namespace Flux {
     {
         renderState.require(requiredSet);
 
-        glStencilFunc(GL_EQUAL, 0, 0xFF);
-
         Transform& transform = scene.mainCamera->getComponent<Transform>();
         Camera& cam = scene.mainCamera->getComponent<Camera>();
 
@@ -49,22 +48,24 @@ namespace Flux {
         cameraBasis[10] = -1;
         cameraBasis = yawMatrix * pitchMatrix * cameraBasis;
 
-        ShaderProgram& shader = skyShader;
-        if (scene.skybox) { shader = skyboxShader; }
-        else if (scene.skySphere) { shader = skysphereShader; }
+        // Select by pointer, assigning to a reference would overwrite the sky shader
+        ShaderProgram* selected = &skyShader;
+        if (scene.skybox) { selected = &skyboxShader; }
+        else if (scene.skySphere) { selected = &skysphereShader; }
+        ShaderProgram& shader = *selected;
 
         if (scene.skybox) {
-            shader.bind();
+            RenderState::useProgram(shader);
             scene.skybox->bind(TextureUnit::TEXTURE);
             shader.uniform1i("skybox", TextureUnit::TEXTURE);
         }
         else if (scene.skySphere) {
-            shader.bind();
+            RenderState::useProgram(shader);
             scene.skySphere->bind(TextureUnit::TEXTURE);
             shader.uniform1i("tex", TextureUnit::TEXTURE);
         }
         else {
-            shader.bind();
+            RenderState::useProgram(shader);
 
             for (Entity* entity : scene.lights) {
                 if (entity->hasComponent<DirectionalLight>()) {
@@ -79,21 +80,21 @@ namespace Flux {
 
         nvtxRangePushA(getPassName().c_str());
 
-        glDepthMask(GL_TRUE);
+        renderState.setDepthMask(true);
         shader.uniform2f("persp", 1.0f / projMatrix.toArray()[0], 1.0f / projMatrix.toArray()[5]);
         shader.uniformMatrix4f("cameraBasis", cameraBasis);
 
-        glDepthFunc(GL_LEQUAL);
+        renderState.setDepthFunc(GL_LEQUAL);
         renderState.drawQuad();
-        glDepthFunc(GL_LESS);
+        renderState.setDepthFunc(GL_LESS);
 
-        glDepthMask(GL_FALSE);
+        renderState.setDepthMask(false);
 
 
         // Draw source
-        glStencilFunc(GL_EQUAL, 1, 0xFF);
+        renderState.setStencilFunc(GL_EQUAL, 1, 0xFF);
 
-        texShader.bind();
+        RenderState::useProgram(texShader);
 
         source->bind(TextureUnit::TEXTURE0);
         texShader.uniform1i("tex", TextureUnit::TEXTURE0);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Renderer/RenderState.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+namespace Flux {
+    /**
+     * Buffer object exposed to shaders as a samplerBuffer, used to pass
+     * arrays that are too large or too irregular for a uniform block.
+     */
+    class TextureBuffer {
+    public:
+        TextureBuffer() :
+            buffer(0),
+            texture(0)
+        {
+
+        }
+
+        /** Creates the buffer and a texture viewing it with the given internal format */
+        void create(GLenum format) {
+            glGenBuffers(1, &buffer);
+            glGenTextures(1, &texture);
+
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            RenderState::bindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        void destroy() {
+            // Deleting a texture unbinds it from every unit
+            std::replace(RenderState::textureUnits.begin(), RenderState::textureUnits.end(), texture, 0u);
+            glDeleteTextures(1, &texture);
+            glDeleteBuffers(1, &buffer);
+            texture = 0;
+            buffer = 0;
+        }
+
+        bool isCreated() const {
+            return buffer != 0;
+        }
+
+        /** Replaces the contents of the buffer, orphaning the previous storage */
+        void setData(GLsizeiptr size, const void* data) {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        void bind(unsigned int textureUnit) const {
+            RenderState::setActiveTexture(textureUnit);
+            RenderState::bindTexture(GL_TEXTURE_BUFFER, texture);
+        }
+
+    private:
+        GLuint buffer;
+        GLuint texture;
+    };
+}
@@ -9,7 +9,10 @@
 namespace Flux {
     TonemapPass::TonemapPass() : RenderPhase("Tonemap")
     {
-        shader.loadFromFile("res/Shaders/Quad.vert", "res/Shaders/Tonemap.frag");
+        shader.addShader(GDT::VERTEX, "res/Shaders/Quad.vert");
+        shader.addShader(GDT::FRAGMENT, "res/Shaders/Tonemap.frag");
+        shader.addShader(GDT::FRAGMENT, getStageSource());
+        shader.build();
 
         requiredSet.addCapability(STENCIL_TEST, false);
         requiredSet.addCapability(DEPTH_TEST, false);
@@ -30,19 +33,24 @@ namespace Flux {
 
     }
 
+    void TonemapPass::setStageUniforms(ShaderProgram& shader, const Scene& scene)
+    {
+        shader.uniform1i("tonemapper", tonemapper);
+        shader.uniform1f("exposure", exposure);
+    }
+
     void TonemapPass::render(RenderState& renderState, const Scene& scene)
     {
         renderState.require(requiredSet);
 
         nvtxRangePushA(getPassName().c_str());
 
-        shader.bind();
+        RenderState::useProgram(shader);
 
         source->bind(TextureUnit::TEXTURE);
         shader.uniform1i("source", TextureUnit::TEXTURE);
 
-        shader.uniform1i("tonemapper", tonemapper);
-        shader.uniform1f("exposure", exposure);
+        setStageUniforms(shader, scene);
 
         renderState.drawQuad();
 
@@ -25,6 +25,10 @@ namespace Flux
 
         void render(RenderState& renderState, const Scene& scene) override;
 
+        const char* getStageSource() const override { return "res/Shaders/Stages/Tonemap.frag"; }
+        const char* getStageFunction() const override { return "tonemap"; }
+        void setStageUniforms(ShaderProgram& shader, const Scene& scene) override;
+
     private:
         ShaderProgram shader;
 
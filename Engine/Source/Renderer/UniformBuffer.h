@@ -0,0 +1,131 @@
+#pragma once
+
+#include <glad/glad.h>
+
+namespace Flux {
+    /** Binding points of the uniform blocks shared between shader programs */
+    enum UniformBinding {
+        CAMERA_BLOCK = 0,
+        DRAW_BLOCK = 1,
+        MATERIAL_BLOCK = 2,
+        FACE_BLOCK = 3,
+        CUBE_BLOCK = 4,
+        LIGHT_BLOCK = 5
+    };
+
+    /** Maximum number of instances in a DrawBlock, must match the array size in Model.vert */
+    const unsigned int MAX_DRAW_INSTANCES = 255;
+
+    /** Camera parameters laid out according to the std140 CameraBlock */
+    struct CameraUniforms {
+        float projMatrix[16];
+        float viewMatrix[16];
+        float projViewMatrix[16];
+        float camPos[3];
+        float zNear;
+        float zFar;
+        float padding[3];
+        // Turns window coordinates and depth back into world space positions
+        float invProjViewMatrix[16];
+    };
+
+    /** Mesh parameters at the start of the std140 DrawBlock */
+    struct DrawUniforms {
+        float positionScale[4];
+        float positionOffset[4];
+    };
+
+    /** World matrix of a single instance within the std140 DrawBlock, following the DrawUniforms */
+    struct InstanceUniforms {
+        float modelMatrix[16];
+    };
+
+    /** Declared size of the DrawBlock, every range bound to it has to cover all of it */
+    const GLsizeiptr DRAW_BLOCK_SIZE = sizeof(DrawUniforms) + MAX_DRAW_INSTANCES * sizeof(InstanceUniforms);
+
+    /** Declared size of the FaceBlock, one face mask per instance packed four to a uvec4 */
+    const GLsizeiptr FACE_BLOCK_SIZE = (MAX_DRAW_INSTANCES + 3) / 4 * 4 * sizeof(GLuint);
+
+    /** Views of the six faces of a point light laid out according to the std140 CubeBlock */
+    struct CubeUniforms {
+        float faceMatrices[6][16];
+        // Scale and offset moving each face from clip space into its tile of the shadow atlas
+        float faceTiles[6][4];
+    };
+
+    /** Material parameters laid out according to the std140 MaterialBlock */
+    struct MaterialUniforms {
+        float emission[3];
+        float padding;
+        float tiling[2];
+        GLuint hasDiffuseMap;
+        GLuint hasNormalMap;
+        GLuint hasMetalMap;
+        GLuint hasRoughnessMap;
+        GLuint hasStencilMap;
+        GLuint hasEmissionMap;
+    };
+
+    class UniformBuffer {
+    public:
+        UniformBuffer() :
+            handle(0)
+        {
+
+        }
+
+        void create() {
+            glGenBuffers(1, &handle);
+        }
+
+        void destroy() {
+            glDeleteBuffers(1, &handle);
+        }
+
+        bool isCreated() const {
+            return handle != 0;
+        }
+
+        /** Replaces the storage of the buffer, orphaning the previous contents */
+        void setData(GLsizeiptr size, const void* data, GLenum usage) {
+            glBindBuffer(GL_UNIFORM_BUFFER, handle);
+            glBufferData(GL_UNIFORM_BUFFER, size, data, usage);
+        }
+
+        void setSubData(GLintptr offset, GLsizeiptr size, const void* data) {
+            glBindBuffer(GL_UNIFORM_BUFFER, handle);
+            glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+        }
+
+        void bindBase(UniformBinding binding) const {
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, handle);
+        }
+
+        void bindRange(UniformBinding binding, GLintptr offset, GLsizeiptr size) const {
+            glBindBufferRange(GL_UNIFORM_BUFFER, binding, handle, offset, size);
+        }
+
+        /** Returns the alignment that offsets passed to bindRange must adhere to */
+        static GLint getOffsetAlignment() {
+            static GLint alignment = 0;
+            if (alignment == 0) {
+                glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            }
+            return alignment;
+        }
+
+        /** Connects the uniform block with the given name in the program that is in use to a binding point */
+        static void bindCurrentProgramBlock(const char* blockName, UniformBinding binding) {
+            GLint program = 0;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+
+            GLuint blockIndex = glGetUniformBlockIndex(program, blockName);
+            if (blockIndex != GL_INVALID_INDEX) {
+                glUniformBlockBinding(program, blockIndex, binding);
+            }
+        }
+
+    private:
+        GLuint handle;
+    };
+}
@@ -0,0 +1,168 @@
+#include "Renderer/VertexFormat.h"
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+
+namespace Flux {
+    namespace VertexFormat {
+        uint16_t toHalf(float f) {
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+
+            uint32_t sign = (bits >> 16) & 0x8000;
+            int32_t exponent = (int32_t) ((bits >> 23) & 0xFF) - 127 + 15;
+            uint32_t mantissa = bits & 0x7FFFFF;
+
+            // Flush values too small for a half to zero and clamp values too large to infinity
+            if (exponent <= 0)
+                return (uint16_t) sign;
+            if (exponent >= 31)
+                return (uint16_t) (sign | 0x7C00);
+
+            // Round the mantissa to nearest
+            uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+            if (mantissa & 0x1000) {
+                half++;
+            }
+            return (uint16_t) half;
+        }
+
+        static int16_t toSnorm16(float f) {
+            return (int16_t) roundf(std::max(-1.0f, std::min(1.0f, f)) * 32767.0f);
+        }
+
+        void encodeOctahedral(const Vector3f& n, int16_t out[2]) {
+            float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+            if (l1 == 0) {
+                out[0] = 0;
+                out[1] = 0;
+                return;
+            }
+
+            // Project onto the octahedron and fold the lower hemisphere over the diagonals
+            float x = n.x / l1;
+            float y = n.y / l1;
+            if (n.z < 0) {
+                float fx = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+                float fy = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+                x = fx;
+                y = fy;
+            }
+            out[0] = toSnorm16(x);
+            out[1] = toSnorm16(y);
+        }
+
+        uint32_t packSnorm1010102(const Vector3f& v, float w) {
+            auto pack10 = [](float f) {
+                return (uint32_t) ((int32_t) roundf(std::max(-1.0f, std::min(1.0f, f)) * 511.0f) & 0x3FF);
+            };
+            uint32_t pw = (uint32_t) ((int32_t) roundf(std::max(-1.0f, std::min(1.0f, w))) & 0x3);
+
+            return pack10(v.x) | (pack10(v.y) << 10) | (pack10(v.z) << 20) | (pw << 30);
+        }
+
+        PackedMesh pack(const Mesh& mesh, bool quantizePositions) {
+            PackedMesh packed;
+            const size_t numVertices = mesh.vertices.size();
+
+            packed.quantized = quantizePositions;
+            packed.positionScale.set(1, 1, 1);
+            packed.positionOffset.set(0, 0, 0);
+
+            if (quantizePositions) {
+                Vector3f extent = mesh.bounds.max - mesh.bounds.min;
+                packed.positionOffset = mesh.bounds.min;
+                packed.positionScale.set(
+                    extent.x > 0 ? extent.x : 1,
+                    extent.y > 0 ? extent.y : 1,
+                    extent.z > 0 ? extent.z : 1
+                );
+
+                packed.positions.resize(numVertices * sizeof(QuantizedPosition));
+                QuantizedPosition* positions = reinterpret_cast<QuantizedPosition*>(packed.positions.data());
+
+                for (size_t i = 0; i < numVertices; i++) {
+                    Vector3f t = (mesh.vertices[i] - packed.positionOffset) / packed.positionScale;
+                    positions[i].x = (uint16_t) roundf(std::max(0.0f, std::min(1.0f, t.x)) * 65535.0f);
+                    positions[i].y = (uint16_t) roundf(std::max(0.0f, std::min(1.0f, t.y)) * 65535.0f);
+                    positions[i].z = (uint16_t) roundf(std::max(0.0f, std::min(1.0f, t.z)) * 65535.0f);
+                    positions[i].padding = 0;
+                }
+            } else {
+                packed.positions.resize(numVertices * sizeof(Vector3f));
+                if (numVertices > 0) {
+                    memcpy(packed.positions.data(), mesh.vertices.data(), packed.positions.size());
+                }
+            }
+
+            packed.attributes.resize(numVertices);
+            for (size_t i = 0; i < numVertices; i++) {
+                PackedAttributes& attributes = packed.attributes[i];
+
+                float u = i < mesh.texCoords.size() ? mesh.texCoords[i].x : 0;
+                float v = i < mesh.texCoords.size() ? mesh.texCoords[i].y : 0;
+                attributes.texCoord[0] = toHalf(u);
+                attributes.texCoord[1] = toHalf(v);
+
+                encodeOctahedral(i < mesh.normals.size() ? mesh.normals[i] : Vector3f(0, 0, 1), attributes.normal);
+                attributes.tangent = packSnorm1010102(i < mesh.tangents.size() ? mesh.tangents[i] : Vector3f(1, 0, 0), 1);
+            }
+
+            // Use 16 bit indices whenever every vertex can be addressed with them, levels of detail follow the full indices
+            const size_t numIndices = mesh.indices.size() + mesh.lodIndices.size();
+            if (numVertices <= 0x10000) {
+                packed.indexType = GL_UNSIGNED_SHORT;
+                packed.indices.resize(numIndices * sizeof(uint16_t));
+
+                uint16_t* indices = reinterpret_cast<uint16_t*>(packed.indices.data());
+                for (size_t i = 0; i < mesh.indices.size(); i++) {
+                    indices[i] = (uint16_t) mesh.indices[i];
+                }
+                for (size_t i = 0; i < mesh.lodIndices.size(); i++) {
+                    indices[mesh.indices.size() + i] = (uint16_t) mesh.lodIndices[i];
+                }
+            } else {
+                packed.indexType = GL_UNSIGNED_INT;
+                packed.indices.resize(numIndices * sizeof(uint32_t));
+                if (!mesh.indices.empty()) {
+                    memcpy(packed.indices.data(), mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+                }
+                if (!mesh.lodIndices.empty()) {
+                    memcpy(packed.indices.data() + mesh.indices.size() * sizeof(uint32_t), mesh.lodIndices.data(), mesh.lodIndices.size() * sizeof(uint32_t));
+                }
+            }
+
+            return packed;
+        }
+
+        GLsizei getIndexSize(GLenum indexType) {
+            return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+
+        void setPositionAttribute(bool quantized) {
+            if (quantized) {
+                glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, true, sizeof(QuantizedPosition), 0);
+            } else {
+                glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vector3f), 0);
+            }
+            glEnableVertexAttribArray(0);
+        }
+
+        void setPackedAttributes() {
+            const GLsizei stride = sizeof(PackedAttributes);
+
+            glVertexAttribPointer(1, 2, GL_HALF_FLOAT, false, stride, (const GLvoid*) offsetof(PackedAttributes, texCoord));
+            glEnableVertexAttribArray(1);
+
+            glVertexAttribPointer(2, 2, GL_SHORT, true, stride, (const GLvoid*) offsetof(PackedAttributes, normal));
+            glEnableVertexAttribArray(2);
+
+            glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, true, stride, (const GLvoid*) offsetof(PackedAttributes, tangent));
+            glEnableVertexAttribArray(3);
+        }
+    }
+}
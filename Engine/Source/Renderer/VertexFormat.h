@@ -0,0 +1,65 @@
+#pragma once
+
+#include <GDT/Vector3f.h>
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstdint>
+
+using GDT::Vector3f;
+
+namespace Flux {
+    class Mesh;
+
+    /** The attributes that follow the position stream, interleaved into 12 bytes */
+    struct PackedAttributes {
+        // Half float texture coordinates
+        uint16_t texCoord[2];
+        // Octahedral encoded normal as two snorm16 values
+        int16_t normal[2];
+        // Tangent as a GL_INT_2_10_10_10_REV snorm value
+        uint32_t tangent;
+    };
+
+    /** A position quantized to unorm16 within the bounds of its mesh */
+    struct QuantizedPosition {
+        uint16_t x, y, z, padding;
+    };
+
+    /** Vertex and index data of a mesh converted to the packed GPU layout */
+    struct PackedMesh {
+        std::vector<unsigned char> positions;
+        std::vector<PackedAttributes> attributes;
+        std::vector<unsigned char> indices;
+
+        GLenum indexType;
+        bool quantized;
+
+        // Transforms the stored positions back into object space
+        Vector3f positionScale;
+        Vector3f positionOffset;
+    };
+
+    /**
+     * Converts meshes to the packed vertex layout. Positions form their own
+     * stream so that depth only passes can fetch just 12 (or 8 when quantized)
+     * bytes per vertex, all other attributes are interleaved in a second stream.
+     */
+    namespace VertexFormat {
+        uint16_t toHalf(float f);
+        void encodeOctahedral(const Vector3f& n, int16_t out[2]);
+        uint32_t packSnorm1010102(const Vector3f& v, float w);
+
+        /** Packs the mesh, quantizing positions to 16 bits when requested */
+        PackedMesh pack(const Mesh& mesh, bool quantizePositions);
+
+        GLsizei getIndexSize(GLenum indexType);
+
+        /** Sets up attribute 0 from the currently bound array buffer */
+        void setPositionAttribute(bool quantized);
+
+        /** Sets up attributes 1 to 3 from the currently bound array buffer */
+        void setPackedAttributes();
+    }
+}
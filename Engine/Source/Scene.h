@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Entity.h"
+#include "ComponentRegistry.h"
+#include "TransformHierarchy.h"
 #include "Transform.h"
 #include "Camera.h"
 #include "PointLight.h"
@@ -9,22 +11,89 @@
 #include "Skybox.h"
 
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
 
 namespace Flux {
     class Scene {
     public:
-        Scene() : mainCamera(), skybox(0), skySphere(0) { }
+        Scene() : mainCamera(), skybox(0), skySphere(0), registry(new ComponentRegistry()) { }
 
         void update() {
             for (Script* script : scripts) {
                 script->update(*this);
             }
+            updateTransforms();
+        }
+
+        /** Recomputes the world matrices of all entities whose transform changed */
+        void updateTransforms() {
+            hierarchy.update(*this);
+        }
+
+        /** Returns the world matrix of the entity at the given index */
+        const Matrix4f& getWorldMatrix(uint32_t entity) const {
+            return hierarchy.getWorldMatrix(entity);
+        }
+
+        /** Returns a counter that changes whenever the world matrix of the entity changes */
+        uint32_t getTransformVersion(uint32_t entity) const {
+            return hierarchy.getVersion(entity);
         }
 
         Entity* getMainCamera() const {
             return mainCamera;
         }
 
+        /** Creates a new entity whose components are stored in this scene */
+        Entity* createEntity() {
+            EntityHandle handle = registry->createEntity();
+
+            if (handle.index >= entitySlots.size()) {
+                entitySlots.resize(handle.index + 1);
+            }
+            Entity* entity = new Entity(*registry, handle);
+            entitySlots[handle.index].reset(entity);
+
+            return entity;
+        }
+
+        /** Creates a new entity that can be looked up by the given scene file identifier */
+        Entity* createEntity(uint32_t id) {
+            Entity* entity = createEntity();
+            entity->setId(id);
+            idMap[id] = entity->getHandle();
+            return entity;
+        }
+
+        /** Destroys the entity, any handles still referring to it will no longer resolve */
+        void destroyEntity(Entity* entity) {
+            EntityHandle handle = entity->getHandle();
+
+            auto it = idMap.find(entity->getId());
+            if (it != idMap.end() && it->second == handle) {
+                idMap.erase(it);
+            }
+            entities.erase(std::remove(entities.begin(), entities.end(), entity), entities.end());
+            lights.erase(std::remove(lights.begin(), lights.end(), entity), lights.end());
+            if (mainCamera == entity) {
+                mainCamera = nullptr;
+            }
+
+            registry->destroyEntity(handle);
+            entitySlots[handle.index].reset();
+            hierarchy.invalidate();
+        }
+
+        /** Returns the entity the handle refers to, or nullptr if it was destroyed */
+        Entity* getEntity(EntityHandle handle) const {
+            if (!registry->isValid(handle)) {
+                return nullptr;
+            }
+            return entitySlots[handle.index].get();
+        }
+
         void addMaterial(Material* material) {
             materials.push_back(material);
         }
@@ -34,26 +103,36 @@ namespace Flux {
         }
 
         Entity* getEntityById(uint32_t id) const {
-            for (Entity* e : entities) {
-                if (e->getId() == id) {
-                    return e;
-                }
-            }
-            for (Entity* e : lights) {
-                if (e->getId() == id) {
-                    return e;
-                }
-            }
-            if (mainCamera->getId() == id) {
-                return mainCamera;
+            auto it = idMap.find(id);
+
+            if (it == idMap.end()) {
+                return nullptr;
             }
-            return nullptr;
+            return getEntity(it->second);
         }
 
         void addScript(Script* script) {
             scripts.push_back(script);
         }
 
+        /** Returns a view over all entities owning every one of the given components */
+        template <class... Ts>
+        View<Ts...> view() const {
+            return registry->view<Ts...>();
+        }
+
+        /** Returns the component of the entity at the given index, or nullptr if it has none */
+        template <class T>
+        T* getComponent(uint32_t entity) const {
+            return registry->getPool<T>().tryGet(entity);
+        }
+
+        /** Returns the number of entities owning a component of the given type */
+        template <class T>
+        size_t getComponentCount() const {
+            return registry->getPool<T>().size();
+        }
+
         Skybox* skybox;
         Texture2D* skySphere;
 
@@ -63,5 +142,14 @@ namespace Flux {
         std::vector<Script*> scripts;
 
         Entity* mainCamera;
+
+    private:
+        std::unique_ptr<ComponentRegistry> registry;
+        // Entities indexed by the slot of their handle
+        std::vector<std::unique_ptr<Entity>> entitySlots;
+        // Maps scene file identifiers to entity handles
+        std::unordered_map<uint32_t, EntityHandle> idMap;
+
+        TransformHierarchy hierarchy;
     };
 }
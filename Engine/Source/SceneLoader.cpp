@@ -2,6 +2,7 @@
 #include "MaterialLoader.h"
 
 #include "Util/Path.h"
+#include "Util/Log.h"
 #include "Scene.h"
 #include "Skybox.h"
 
@@ -13,59 +14,92 @@
 #include "DirectionalLight.h"
 #include "AreaLight.h"
 #include "AttachedTo.h"
+#include "Renderer/VertexFormat.h"
+#include "Renderer/RenderState.h"
 
 #include <fstream>
+#include <unordered_map>
+#include <cstring>
+#include <string>
 #include <iostream> // Temp
 
 #include <glad/glad.h>
 
 namespace Flux {
     // TODO Move mesh loading and uploading to a separate class
-    void uploadMesh(Mesh* mesh) {
-        // Generate vertex array object
+    void uploadMesh(Mesh* mesh, bool quantizePositions) {
+        PackedMesh packed = VertexFormat::pack(*mesh, quantizePositions);
+
+        GLuint positionVBO;
+        GLuint attributeVBO;
+        glGenBuffers(1, &mesh->indexBuffer);
+        glGenBuffers(1, &positionVBO);
+        glGenBuffers(1, &attributeVBO);
+
+        // Generate the vertex array object with all attributes
         glGenVertexArrays(1, &mesh->handle);
-        glBindVertexArray(mesh->handle);
+        RenderState::bindVertexArray(mesh->handle);
 
         // Store faces in a buffer
-        glGenBuffers(1, &mesh->indexBuffer);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indices.size() * sizeof(unsigned int), &mesh->indices[0], GL_STATIC_DRAW);
-
-        // Store vertices in a buffer
-        GLuint vertexVBO;
-        glGenBuffers(1, &vertexVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexVBO);
-        glBufferData(GL_ARRAY_BUFFER, mesh->vertices.size() * sizeof(Vector3f), &mesh->vertices[0], GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, 0);
-        glEnableVertexAttribArray(0);
-
-        // Store texture coordinates in a buffer
-        GLuint texCoordVBO;
-        glGenBuffers(1, &texCoordVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, texCoordVBO);
-        glBufferData(GL_ARRAY_BUFFER, mesh->texCoords.size() * sizeof(Vector2f), &mesh->texCoords[0], GL_STATIC_DRAW);
-        glVertexAttribPointer(1, 2, GL_FLOAT, false, 0, 0);
-        glEnableVertexAttribArray(1);
-
-        // Store normals in a buffer
-        GLuint normalVBO;
-        glGenBuffers(1, &normalVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, normalVBO);
-        glBufferData(GL_ARRAY_BUFFER, mesh->normals.size() * sizeof(Vector3f), &mesh->normals[0], GL_STATIC_DRAW);
-        glVertexAttribPointer(2, 3, GL_FLOAT, false, 0, 0);
-        glEnableVertexAttribArray(2);
-
-        // Store tangents in a buffer
-        GLuint tangentVBO;
-        glGenBuffers(1, &tangentVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, tangentVBO);
-        glBufferData(GL_ARRAY_BUFFER, mesh->tangents.size() * sizeof(Vector3f), &mesh->tangents[0], GL_STATIC_DRAW);
-        glVertexAttribPointer(3, 3, GL_FLOAT, false, 0, 0);
-        glEnableVertexAttribArray(3);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed.indices.size(), packed.indices.data(), GL_STATIC_DRAW);
+
+        // Store positions in their own buffer so depth passes can fetch only those
+        glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+        glBufferData(GL_ARRAY_BUFFER, packed.positions.size(), packed.positions.data(), GL_STATIC_DRAW);
+        VertexFormat::setPositionAttribute(packed.quantized);
+
+        // Store the remaining attributes interleaved in a single buffer
+        glBindBuffer(GL_ARRAY_BUFFER, attributeVBO);
+        glBufferData(GL_ARRAY_BUFFER, packed.attributes.size() * sizeof(PackedAttributes), packed.attributes.data(), GL_STATIC_DRAW);
+        VertexFormat::setPackedAttributes();
+
+        // Generate the position only vertex array object sharing the same buffers
+        glGenVertexArrays(1, &mesh->positionHandle);
+        RenderState::bindVertexArray(mesh->positionHandle);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+        VertexFormat::setPositionAttribute(packed.quantized);
 
         // Unbind the buffers
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        RenderState::bindVertexArray(0);
+
+        mesh->indexType = packed.indexType;
+        mesh->quantized = packed.quantized;
+        mesh->positionScale = packed.positionScale;
+        mesh->positionOffset = packed.positionOffset;
+    }
+
+    template <class T>
+    void hashBytes(uint64_t& hash, const std::vector<T>& data) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+        for (size_t i = 0; i < data.size() * sizeof(T); i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+
+    template <class T>
+    bool equalBytes(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+
+    /** FNV-1a hash over all vertex, index and level of detail data of the mesh */
+    uint64_t hashMesh(const Mesh& mesh) {
+        uint64_t hash = 14695981039346656037ull;
+        hashBytes(hash, mesh.vertices);
+        hashBytes(hash, mesh.texCoords);
+        hashBytes(hash, mesh.normals);
+        hashBytes(hash, mesh.tangents);
+        hashBytes(hash, mesh.indices);
+        hashBytes(hash, mesh.lodIndices);
+        return hash;
+    }
+
+    bool sameMeshData(const Mesh& a, const Mesh& b) {
+        return equalBytes(a.vertices, b.vertices) && equalBytes(a.texCoords, b.texCoords)
+            && equalBytes(a.normals, b.normals) && equalBytes(a.tangents, b.tangents)
+            && equalBytes(a.indices, b.indices) && equalBytes(a.lodIndices, b.lodIndices);
     }
 
     uint32_t readUnsignedInt(std::ifstream& stream) {
@@ -74,7 +108,7 @@ namespace Flux {
         return i;
     }
 
-    bool SceneLoader::loadScene(const Path path, Scene& scene) {
+    bool SceneLoader::loadScene(const Path path, Scene& scene, bool quantizePositions) {
         std::cout << "LOADING SCENE" << std::endl;
         std::ifstream inFile;
 
@@ -85,6 +119,17 @@ namespace Flux {
             return false;
         }
 
+        const uint32_t magic = readUnsignedInt(inFile);
+        const uint32_t version = readUnsignedInt(inFile);
+        if (inFile.fail() || magic != MAGIC) {
+            Log::error("Not a scene file, or one exported before the format had a version: " + path.str());
+            return false;
+        }
+        if (version != VERSION) {
+            Log::error("Scene file " + path.str() + " has version " + std::to_string(version) + " instead of " + std::to_string(VERSION) + ", export it again");
+            return false;
+        }
+
         uint32_t skyType = readUnsignedInt(inFile);
         std::cout << "Sky type: " << skyType << std::endl;
         if (skyType == 1) {
@@ -132,14 +177,15 @@ namespace Flux {
             delete path;
         }
 
+        // Entities whose mesh got uploaded, by mesh hash, so copies of a model can share its buffers
+        std::unordered_map<uint64_t, std::vector<uint32_t>> uploadedMeshes;
+
         uint32_t numEntities = readUnsignedInt(inFile);
         std::cout << "NUM ENTITIES: " << numEntities << std::endl;
 
         for (unsigned int i = 0; i < numEntities; ++i) {
-            Entity* e = new Entity();
-
             uint32_t id = readUnsignedInt(inFile);
-            e->setId(id);
+            Entity* e = scene.createEntity(id);
             std::cout << "Loading entity with id: " << e->getId() << std::endl;
             uint32_t numComponents = readUnsignedInt(inFile);
             
@@ -148,52 +194,85 @@ namespace Flux {
                 inFile.read(&component, sizeof(char));
 
                 if (component == 't') {
-                    Transform* t = new Transform();
-                    inFile.read((char *)&t->position, sizeof(Vector3f));
-                    std::cout << "Position: " << t->position << std::endl;
-                    inFile.read((char *)&t->rotation, sizeof(Vector3f));
-                    inFile.read((char *)&t->scale, sizeof(Vector3f));
-                    e->addComponent(t);
+                    Transform& t = e->addComponent<Transform>();
+                    inFile.read((char *)&t.position, sizeof(Vector3f));
+                    std::cout << "Position: " << t.position << std::endl;
+                    inFile.read((char *)&t.rotation, sizeof(Vector3f));
+                    inFile.read((char *)&t.scale, sizeof(Vector3f));
                 }
                 if (component == 'm') {
-                    Mesh* mesh = new Mesh();
+                    Mesh& mesh = e->addComponent<Mesh>();
 
                     uint32_t numVertices = readUnsignedInt(inFile);
-                    mesh->vertices.resize(numVertices);
-                    inFile.read((char *) &mesh->vertices[0], numVertices * sizeof(Vector3f));
+                    mesh.vertices.resize(numVertices);
+                    inFile.read((char *) &mesh.vertices[0], numVertices * sizeof(Vector3f));
 
                     uint32_t numTexCoords = readUnsignedInt(inFile);
-                    mesh->texCoords.resize(numTexCoords);
-                    inFile.read((char *) &mesh->texCoords[0], numTexCoords * sizeof(Vector2f));
+                    mesh.texCoords.resize(numTexCoords);
+                    inFile.read((char *) &mesh.texCoords[0], numTexCoords * sizeof(Vector2f));
 
                     uint32_t numNormals = readUnsignedInt(inFile);
-                    mesh->normals.resize(numNormals);
-                    inFile.read((char *) &mesh->normals[0], numNormals * sizeof(Vector3f));
+                    mesh.normals.resize(numNormals);
+                    inFile.read((char *) &mesh.normals[0], numNormals * sizeof(Vector3f));
 
                     uint32_t numTangents = readUnsignedInt(inFile);
-                    mesh->tangents.resize(numTangents);
-                    inFile.read((char *)&mesh->tangents[0], numTangents * sizeof(Vector3f));
+                    mesh.tangents.resize(numTangents);
+                    inFile.read((char *)&mesh.tangents[0], numTangents * sizeof(Vector3f));
 
                     uint32_t numIndices = readUnsignedInt(inFile);
-                    mesh->indices.resize(numIndices);
-                    inFile.read((char *) &mesh->indices[0], numIndices * sizeof(unsigned int));
+                    mesh.indices.resize(numIndices);
+                    inFile.read((char *) &mesh.indices[0], numIndices * sizeof(unsigned int));
+
+                    uint32_t numLods = readUnsignedInt(inFile);
+                    mesh.lods.resize(numLods);
+                    for (MeshLod& lod : mesh.lods) {
+                        inFile.read((char *) &lod.error, sizeof(float));
+
+                        const size_t offset = mesh.lodIndices.size();
+                        lod.indexCount = readUnsignedInt(inFile);
+                        lod.firstIndex = (unsigned int) (numIndices + offset);
+                        mesh.lodIndices.resize(offset + lod.indexCount);
+                        inFile.read((char *) (mesh.lodIndices.data() + offset), lod.indexCount * sizeof(unsigned int));
+                    }
 
-                    uploadMesh(mesh);
+                    mesh.bounds = AABB::fromPoints(mesh.vertices);
+                    mesh.boundingSphere = BoundingSphere::fromPoints(mesh.vertices, mesh.bounds.center());
+
+                    // Share the vertex array of an identical mesh so the renderer can instance them
+                    uint64_t hash = hashMesh(mesh);
+                    const Mesh* original = nullptr;
+                    for (uint32_t entity : uploadedMeshes[hash]) {
+                        const Mesh* candidate = scene.getComponent<Mesh>(entity);
+                        if (sameMeshData(*candidate, mesh)) {
+                            original = candidate;
+                            break;
+                        }
+                    }
 
-                    e->addComponent(mesh);
+                    if (original != nullptr) {
+                        mesh.handle = original->handle;
+                        mesh.positionHandle = original->positionHandle;
+                        mesh.indexBuffer = original->indexBuffer;
+                        mesh.indexType = original->indexType;
+                        mesh.quantized = original->quantized;
+                        mesh.positionScale = original->positionScale;
+                        mesh.positionOffset = original->positionOffset;
+                    } else {
+                        uploadMesh(&mesh, quantizePositions);
+                        uploadedMeshes[hash].push_back(e->getIndex());
+                    }
                 }
                 if (component == 'r') {
                     uint32_t id = readUnsignedInt(inFile);
 
-                    MeshRenderer* mr = new MeshRenderer();
-                    mr->materialID = id;
-
-                    e->addComponent(mr);
+                    MeshRenderer& mr = e->addComponent<MeshRenderer>();
+                    mr.materialID = id;
+                    inFile.read((char *)&mr.isStatic, sizeof(bool));
+                    inFile.read((char *)&mr.isOccluder, sizeof(bool));
                 }
                 if (component == 'c') {
                     bool perspective = true;
                     inFile.read((char *)&perspective, sizeof(bool));
-                    Camera* camera = nullptr;
 
                     if (perspective) {
                         float fovy, aspect, zNear, zFar;
@@ -203,7 +282,7 @@ namespace Flux {
                         inFile.read((char *)&zNear, sizeof(zNear));
                         inFile.read((char *)&zFar, sizeof(zFar));
                         std::cout << fovy << " " << aspect << " " << zNear << " " << zFar << std::endl;
-                        camera = new Camera(fovy, aspect, zNear, zFar);
+                        e->addComponent<Camera>(fovy, aspect, zNear, zFar);
                     }
                     else {
                         float left, right, bottom, top, zNear, zFar;
@@ -215,47 +294,37 @@ namespace Flux {
                         inFile.read((char *)&zNear, sizeof(zNear));
                         inFile.read((char *)&zFar, sizeof(zFar));
                         std::cout << left << " " << right << " " << bottom << " " << top << " " << zNear << " " << zFar << std::endl;
-                        camera = new Camera(left, right, bottom, top, zNear, zFar);
+                        e->addComponent<Camera>(left, right, bottom, top, zNear, zFar);
                     }
-
-                    e->addComponent(camera);
                 }
                 if (component == 'p') {
-                    PointLight* pointLight = new PointLight();
+                    PointLight& pointLight = e->addComponent<PointLight>();
 
-                    inFile.read((char *)&pointLight->color, sizeof(Vector3f));
+                    inFile.read((char *)&pointLight.color, sizeof(Vector3f));
                     float energy;
                     inFile.read((char *) &energy, sizeof(energy));
 
-                    pointLight->energy = energy;
-
-                    e->addComponent(pointLight);
+                    pointLight.energy = energy;
                 }
                 if (component == 'd') {
-                    DirectionalLight* dirLight = new DirectionalLight();
+                    DirectionalLight& dirLight = e->addComponent<DirectionalLight>();
 
-                    inFile.read((char *)&dirLight->color, sizeof(Vector3f));
-                    inFile.read((char *)&dirLight->energy, sizeof(float));
-                    
-                    e->addComponent(dirLight);
+                    inFile.read((char *)&dirLight.color, sizeof(Vector3f));
+                    inFile.read((char *)&dirLight.energy, sizeof(float));
                 }
                 if (component == 'l') {
-                    AreaLight* areaLight = new AreaLight();
+                    AreaLight& areaLight = e->addComponent<AreaLight>();
 
-                    inFile.read((char *)&areaLight->color, sizeof(Vector3f));
+                    inFile.read((char *)&areaLight.color, sizeof(Vector3f));
                     float energy;
                     inFile.read((char *)&energy, sizeof(energy));
 
-                    areaLight->energy = energy;
-
-                    e->addComponent(areaLight);
+                    areaLight.energy = energy;
                 }
                 if (component == 'a') {
                     uint32_t pid = readUnsignedInt(inFile);
                     std::cout << "Attached to: " << pid << std::endl;
-                    AttachedTo* attachedTo = new AttachedTo(pid);
-
-                    e->addComponent(attachedTo);
+                    e->addComponent<AttachedTo>(pid);
                 }
             }
 
@@ -272,6 +341,17 @@ namespace Flux {
             }
         }
 
+        // Map the parent identifiers from the file onto runtime entity handles
+        scene.view<AttachedTo>().each([&](uint32_t, AttachedTo& attachedTo) {
+            Entity* parent = scene.getEntityById(attachedTo.parentId);
+
+            if (parent != nullptr) {
+                attachedTo.parent = parent->getHandle();
+            }
+        });
+
+        scene.updateTransforms();
+
         //Transform* camT = new Transform();
         //camT->position.set(0, 4, 15);
         //camT->rotation.set(0, 0, 0);
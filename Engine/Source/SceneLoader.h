@@ -1,11 +1,19 @@
 #pragma once
 
+#include <cstdint>
+
 namespace Flux {
     class Path;
     class Scene;
 
     class SceneLoader {
     public:
-        static bool loadScene(const Path path, Scene& scene);
+        // Every scene file starts with these two, "FSCN" followed by the version of the layout it was written in
+        static const uint32_t MAGIC = 0x4E435346;
+        // Increment whenever the exporter changes what it writes, files of any other version are rejected
+        static const uint32_t VERSION = 1;
+
+        /** Loads the scene, optionally storing mesh positions as 16 bit values within their bounds */
+        static bool loadScene(const Path path, Scene& scene, bool quantizePositions = false);
     };
 }
@@ -8,6 +8,8 @@
 #include "Util/Path.h"
 #include "Util/Log.h"
 
+#include <algorithm>
+
 namespace Flux {
 
     bool loadTextureFromFile(Path path, int& width, int& height, TextureType type, void** data) {
@@ -42,6 +44,8 @@ namespace Flux {
     void Texture::destroy()
     {
         if (!created) { return; }
+        // Deleting a texture unbinds it from every unit
+        std::replace(RenderState::textureUnits.begin(), RenderState::textureUnits.end(), handle, 0u);
         glDeleteTextures(1, &handle);
 
         created = false;
@@ -86,6 +90,13 @@ namespace Flux {
         glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, level);
     }
 
+    void Texture::setBaseMipmapLevel(uint level)
+    {
+        if (!isBound()) { bind(lastBoundUnit); }
+
+        glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, level);
+    }
+
     void Texture::generateMipmaps()
     {
         if (!isBound()) { bind(lastBoundUnit); }
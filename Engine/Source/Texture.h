@@ -59,12 +59,14 @@ namespace Flux {
 
         void setMaxMipmapLevel(uint level);
 
+        void setBaseMipmapLevel(uint level);
+
         void generateMipmaps();
 
         /**
         * Return the raw OpenGL texture ID.
         */
-        GLuint getHandle()
+        GLuint getHandle() const
         {
             return handle;
         }
@@ -17,11 +17,15 @@ namespace Flux {
         static const unsigned int TEXTURE = 0;
         static const unsigned int BLOOM = 1;
 
-        static const unsigned int POSITION = 2;
         static const unsigned int DEPTH = 3;
 
         static const unsigned int SHADOW = 9;
 
+        static const unsigned int LIGHTS = 10;
+        static const unsigned int LIGHT_CLUSTERS = 11;
+        static const unsigned int LIGHT_INDICES = 12;
+        static const unsigned int SHADOW_TILES = 13;
+
         static const unsigned int TEXTURE0 = 0;
         static const unsigned int TEXTURE1 = 1;
         static const unsigned int TEXTURE2 = 2;
@@ -9,6 +9,8 @@ using GDT::Vector3f;
 namespace Flux {
     class Transform : public Component {
     public:
+        static const ComponentType TYPE = ComponentType::Transform;
+
         Transform()
         :    position(0, 0, 0)
         ,    rotation(0, 0, 0)
@@ -0,0 +1,101 @@
+#include "TransformHierarchy.h"
+
+#include "Scene.h"
+#include "Transform.h"
+#include "AttachedTo.h"
+
+#include "nvToolsExt.h"
+
+namespace Flux {
+    void TransformHierarchy::update(const Scene& scene) {
+        nvtxRangePushA("Transforms");
+
+        size_t numTransforms = scene.getComponentCount<Transform>();
+        size_t numAttachments = scene.getComponentCount<AttachedTo>();
+
+        // The parent of any node may have changed, so rebuild all world matrices after sorting
+        bool rebuildAll = structureChanged || numTransforms != transformCount || numAttachments != attachmentCount;
+        if (rebuildAll) {
+            sort(scene, numTransforms);
+
+            transformCount = numTransforms;
+            attachmentCount = numAttachments;
+            structureChanged = false;
+        }
+
+        for (const Node& node : order) {
+            Transform& transform = *scene.getComponent<Transform>(node.entity);
+            LocalTransform& cached = cachedLocals[node.entity];
+
+            bool parentDirty = node.parent != NO_PARENT && dirty[node.parent];
+            bool localDirty = transform.position != cached.position
+                           || transform.rotation != cached.rotation
+                           || transform.scale != cached.scale;
+
+            dirty[node.entity] = rebuildAll || parentDirty || localDirty;
+            if (!dirty[node.entity])
+                continue;
+
+            Matrix4f& world = worldMatrices[node.entity];
+            if (node.parent != NO_PARENT) {
+                world = worldMatrices[node.parent];
+            } else {
+                world.setIdentity();
+            }
+            world.translate(transform.position);
+            world.rotate(transform.rotation);
+            world.scale(transform.scale);
+
+            cached.position = transform.position;
+            cached.rotation = transform.rotation;
+            cached.scale = transform.scale;
+            versions[node.entity]++;
+        }
+
+        nvtxRangePop();
+    }
+
+    void TransformHierarchy::sort(const Scene& scene, size_t maxDepth) {
+        order.clear();
+
+        // Group the entities by their depth in the hierarchy, roots first
+        std::vector<std::vector<Node>> levels;
+        scene.view<Transform>().each([&](uint32_t entity, Transform&) {
+            uint32_t parent = findParent(scene, entity);
+
+            // Bounded by the number of transforms so cyclic attachments cannot loop forever
+            size_t depth = 0;
+            for (uint32_t p = parent; p != NO_PARENT && depth < maxDepth; p = findParent(scene, p)) {
+                depth++;
+            }
+
+            if (depth >= levels.size()) {
+                levels.resize(depth + 1);
+            }
+            levels[depth].push_back(Node{ entity, parent });
+
+            if (entity >= worldMatrices.size()) {
+                worldMatrices.resize(entity + 1);
+                cachedLocals.resize(entity + 1);
+                dirty.resize(entity + 1);
+                versions.resize(entity + 1);
+            }
+        });
+
+        for (const std::vector<Node>& level : levels) {
+            order.insert(order.end(), level.begin(), level.end());
+        }
+    }
+
+    uint32_t TransformHierarchy::findParent(const Scene& scene, uint32_t entity) const {
+        AttachedTo* attachedTo = scene.getComponent<AttachedTo>(entity);
+        if (attachedTo == nullptr)
+            return NO_PARENT;
+
+        Entity* parent = scene.getEntity(attachedTo->parent);
+        if (parent == nullptr || scene.getComponent<Transform>(parent->getIndex()) == nullptr)
+            return NO_PARENT;
+
+        return parent->getIndex();
+    }
+}
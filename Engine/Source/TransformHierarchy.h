@@ -0,0 +1,77 @@
+#pragma once
+
+#include <GDT/Vector3f.h>
+#include <GDT/Matrix4f.h>
+
+#include <vector>
+#include <cstdint>
+
+using GDT::Vector3f;
+using GDT::Matrix4f;
+
+namespace Flux {
+    class Scene;
+
+    /**
+     * Computes the world matrix of every entity with a Transform once per frame.
+     * Entities are processed in topological order so a parent is always finished
+     * before its children, which allows attachment chains of arbitrary depth.
+     * Local transforms are compared against the values used for the previous
+     * world matrix, and only changed entities and their descendants are rebuilt.
+     */
+    class TransformHierarchy {
+    public:
+        TransformHierarchy() : structureChanged(true) { }
+
+        void update(const Scene& scene);
+
+        /** Forces the traversal order to be rebuilt, e.g. after re-parenting an entity */
+        void invalidate() {
+            structureChanged = true;
+        }
+
+        /** Returns the world matrix of the entity at the given index */
+        const Matrix4f& getWorldMatrix(uint32_t entity) const {
+            return worldMatrices[entity];
+        }
+
+        /** Counter that is incremented whenever the world matrix of the entity is rebuilt */
+        uint32_t getVersion(uint32_t entity) const {
+            return versions[entity];
+        }
+
+        /** World matrices of all entities, indexed by entity index */
+        const std::vector<Matrix4f>& getWorldMatrices() const {
+            return worldMatrices;
+        }
+
+    private:
+        static const uint32_t NO_PARENT = 0xFFFFFFFF;
+
+        struct Node {
+            uint32_t entity;
+            uint32_t parent;
+        };
+
+        struct LocalTransform {
+            Vector3f position;
+            Vector3f rotation;
+            Vector3f scale;
+        };
+
+        void sort(const Scene& scene, size_t maxDepth);
+        uint32_t findParent(const Scene& scene, uint32_t entity) const;
+
+        // Entities with a transform, parents always precede their children
+        std::vector<Node> order;
+
+        std::vector<Matrix4f> worldMatrices;
+        std::vector<LocalTransform> cachedLocals;
+        std::vector<uint8_t> dirty;
+        std::vector<uint32_t> versions;
+
+        size_t transformCount = 0;
+        size_t attachmentCount = 0;
+        bool structureChanged;
+    };
+}
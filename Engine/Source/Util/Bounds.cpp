@@ -0,0 +1,83 @@
+/* ---------------------------------------------------------------------------
+** This software is in the public domain, furnished "as is", without technical
+** support, and with no warranty, express or implied, as to its usefulness for
+** any purpose.
+**
+** Bounds.cpp
+** Implements axis-aligned bounding boxes and bounding spheres
+**
+** Author: Julian Thijssen
+** -------------------------------------------------------------------------*/
+
+#include "Bounds.h"
+
+#include <GDT/Matrix4f.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Flux
+{
+    BoundingSphere BoundingSphere::fromPoints(const std::vector<Vector3f>& points, const Vector3f& center)
+    {
+        float radiusSqr = 0;
+        for (const Vector3f& p : points) {
+            radiusSqr = std::max(radiusSqr, (p - center).sqrMagnitude());
+        }
+        return BoundingSphere(center, sqrtf(radiusSqr));
+    }
+
+    BoundingSphere BoundingSphere::transform(const Matrix4f& m) const
+    {
+        // Scale the radius by the largest axis scale of the matrix
+        float sx = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+        float sy = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+        float sz = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+        float scale = sqrtf(std::max(sx, std::max(sy, sz)));
+
+        return BoundingSphere(m.transform(center, 1), radius * scale);
+    }
+
+    AABB AABB::fromPoints(const std::vector<Vector3f>& points)
+    {
+        if (points.empty())
+            return AABB();
+
+        AABB box(points[0], points[0]);
+        for (const Vector3f& p : points) {
+            box.min.set(std::min(box.min.x, p.x), std::min(box.min.y, p.y), std::min(box.min.z, p.z));
+            box.max.set(std::max(box.max.x, p.x), std::max(box.max.y, p.y), std::max(box.max.z, p.z));
+        }
+        return box;
+    }
+
+    Vector3f AABB::center() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    Vector3f AABB::extents() const
+    {
+        return (max - min) * 0.5f;
+    }
+
+    AABB AABB::transform(const Matrix4f& m) const
+    {
+        // Transform the center and project the extents onto the new axes
+        Vector3f c = m.transform(center(), 1);
+        Vector3f e = extents();
+
+        Vector3f r(
+            fabsf(m[0]) * e.x + fabsf(m[4]) * e.y + fabsf(m[8]) * e.z,
+            fabsf(m[1]) * e.x + fabsf(m[5]) * e.y + fabsf(m[9]) * e.z,
+            fabsf(m[2]) * e.x + fabsf(m[6]) * e.y + fabsf(m[10]) * e.z
+        );
+
+        return AABB(c - r, c + r);
+    }
+
+    BoundingSphere AABB::sphere() const
+    {
+        return BoundingSphere(center(), extents().length());
+    }
+}
@@ -0,0 +1,64 @@
+/* ---------------------------------------------------------------------------
+** This software is in the public domain, furnished "as is", without technical
+** support, and with no warranty, express or implied, as to its usefulness for
+** any purpose.
+**
+** Bounds.h
+** Declares axis-aligned bounding boxes and bounding spheres
+**
+** Author: Julian Thijssen
+** -------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <GDT/Vector3f.h>
+
+#include <vector>
+
+namespace GDT
+{
+    class Matrix4f;
+}
+
+using GDT::Vector3f;
+using GDT::Matrix4f;
+
+namespace Flux
+{
+    class BoundingSphere
+    {
+    public:
+        BoundingSphere() : center(0, 0, 0), radius(0) { }
+        BoundingSphere(const Vector3f& center, float radius) : center(center), radius(radius) { }
+
+        /** Returns the smallest sphere around the given center enclosing all points */
+        static BoundingSphere fromPoints(const std::vector<Vector3f>& points, const Vector3f& center);
+
+        /** Returns the sphere enclosing this sphere after the given transformation */
+        BoundingSphere transform(const Matrix4f& m) const;
+
+        Vector3f center;
+        float radius;
+    };
+
+    class AABB
+    {
+    public:
+        AABB() : min(0, 0, 0), max(0, 0, 0) { }
+        AABB(const Vector3f& min, const Vector3f& max) : min(min), max(max) { }
+
+        static AABB fromPoints(const std::vector<Vector3f>& points);
+
+        Vector3f center() const;
+        Vector3f extents() const;
+
+        /** Returns the box enclosing this box after the given transformation */
+        AABB transform(const Matrix4f& m) const;
+
+        /** Returns the smallest sphere centered on the box that encloses it */
+        BoundingSphere sphere() const;
+
+        Vector3f min;
+        Vector3f max;
+    };
+}
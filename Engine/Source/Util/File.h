@@ -40,5 +40,16 @@ namespace Flux {
             }
             return String(source);
         }
+
+        static bool saveFile(const char* path, const string& contents) {
+            ofstream file(path);
+            if (file.fail() || !file.is_open()) {
+                Log::error("Could not write to file: " + string(path));
+                return false;
+            }
+
+            file << contents;
+            return !file.fail();
+        }
     };
 }
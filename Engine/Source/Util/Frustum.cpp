@@ -0,0 +1,67 @@
+/* ---------------------------------------------------------------------------
+** This software is in the public domain, furnished "as is", without technical
+** support, and with no warranty, express or implied, as to its usefulness for
+** any purpose.
+**
+** Frustum.cpp
+** Implements a view frustum that bounding volumes can be tested against
+**
+** Author: Julian Thijssen
+** -------------------------------------------------------------------------*/
+
+#include "Frustum.h"
+
+#include <GDT/Matrix4f.h>
+
+namespace Flux
+{
+    Frustum::Frustum(const Matrix4f& m)
+    {
+        // Every plane is the sum or difference of the fourth row and one of the other rows
+        for (int i = 0; i < 6; i++) {
+            int row = i / 2;
+            float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+
+            Plane& plane = planes[i];
+            plane.normal.set(m[3] + sign * m[row], m[7] + sign * m[4 + row], m[11] + sign * m[8 + row]);
+            plane.d = m[15] + sign * m[12 + row];
+
+            float length = plane.normal.length();
+            plane.normal /= length;
+            plane.d /= length;
+        }
+    }
+
+    bool Frustum::intersects(const BoundingSphere& sphere) const
+    {
+        for (const Plane& plane : planes) {
+            if (plane.distance(sphere.center) < -sphere.radius)
+                return false;
+        }
+        return true;
+    }
+
+    bool Frustum::intersects(const AABB& box) const
+    {
+        for (const Plane& plane : planes) {
+            // Test the corner of the box furthest along the plane normal
+            Vector3f p(
+                plane.normal.x >= 0 ? box.max.x : box.min.x,
+                plane.normal.y >= 0 ? box.max.y : box.min.y,
+                plane.normal.z >= 0 ? box.max.z : box.min.z
+            );
+            if (plane.distance(p) < 0)
+                return false;
+        }
+        return true;
+    }
+
+    bool Frustum::contains(const BoundingSphere& sphere) const
+    {
+        for (const Plane& plane : planes) {
+            if (plane.distance(sphere.center) < sphere.radius)
+                return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,58 @@
+/* ---------------------------------------------------------------------------
+** This software is in the public domain, furnished "as is", without technical
+** support, and with no warranty, express or implied, as to its usefulness for
+** any purpose.
+**
+** Frustum.h
+** Declares a view frustum that bounding volumes can be tested against
+**
+** Author: Julian Thijssen
+** -------------------------------------------------------------------------*/
+
+#pragma once
+
+#include "Util/Bounds.h"
+
+#include <GDT/Vector3f.h>
+
+namespace GDT
+{
+    class Matrix4f;
+}
+
+using GDT::Vector3f;
+using GDT::Matrix4f;
+
+namespace Flux
+{
+    class Plane
+    {
+    public:
+        float distance(const Vector3f& p) const
+        {
+            return normal.x * p.x + normal.y * p.y + normal.z * p.z + d;
+        }
+
+        Vector3f normal;
+        float d;
+    };
+
+    class Frustum
+    {
+    public:
+        Frustum() { }
+
+        /** Extracts the frustum planes from a projection * view matrix */
+        Frustum(const Matrix4f& projView);
+
+        bool intersects(const BoundingSphere& sphere) const;
+        bool intersects(const AABB& box) const;
+
+        /** Returns true if the sphere lies completely within the frustum */
+        bool contains(const BoundingSphere& sphere) const;
+
+    private:
+        // Left, right, bottom, top, near, far
+        Plane planes[6];
+    };
+}
@@ -12,6 +12,11 @@
 #include "SceneLoader.h"
 #include "Util/Path.h"
 #include "Util/Size.h"
+#include "Util/Bounds.h"
+
+#include "Transform.h"
+#include "Mesh.h"
+#include "PointLight.h"
 
 #include "Renderer/SkyPass.h"
 #include "Renderer/BloomPass.h"
@@ -24,10 +29,48 @@
 #include <memory>
 #include <ctime>
 #include <iostream>
+#include <random>
+#include <cmath>
+#include <algorithm>
 
 #define DEFERRED
+// Scatters many unshadowed point lights through the scene to measure clustered lighting
+//#define LIGHT_STRESS_TEST
 
 namespace Flux {
+    namespace
+    {
+        void addStressLights(Scene& scene, unsigned int count)
+        {
+            AABB sceneBounds(Vector3f(INFINITY, INFINITY, INFINITY), Vector3f(-INFINITY, -INFINITY, -INFINITY));
+            scene.view<Transform, Mesh>().each([&](uint32_t entity, Transform&, Mesh& mesh) {
+                AABB bounds = mesh.bounds.transform(scene.getWorldMatrix(entity));
+                sceneBounds.min.set(std::min(sceneBounds.min.x, bounds.min.x), std::min(sceneBounds.min.y, bounds.min.y), std::min(sceneBounds.min.z, bounds.min.z));
+                sceneBounds.max.set(std::max(sceneBounds.max.x, bounds.max.x), std::max(sceneBounds.max.y, bounds.max.y), std::max(sceneBounds.max.z, bounds.max.z));
+            });
+
+            std::mt19937 random(1337);
+            std::uniform_real_distribution<float> unit(0, 1);
+
+            for (unsigned int i = 0; i < count; i++) {
+                Entity* light = scene.createEntity();
+
+                Transform& transform = light->addComponent<Transform>();
+                transform.position.set(
+                    sceneBounds.min.x + unit(random) * (sceneBounds.max.x - sceneBounds.min.x),
+                    sceneBounds.min.y + unit(random) * (sceneBounds.max.y - sceneBounds.min.y),
+                    sceneBounds.min.z + unit(random) * (sceneBounds.max.z - sceneBounds.min.z));
+
+                PointLight& pointLight = light->addComponent<PointLight>();
+                pointLight.color.set(unit(random), unit(random), unit(random));
+                pointLight.castShadows = false;
+
+                scene.lights.push_back(light);
+            }
+            scene.updateTransforms();
+        }
+    }
+
     void Application::startGame() {
         std::cout << "Flux version " << Flux_VERSION_MAJOR << "." << Flux_VERSION_MINOR << std::endl;
 
@@ -39,6 +82,10 @@ namespace Flux {
         if (!loaded)
             return;
 
+#ifdef LIGHT_STRESS_TEST
+        addStressLights(currentScene, 512);
+#endif
+
 #ifdef DEFERRED
         renderer = std::make_unique<DeferredRenderer>();
 #else
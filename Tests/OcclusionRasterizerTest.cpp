@@ -0,0 +1,226 @@
+#include "Renderer/OcclusionRasterizer.h"
+
+#include <GDT/Matrix4f.h>
+#include <GDT/Vector3f.h>
+
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+using namespace Flux;
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const char* expression, int line)
+    {
+        if (!condition) {
+            std::cout << "OcclusionRasterizerTest.cpp(" << line << "): check failed: " << expression << std::endl;
+            failures++;
+        }
+    }
+
+    /** Same matrix as a perspective Camera, built here because the camera needs a GL context */
+    Matrix4f perspective(float fovy, float aspect, float zNear, float zFar)
+    {
+        Matrix4f m;
+        const float f = 1 / std::tan(fovy * 3.14159265f / 360);
+        m[0] = f / aspect;
+        m[5] = f;
+        m[10] = (zNear + zFar) / (zNear - zFar);
+        m[11] = -1;
+        m[14] = (2 * zNear * zFar) / (zNear - zFar);
+        m[15] = 0;
+        return m;
+    }
+
+    AABB box(float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+    {
+        return AABB(Vector3f(minX, minY, minZ), Vector3f(maxX, maxY, maxZ));
+    }
+
+    /** Adds a quad at the given depth facing the camera, or facing away from it */
+    void addWall(std::vector<Vector3f>& vertices, std::vector<unsigned int>& indices, float x, float y, float z, float width, float height, bool front)
+    {
+        const unsigned int base = (unsigned int) vertices.size();
+        vertices.push_back(Vector3f(x, y, z));
+        vertices.push_back(Vector3f(x + width, y, z));
+        vertices.push_back(Vector3f(x + width, y + height, z));
+        vertices.push_back(Vector3f(x, y + height, z));
+        if (front) {
+            indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+        }
+        else {
+            indices.insert(indices.end(), { base, base + 2, base + 1, base, base + 3, base + 2 });
+        }
+    }
+
+    void testWall(unsigned int width, unsigned int height, unsigned int workerCount)
+    {
+        // Camera at the origin looking down -z at a wall 10 units away, covering the middle of the screen
+        std::vector<Vector3f> vertices;
+        std::vector<unsigned int> indices;
+        addWall(vertices, indices, -3, -3, -10, 6, 6, true);
+
+        OcclusionRasterizer rasterizer;
+        rasterizer.create(width, height, workerCount);
+        rasterizer.clear(perspective(60, 2, 0.1f, 100));
+        rasterizer.addOccluder(vertices, indices, Matrix4f());
+        rasterizer.rasterize();
+
+        // Partial tiles are rounded up to whole ones
+        CHECK(rasterizer.getWidth() % OcclusionRasterizer::TILE_WIDTH == 0 && rasterizer.getWidth() >= width);
+        CHECK(rasterizer.getHeight() % OcclusionRasterizer::BAND_HEIGHT == 0 && rasterizer.getHeight() >= height);
+        CHECK(rasterizer.getStats().triangles == 2);
+
+        const AABB behind = box(-1, -1, -21, 1, 1, -19);
+        const AABB inFront = box(-1, -1, -6, 1, 1, -4);
+        const AABB pastEdge = box(2, -1, -21, 8, 1, -19);
+        const AABB behindEye = box(-1, -1, 19, 1, 1, 21);
+        const AABB acrossEye = box(-1, -1, -21, 1, 1, 1);
+
+        CHECK(rasterizer.isOccluded(behind));
+        CHECK(!rasterizer.isOccluded(inFront));
+        CHECK(!rasterizer.isOccluded(pastEdge));
+        CHECK(!rasterizer.isOccluded(behindEye));
+        CHECK(!rasterizer.isOccluded(acrossEye));
+
+        // Culling only drops the hidden box and keeps the order of the others
+        std::vector<AABB> bounds = { inFront, behind, pastEdge, behindEye, acrossEye };
+        std::vector<uint32_t> entities = { 0, 1, 2, 3, 4 };
+        rasterizer.cull(entities, bounds);
+
+        CHECK(entities == std::vector<uint32_t>({ 0, 2, 3, 4 }));
+        CHECK(rasterizer.getStats().tests == 5);
+        CHECK(rasterizer.getStats().occluded == 1);
+
+        rasterizer.destroy();
+    }
+
+    void testBackFacingWall()
+    {
+        std::vector<Vector3f> vertices;
+        std::vector<unsigned int> indices;
+        addWall(vertices, indices, -3, -3, -10, 6, 6, false);
+
+        OcclusionRasterizer rasterizer;
+        rasterizer.create(OcclusionRasterizer::DEFAULT_WIDTH, OcclusionRasterizer::DEFAULT_HEIGHT, 0);
+        rasterizer.clear(perspective(60, 2, 0.1f, 100));
+        rasterizer.addOccluder(vertices, indices, Matrix4f());
+        rasterizer.rasterize();
+
+        CHECK(rasterizer.getStats().triangles == 0);
+        CHECK(!rasterizer.isOccluded(box(-1, -1, -21, 1, 1, -19)));
+
+        rasterizer.destroy();
+    }
+
+    /** Rows of wall quads facing the camera, like building fronts along a street */
+    void generateStreet(unsigned int wallCount, unsigned int boxCount, std::vector<Vector3f>& vertices, std::vector<unsigned int>& indices, std::vector<AABB>& bounds)
+    {
+        std::mt19937 random(1337);
+        std::uniform_real_distribution<float> unit(0, 1);
+
+        for (unsigned int i = 0; i < wallCount; i++) {
+            const float x = unit(random) * 100 - 50;
+            const float z = -10 - unit(random) * 60;
+            const float width = 2 + unit(random) * 8;
+            const float height = 2 + unit(random) * 10;
+            addWall(vertices, indices, x, 0, z, width, height, true);
+        }
+
+        for (unsigned int i = 0; i < boxCount; i++) {
+            const Vector3f min(unit(random) * 100 - 50, unit(random) * 4, -10 - unit(random) * 90);
+            bounds.push_back(AABB(min, Vector3f(min.x + 1, min.y + 1, min.z + 1)));
+        }
+    }
+
+    Matrix4f streetMatrix()
+    {
+        Matrix4f viewMatrix;
+        viewMatrix[13] = -2;
+        return perspective(60, 16.0f / 9, 0.1f, 200) * viewMatrix;
+    }
+
+    /** The bands split over worker threads have to give the same depth as a single thread */
+    void testWorkersMatch()
+    {
+        std::vector<Vector3f> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<AABB> bounds;
+        generateStreet(500, 0, vertices, indices, bounds);
+
+        std::vector<float> depth[2];
+        const unsigned int workerCounts[2] = { 0, 3 };
+        for (int i = 0; i < 2; i++) {
+            OcclusionRasterizer rasterizer;
+            rasterizer.create(OcclusionRasterizer::DEFAULT_WIDTH, OcclusionRasterizer::DEFAULT_HEIGHT, workerCounts[i]);
+            rasterizer.clear(streetMatrix());
+            rasterizer.addOccluder(vertices, indices, Matrix4f());
+            rasterizer.rasterize();
+            depth[i] = rasterizer.getDepth();
+            rasterizer.destroy();
+        }
+
+        CHECK(depth[0] == depth[1]);
+        CHECK(std::any_of(depth[0].begin(), depth[0].end(), [](float d) { return d < 1; }));
+    }
+
+    void benchmark(unsigned int wallCount, unsigned int boxCount, unsigned int frames)
+    {
+        std::vector<Vector3f> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<AABB> bounds;
+        generateStreet(wallCount, boxCount, vertices, indices, bounds);
+
+        OcclusionRasterizer rasterizer;
+        rasterizer.create(OcclusionRasterizer::DEFAULT_WIDTH, OcclusionRasterizer::DEFAULT_HEIGHT, std::min(std::max(std::thread::hardware_concurrency(), 1u) - 1, 3u));
+
+        double rasterizeTime = 0, testTime = 0;
+        std::vector<uint32_t> entities;
+        for (unsigned int frame = 0; frame < frames; frame++) {
+            rasterizer.clear(streetMatrix());
+            rasterizer.addOccluder(vertices, indices, Matrix4f());
+            rasterizer.rasterize();
+
+            entities.resize(bounds.size());
+            for (uint32_t i = 0; i < entities.size(); i++) {
+                entities[i] = i;
+            }
+            rasterizer.cull(entities, bounds);
+
+            rasterizeTime += rasterizer.getStats().rasterizeTime;
+            testTime += rasterizer.getStats().testTime;
+        }
+        rasterizer.destroy();
+
+        const OcclusionStats& stats = rasterizer.getStats();
+        std::cout << "Occlusion rasterizer: " << stats.triangles << " triangles in " << rasterizeTime / frames << " ms ("
+            << stats.triangles / (rasterizeTime / frames) / 1000 << " M/s), "
+            << stats.tests << " boxes in " << testTime / frames << " ms ("
+            << stats.tests / (testTime / frames) / 1000 << " M/s), "
+            << stats.occluded << " occluded" << std::endl;
+    }
+}
+
+int main()
+{
+    testWall(OcclusionRasterizer::DEFAULT_WIDTH, OcclusionRasterizer::DEFAULT_HEIGHT, 0);
+    testWall(OcclusionRasterizer::DEFAULT_WIDTH, OcclusionRasterizer::DEFAULT_HEIGHT, 3);
+    testWall(260, 130, 3);
+    testBackFacingWall();
+    testWorkersMatch();
+
+    if (failures > 0) {
+        std::cout << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+
+    benchmark(2000, 100000, 20);
+    return 0;
+}
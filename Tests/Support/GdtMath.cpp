@@ -0,0 +1,43 @@
+#include <GDT/Vector3f.h>
+#include <GDT/Matrix4f.h>
+
+#include <cstring>
+
+// GDT only ships as prebuilt Windows libraries, these are the parts the tested sources use
+namespace GDT
+{
+    Vector3f::Vector3f() : x(0), y(0), z(0) { }
+    Vector3f::Vector3f(float x, float y, float z) : x(x), y(y), z(z) { }
+
+    // Column major like OpenGL, element i is at column i / 4 and row i % 4
+    Matrix4f::Matrix4f() {
+        setIdentity();
+    }
+
+    void Matrix4f::setIdentity() {
+        std::memset(a, 0, sizeof(a));
+        a[0] = a[5] = a[10] = a[15] = 1;
+    }
+
+    float Matrix4f::operator[](int i) const {
+        return a[i];
+    }
+
+    float& Matrix4f::operator[](int i) {
+        return a[i];
+    }
+
+    Matrix4f Matrix4f::operator*(const Matrix4f& m) const {
+        Matrix4f result;
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++) {
+                float sum = 0;
+                for (int k = 0; k < 4; k++) {
+                    sum += a[k * 4 + row] * m.a[col * 4 + k];
+                }
+                result.a[col * 4 + row] = sum;
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+/** No-op profiler markers, so tests do not need the NVTX library */
+inline int nvtxRangePushA(const char*) { return 0; }
+inline int nvtxRangePop() { return 0; }